@@ -14,3 +14,13 @@ ifeq ($(gprof), true)
     this_cxxflags += -pg
     this_ldflags += -pg
 endif
+
+# record timeline of rendering stages, see cpugl::tracer
+ifeq ($(trace), true)
+    this_cxxflags += -DCPUGL_TRACE
+endif
+
+# do not build cpugl::x11_shm_presenter, so that the library does not depend on X11 libraries
+ifeq ($(no_x11), true)
+    this_cxxflags += -DCPUGL_NO_X11
+endif
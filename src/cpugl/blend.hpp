@@ -0,0 +1,62 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <cstdint>
+
+#include <r4/vector.hpp>
+
+namespace cpugl {
+
+// Rounded division by 255 of values up to 255 * 255 * 2, without division instruction.
+constexpr uint32_t div_255(uint32_t value) noexcept
+{
+	constexpr uint32_t half = 0x80;
+	constexpr uint32_t shift = 8;
+
+	value += half;
+	return (value + (value >> shift)) >> shift;
+}
+
+// Blend source color over destination color with the source alpha, i.e. src * a + dst * (1 - a).
+// All channels, including alpha, are blended the same way.
+// The pipeline blends fragments of blended fragment programs this way, see fragment_program_traits.
+inline r4::vector4<uint8_t> blend(const r4::vector4<uint8_t>& dst, const r4::vector4<uint8_t>& src) noexcept
+{
+	constexpr uint32_t max_alpha = 0xff;
+
+	uint32_t a = src.w();
+	uint32_t one_minus_a = max_alpha - a;
+
+	r4::vector4<uint8_t> ret;
+	for (unsigned i = 0; i != ret.size(); ++i) {
+		ret[i] = uint8_t(div_255(src[i] * a + dst[i] * one_minus_a));
+	}
+	return ret;
+}
+
+} // namespace cpugl
@@ -0,0 +1,94 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <r4/vector.hpp>
+
+#include "config.hpp"
+
+namespace cpugl {
+
+// Axis aligned bounding box and bounding sphere of a set of points.
+struct bounding_volume {
+	r4::vector3<real> min{0, 0, 0};
+	r4::vector3<real> max{0, 0, 0};
+
+	r4::vector3<real> center{0, 0, 0};
+
+	// negative radius means empty volume, i.e. there were no points
+	real radius = -1;
+
+	bool empty() const noexcept
+	{
+		return this->radius < 0;
+	}
+};
+
+// get_position(i) must return position of the i-th point
+template <typename get_position_type>
+bounding_volume make_bounding_volume(size_t num_points, const get_position_type& get_position)
+{
+	bounding_volume ret;
+
+	if (num_points == 0) {
+		return ret;
+	}
+
+	ret.min = r4::vector3<real>(std::numeric_limits<real>::max());
+	ret.max = r4::vector3<real>(std::numeric_limits<real>::lowest());
+
+	for (size_t i = 0; i != num_points; ++i) {
+		const r4::vector3<real>& p = get_position(i);
+
+		using std::min;
+		using std::max;
+
+		ret.min = min(ret.min, p);
+		ret.max = max(ret.max, p);
+	}
+
+	// sphere around the box center, it is not minimal, but is much tighter than
+	// the one circumscribed around the box
+	ret.center = (ret.min + ret.max) / 2;
+
+	real radius_pow2 = 0;
+	for (size_t i = 0; i != num_points; ++i) {
+		using std::max;
+		radius_pow2 = max(radius_pow2, (get_position(i) - ret.center).norm_pow2());
+	}
+
+	using std::sqrt;
+	ret.radius = sqrt(radius_pow2);
+
+	return ret;
+}
+
+} // namespace cpugl
@@ -0,0 +1,63 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <r4/vector.hpp>
+
+#include "bounding_volume.hpp"
+#include "config.hpp"
+
+namespace cpugl {
+
+// Small part of a mesh which is culled as a whole.
+// See make_clusters().
+struct cluster {
+	constexpr static size_t max_vertices = 64;
+	constexpr static size_t max_faces = 124;
+
+	// indices of mesh vertices used by the cluster
+	std::vector<unsigned> vertices;
+
+	// indices into the cluster's vertices array
+	std::vector<std::array<uint8_t, 3>> faces;
+
+	bounding_volume bounds;
+
+	// Normal cone, all face normals are within the cone.
+	// Face normal is (v1 - v0) x (v2 - v0).
+	r4::vector3<real> cone_axis{0, 0, 0};
+
+	// sine of the cone half-angle,
+	// value of 1 means that the cone is too wide to be used for back-face culling
+	real cone_cutoff = 1;
+};
+
+} // namespace cpugl
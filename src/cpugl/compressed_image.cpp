@@ -0,0 +1,303 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "compressed_image.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+using namespace cpugl;
+
+namespace {
+using pixel_type = r4::vector4<uint8_t>;
+
+constexpr uint32_t block_dim = 4;
+constexpr size_t block_texels = size_t(block_dim) * block_dim;
+
+// BC1 texels with alpha below the threshold are encoded as transparent
+constexpr uint8_t alpha_threshold = 128;
+
+uint16_t encode_rgb565(const pixel_type& c)
+{
+	constexpr uint32_t max_5 = 0x1f;
+	constexpr uint32_t max_6 = 0x3f;
+	constexpr uint32_t max_8 = 0xff;
+	constexpr uint32_t half_8 = max_8 / 2;
+
+	auto r = (c[0] * max_5 + half_8) / max_8;
+	auto g = (c[1] * max_6 + half_8) / max_8;
+	auto b = (c[2] * max_5 + half_8) / max_8;
+	return uint16_t((r << 11) | (g << 5) | b);
+}
+
+r4::vector4<uint32_t> decode_rgb565(uint16_t c)
+{
+	uint32_t r = (c >> 11) & 0x1f;
+	uint32_t g = (c >> 5) & 0x3f;
+	uint32_t b = c & 0x1f;
+	return {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 0};
+}
+
+uint32_t rgb_distance_squared(const r4::vector4<uint32_t>& a, const pixel_type& b)
+{
+	uint32_t ret = 0;
+	for (unsigned i = 0; i != 3; ++i) {
+		auto d = int32_t(a[i]) - int32_t(b[i]);
+		ret += uint32_t(d * d);
+	}
+	return ret;
+}
+
+// Encode RGB block, endpoints are the two most distant colors of the block.
+// In three color mode texels with alpha below the threshold get the transparent index.
+void encode_color(const std::array<pixel_type, block_texels>& texels, bool three_color_mode, uint8_t* out)
+{
+	auto is_opaque = [three_color_mode](const pixel_type& t) {
+		return !three_color_mode || t.w() >= alpha_threshold;
+	};
+
+	// all texels are transparent by default
+	pixel_type endpoint_0(0);
+	pixel_type endpoint_1(0);
+	int32_t max_distance = -1;
+	for (size_t i = 0; i != texels.size(); ++i) {
+		if (!is_opaque(texels[i])) {
+			continue;
+		}
+		for (size_t j = i; j != texels.size(); ++j) {
+			if (!is_opaque(texels[j])) {
+				continue;
+			}
+			auto d = int32_t(rgb_distance_squared(texels[i].to<uint32_t>(), texels[j]));
+			if (d > max_distance) {
+				max_distance = d;
+				endpoint_0 = texels[i];
+				endpoint_1 = texels[j];
+			}
+		}
+	}
+
+	auto c_min = encode_rgb565(endpoint_0);
+	auto c_max = encode_rgb565(endpoint_1);
+	if (c_min > c_max) {
+		std::swap(c_min, c_max);
+	}
+
+	// four color mode is selected by c0 > c1, three color mode by c0 <= c1
+	auto c0 = three_color_mode ? c_min : c_max;
+	auto c1 = three_color_mode ? c_max : c_min;
+
+	auto p0 = decode_rgb565(c0);
+	auto p1 = decode_rgb565(c1);
+
+	std::array<r4::vector4<uint32_t>, 4> colors;
+	colors[0] = p0;
+	colors[1] = p1;
+	size_t num_colors = 4;
+	if (three_color_mode) {
+		colors[2] = (p0 + p1) / 2;
+		num_colors = 3;
+	} else {
+		colors[2] = (p0 * 2 + p1 + r4::vector4<uint32_t>(1)) / 3;
+		colors[3] = (p0 + p1 * 2 + r4::vector4<uint32_t>(1)) / 3;
+	}
+
+	uint32_t indices = 0;
+	for (size_t i = 0; i != texels.size(); ++i) {
+		const auto& t = texels[i];
+
+		uint32_t index = 3;
+		if (is_opaque(t)) {
+			index = 0;
+			auto best = rgb_distance_squared(colors[0], t);
+			for (uint32_t j = 1; j != num_colors; ++j) {
+				auto d = rgb_distance_squared(colors[j], t);
+				if (d < best) {
+					best = d;
+					index = j;
+				}
+			}
+		}
+
+		indices |= index << (i * 2);
+	}
+
+	// NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	out[0] = uint8_t(c0);
+	out[1] = uint8_t(c0 >> 8);
+	out[2] = uint8_t(c1);
+	out[3] = uint8_t(c1 >> 8);
+	for (unsigned i = 0; i != 4; ++i) {
+		out[4 + i] = uint8_t(indices >> (i * 8));
+	}
+	// NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+// encode alpha block in eight alpha mode, endpoints are the alpha range of the block
+void encode_alpha(const std::array<pixel_type, block_texels>& texels, uint8_t* out)
+{
+	uint32_t a0 = 0;
+	uint32_t a1 = std::numeric_limits<uint8_t>::max();
+	for (const auto& t : texels) {
+		a0 = std::max(a0, uint32_t(t.w()));
+		a1 = std::min(a1, uint32_t(t.w()));
+	}
+
+	uint64_t indices = 0;
+	if (a0 != a1) {
+		std::array<uint32_t, 8> alphas;
+		alphas[0] = a0;
+		alphas[1] = a1;
+		for (uint32_t i = 1; i != 7; ++i) {
+			alphas[i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7;
+		}
+
+		for (size_t i = 0; i != texels.size(); ++i) {
+			uint32_t index = 0;
+			auto best = std::numeric_limits<uint32_t>::max();
+			for (uint32_t j = 0; j != alphas.size(); ++j) {
+				auto d = uint32_t(std::abs(int32_t(alphas[j]) - int32_t(texels[i].w())));
+				if (d < best) {
+					best = d;
+					index = j;
+				}
+			}
+			indices |= uint64_t(index) << (i * 3);
+		}
+	}
+	// else all texels are a0
+
+	// NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	out[0] = uint8_t(a0);
+	out[1] = uint8_t(a1);
+	for (unsigned i = 0; i != 6; ++i) {
+		out[2 + i] = uint8_t(indices >> (i * 8));
+	}
+	// NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+template <block_format format>
+block_compressed_image<format> compress(const rasterimage::image<uint8_t, 4>& image)
+{
+	using image_type = block_compressed_image<format>;
+
+	auto dims = image.dims();
+	auto block_dims = (dims + r4::vector2<uint32_t>(block_dim - 1)) / block_dim;
+
+	std::vector<uint8_t> data(size_t(block_dims.x()) * block_dims.y() * image_type::block_size);
+
+	auto out = data.data();
+	for (uint32_t by = 0; by != block_dims.y(); ++by) {
+		for (uint32_t bx = 0; bx != block_dims.x(); ++bx) {
+			// partial blocks are padded with the edge texels
+			std::array<pixel_type, block_texels> texels;
+			for (uint32_t i = 0; i != texels.size(); ++i) {
+				auto x = std::min(bx * block_dim + i % block_dim, dims.x() - 1);
+				auto y = std::min(by * block_dim + i / block_dim, dims.y() - 1);
+				texels[i] = image[y][x];
+			}
+
+			if constexpr (format == block_format::bc1) {
+				bool has_transparent = std::any_of(texels.begin(), texels.end(), [](const auto& t) {
+					return t.w() < alpha_threshold;
+				});
+				encode_color(texels, has_transparent, out);
+			} else {
+				constexpr auto alpha_block_size = 8;
+				encode_alpha(texels, out);
+				// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+				encode_color(texels, false, out + alpha_block_size);
+			}
+
+			std::advance(out, image_type::block_size);
+		}
+	}
+
+	return {dims, std::move(data)};
+}
+} // namespace
+
+bc1_image cpugl::compress_bc1(const rasterimage::image<uint8_t, 4>& image)
+{
+	return compress<block_format::bc1>(image);
+}
+
+bc3_image cpugl::compress_bc3(const rasterimage::image<uint8_t, 4>& image)
+{
+	return compress<block_format::bc3>(image);
+}
+
+palette_image::palette_image(
+	r4::vector2<uint32_t> dims,
+	utki::span<const pixel_type> palette,
+	std::vector<uint8_t> indices
+) :
+	dimensions(dims),
+	indices(std::move(indices))
+{
+	if (palette.size() > max_colors) {
+		throw std::invalid_argument("palette_image: too many palette entries");
+	}
+	if (this->indices.size() != size_t(dims.x()) * dims.y()) {
+		throw std::invalid_argument("palette_image: number of indices does not match dimensions");
+	}
+	if (std::any_of(this->indices.begin(), this->indices.end(), [&palette](auto i) {
+			return i >= palette.size();
+		}))
+	{
+		throw std::invalid_argument("palette_image: index is out of palette");
+	}
+
+	std::copy(palette.begin(), palette.end(), this->palette.begin());
+}
+
+palette_image cpugl::make_palette_image(const rasterimage::image<uint8_t, 4>& image)
+{
+	auto key = [](const pixel_type& p) {
+		return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+	};
+
+	std::vector<pixel_type> palette;
+	std::unordered_map<uint32_t, uint8_t> color_indices;
+
+	std::vector<uint8_t> indices;
+	indices.reserve(size_t(image.dims().x()) * image.dims().y());
+
+	for (uint32_t y = 0; y != image.dims().y(); ++y) {
+		for (const auto& p : image[y]) {
+			auto [i, inserted] = color_indices.try_emplace(key(p), uint8_t(palette.size()));
+			if (inserted) {
+				if (palette.size() == palette_image::max_colors) {
+					throw std::invalid_argument("make_palette_image(): image has too many colors");
+				}
+				palette.push_back(p);
+			}
+			indices.push_back(i->second);
+		}
+	}
+
+	return {image.dims(), palette, std::move(indices)};
+}
@@ -0,0 +1,318 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <array>
+#include <limits>
+#include <stdexcept>
+#include <variant>
+#include <vector>
+
+#include <rasterimage/image.hpp>
+#include <utki/span.hpp>
+
+#include "texture.hpp"
+
+namespace cpugl {
+
+// Block compression formats, texels are stored in 4x4 blocks.
+enum class block_format {
+	// RGB in 8 bytes per block with 1 bit alpha, 8:1 compression of RGBA8
+	bc1,
+
+	// RGBA in 16 bytes per block with interpolated alpha, 4:1 compression of RGBA8
+	bc3
+};
+
+// Image which stays block compressed in memory, blocks are decoded on access.
+// Blocks go in row-major order, partial blocks at right and bottom edges have undefined texels outside of the image.
+template <block_format format>
+class block_compressed_image
+{
+public:
+	using pixel_type = r4::vector4<uint8_t>;
+
+	constexpr static uint32_t block_dim = 4;
+	constexpr static size_t block_size = format == block_format::bc1 ? 8 : 16;
+
+	using decoded_block_type = std::array<pixel_type, size_t(block_dim) * block_dim>;
+
+private:
+	r4::vector2<uint32_t> dimensions{0, 0};
+	r4::vector2<uint32_t> block_dims{0, 0};
+
+	std::vector<uint8_t> data;
+
+	static pixel_type decode_rgb565(uint16_t c) noexcept
+	{
+		auto r = uint8_t((c >> 11) & 0x1f);
+		auto g = uint8_t((c >> 5) & 0x3f);
+		auto b = uint8_t(c & 0x1f);
+		return {
+			uint8_t((r << 3) | (r >> 2)),
+			uint8_t((g << 2) | (g >> 4)),
+			uint8_t((b << 3) | (b >> 2)),
+			std::numeric_limits<uint8_t>::max()
+		};
+	}
+
+	// decodes RGB part of a block, three color mode with transparent black is only used by BC1
+	static void decode_color(const uint8_t* block, bool allow_three_colors, decoded_block_type& out) noexcept
+	{
+		// NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		auto c0 = uint16_t(block[0] | (block[1] << 8));
+		auto c1 = uint16_t(block[2] | (block[3] << 8));
+		auto indices = uint32_t(block[4]) | (uint32_t(block[5]) << 8) | (uint32_t(block[6]) << 16) |
+			(uint32_t(block[7]) << 24);
+		// NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+		std::array<pixel_type, 4> colors;
+		colors[0] = decode_rgb565(c0);
+		colors[1] = decode_rgb565(c1);
+
+		auto p0 = colors[0].to<uint32_t>();
+		auto p1 = colors[1].to<uint32_t>();
+
+		if (c0 > c1 || !allow_three_colors) {
+			colors[2] = ((p0 * 2 + p1 + r4::vector4<uint32_t>(1)) / 3).to<uint8_t>();
+			colors[3] = ((p0 + p1 * 2 + r4::vector4<uint32_t>(1)) / 3).to<uint8_t>();
+		} else {
+			colors[2] = ((p0 + p1) / 2).to<uint8_t>();
+			colors[3] = {0, 0, 0, 0};
+		}
+
+		for (auto& t : out) {
+			t = colors[indices & 0x3];
+			indices >>= 2;
+		}
+	}
+
+	static void decode_alpha(const uint8_t* block, decoded_block_type& out) noexcept
+	{
+		// NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		uint32_t a0 = block[0];
+		uint32_t a1 = block[1];
+		uint64_t indices = 0;
+		for (unsigned i = 0; i != 6; ++i) {
+			indices |= uint64_t(block[2 + i]) << (i * 8);
+		}
+		// NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+		std::array<uint8_t, 8> alphas;
+		alphas[0] = uint8_t(a0);
+		alphas[1] = uint8_t(a1);
+		if (a0 > a1) {
+			for (uint32_t i = 1; i != 7; ++i) {
+				alphas[i + 1] = uint8_t(((7 - i) * a0 + i * a1 + 3) / 7);
+			}
+		} else {
+			for (uint32_t i = 1; i != 5; ++i) {
+				alphas[i + 1] = uint8_t(((5 - i) * a0 + i * a1 + 2) / 5);
+			}
+			alphas[6] = 0;
+			alphas[7] = std::numeric_limits<uint8_t>::max();
+		}
+
+		for (auto& t : out) {
+			t.w() = alphas[indices & 0x7];
+			indices >>= 3;
+		}
+	}
+
+public:
+	block_compressed_image() = default;
+
+	// throws std::invalid_argument if the data size does not match the dimensions
+	block_compressed_image(r4::vector2<uint32_t> dims, std::vector<uint8_t> data) :
+		dimensions(dims),
+		block_dims((dims + r4::vector2<uint32_t>(block_dim - 1)) / block_dim),
+		data(std::move(data))
+	{
+		if (this->data.size() != size_t(this->block_dims.x()) * this->block_dims.y() * block_size) {
+			throw std::invalid_argument("block_compressed_image: data size does not match dimensions");
+		}
+	}
+
+	const r4::vector2<uint32_t>& dims() const noexcept
+	{
+		return this->dimensions;
+	}
+
+	// dimensions in blocks
+	const r4::vector2<uint32_t>& get_block_dims() const noexcept
+	{
+		return this->block_dims;
+	}
+
+	utki::span<const uint8_t> get_data() const noexcept
+	{
+		return this->data;
+	}
+
+	void decode_block(r4::vector2<uint32_t> pos, decoded_block_type& out) const noexcept
+	{
+		ASSERT(pos.x() < this->block_dims.x() && pos.y() < this->block_dims.y())
+
+		const uint8_t* block = std::next(
+			this->data.data(),
+			ptrdiff_t((size_t(pos.y()) * this->block_dims.x() + pos.x()) * block_size)
+		);
+
+		if constexpr (format == block_format::bc1) {
+			decode_color(block, true, out);
+		} else {
+			constexpr auto alpha_block_size = 8;
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+			decode_color(block + alpha_block_size, false, out);
+			decode_alpha(block, out);
+		}
+	}
+};
+
+using bc1_image = block_compressed_image<block_format::bc1>;
+using bc3_image = block_compressed_image<block_format::bc3>;
+
+// Compress the image, endpoints of each block are its two most distant colors.
+// BC1 texels with alpha less than 128 become transparent black, otherwise alpha is dropped.
+bc1_image compress_bc1(const rasterimage::image<uint8_t, 4>& image);
+bc3_image compress_bc3(const rasterimage::image<uint8_t, 4>& image);
+
+// Image with up to 256 colors, 1 byte palette index per texel.
+class palette_image
+{
+public:
+	using pixel_type = r4::vector4<uint8_t>;
+
+	constexpr static size_t max_colors = size_t(std::numeric_limits<uint8_t>::max()) + 1;
+
+private:
+	r4::vector2<uint32_t> dimensions{0, 0};
+
+	std::array<pixel_type, max_colors> palette{};
+
+	std::vector<uint8_t> indices;
+
+public:
+	palette_image() = default;
+
+	// throws std::invalid_argument if there are more than max_colors palette entries,
+	// the number of indices does not match the dimensions or an index is out of the palette
+	palette_image(r4::vector2<uint32_t> dims, utki::span<const pixel_type> palette, std::vector<uint8_t> indices);
+
+	const r4::vector2<uint32_t>& dims() const noexcept
+	{
+		return this->dimensions;
+	}
+
+	const std::array<pixel_type, max_colors>& get_palette() const noexcept
+	{
+		return this->palette;
+	}
+
+	const pixel_type& get(r4::vector2<uint32_t> pos) const noexcept
+	{
+		ASSERT(pos.x() < this->dimensions.x() && pos.y() < this->dimensions.y())
+		return this->palette[this->indices[size_t(pos.y()) * this->dimensions.x() + pos.x()]];
+	}
+};
+
+// Convert the image to palette image without loss.
+// Throws std::invalid_argument if the image has more than palette_image::max_colors different colors.
+palette_image make_palette_image(const rasterimage::image<uint8_t, 4>& image);
+
+// Texture sampling block compressed image.
+// Only the sampled block is decoded, recently decoded blocks are kept in a small cache,
+// so neighbouring fragments mostly hit the same decoded block.
+// The cache is not synchronized, the texture object must not be used by several threads at once.
+template <block_format format>
+class texture<block_compressed_image<format>>
+{
+	using image_type = block_compressed_image<format>;
+
+	constexpr static uint32_t invalid_block = std::numeric_limits<uint32_t>::max();
+
+	// number of cached blocks, must be power of 2
+	constexpr static uint32_t cache_size = 16;
+
+	const image_type& image;
+	r4::vector2<real> dims;
+
+	struct cached_block {
+		uint32_t index = invalid_block;
+		image_type::decoded_block_type texels;
+	};
+
+	mutable std::array<cached_block, cache_size> cache;
+
+public:
+	texture(const image_type& image) :
+		image(image),
+		dims(image.dims().template to<real>())
+	{}
+
+	// returned reference is valid until next get() call
+	const image_type::pixel_type& get(const r4::vector2<real>& tex_coords) const
+	{
+		auto tc = calc_texel_position(this->dims, this->image.dims(), tex_coords);
+
+		auto block_pos = tc / image_type::block_dim;
+		auto index = block_pos.y() * this->image.get_block_dims().x() + block_pos.x();
+
+		// direct mapped, horizontally adjacent blocks go to different entries
+		auto& entry = this->cache[index % cache_size];
+		if (entry.index != index) {
+			this->image.decode_block(block_pos, entry.texels);
+			entry.index = index;
+		}
+
+		auto in_block = tc - block_pos * image_type::block_dim;
+		return entry.texels[in_block.y() * image_type::block_dim + in_block.x()];
+	}
+};
+
+template <>
+class texture<palette_image>
+{
+	const palette_image& image;
+	r4::vector2<real> dims;
+
+public:
+	texture(const palette_image& image) :
+		image(image),
+		dims(image.dims().template to<real>())
+	{}
+
+	const palette_image::pixel_type& get(const r4::vector2<real>& tex_coords) const
+	{
+		return this->image.get(calc_texel_position(this->dims, this->image.dims(), tex_coords));
+	}
+};
+
+// Compressed images which can be used as texture.
+using compressed_image_variant = std::variant<bc1_image, bc3_image, palette_image>;
+
+} // namespace cpugl
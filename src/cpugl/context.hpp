@@ -26,40 +26,446 @@ SOFTWARE.
 
 #pragma once
 
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+
 #include <r4/segment2.hpp>
 #include <rasterimage/image.hpp>
+#include <utki/debug.hpp>
 #include <utki/types.hpp>
 
 #include "config.hpp"
+#include "executor.hpp"
+#include "frame_arena.hpp"
+#include "hi_z.hpp"
+#include "kernels.hpp"
+#include "rectangle.hpp"
+#include "stencil.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
 
 namespace cpugl {
 
+// Number of pixels per fragment program invocation.
+// At coarse rates the fragment program is invoked once per block of covered pixels of a triangle
+// and the result is written to all of them. Coverage, stencil and depth tests are still done per pixel.
+enum class shading_rate {
+	one_per_pixel = 1,
+	one_per_2x2 = 2,
+	one_per_4x4 = 4
+};
+
 class context
 {
 public:
 	using fb_image_type = rasterimage::image<uint8_t, 4>;
+	using fb_span_type = rasterimage::image_span<uint8_t, 4>;
+
+	using stencil_image_type = rasterimage::image<uint8_t, 1>;
+	using stencil_span_type = rasterimage::image_span<uint8_t, 1>;
+
+	using depth_image_type = rasterimage::image<float, 1>;
+	using depth_span_type = rasterimage::image_span<float, 1>;
 
 private:
-	fb_image_type* framebuffer = nullptr;
+	// framebuffer memory is owned by the user of the context, e.g. fb_image_type object or a presenter
+	fb_span_type framebuffer;
+
+	// stencil buffer memory is owned by the user of the context, same as framebuffer's
+	stencil_span_type stencil_buffer;
+
+	stencil_state stencil;
+
+	// depth buffer memory is owned by the user of the context, same as framebuffer's
+	depth_span_type depth_buffer;
+
+	// coarse level of the depth buffer, maintained by the context and the pipeline
+	hi_z_buffer hi_z;
+
+	const kernel_set* kernels = &get_kernel_set(get_default_isa());
+
+	// thread pool is owned by the user of the context, it can be shared by several contexts
+	thread_pool* pool = nullptr;
+
+	real line_width = 1;
+	real point_size = 1;
+
+	cpugl::shading_rate rate = cpugl::shading_rate::one_per_pixel;
+
+	std::optional<rectangle> redraw_region;
+
+	std::optional<rectangle> scissor;
+
+	// framebuffer area which rendering is allowed to touch
+	rectangle render_area{{0, 0}, {0, 0}};
+
+	// union of framebuffer areas touched by rendering since last reset_damage()
+	rectangle damage{{0, 0}, {0, 0}};
+
+	void update_render_area()
+	{
+		this->render_area = {{0, 0}, this->framebuffer.dims()};
+
+		if (this->redraw_region.has_value()) {
+			this->render_area = intersect(this->render_area, this->redraw_region.value());
+		}
+
+		if (this->scissor.has_value()) {
+			this->render_area = intersect(this->render_area, this->scissor.value());
+		}
+	}
+
+	// memory for transient data of draw calls between begin_frame() and end_frame(), reset by end_frame()
+	frame_arena arena;
+
+	bool in_frame = false;
+
+	// recording does not change the rendering state, so it is allowed through const context
+	mutable tracer traces;
+
+	// Runs submitted commands, created on first submit().
+	// Declared last, so that it is destroyed first and pending commands finish while the rest of the context is alive.
+	std::unique_ptr<executor> worker;
 
 public:
+	context() = default;
+
+	// submitted commands refer to the context, so it cannot be copied or moved
+	context(const context&) = delete;
+	context& operator=(const context&) = delete;
+
+	context(context&&) = delete;
+	context& operator=(context&&) = delete;
+
+	~context() = default;
+
+	void set_framebuffer(const fb_span_type& fb)
+	{
+		this->framebuffer = fb;
+		this->update_render_area();
+	}
+
 	void set_framebuffer(fb_image_type& fb)
 	{
-		this->framebuffer = &fb;
+		this->set_framebuffer(fb.span());
 	}
 
-	void clear(fb_image_type::pixel_type color)
+	// clears render area, see get_render_area()
+	void clear(fb_span_type::pixel_type color)
 	{
-		if (!this->framebuffer) {
+		CPUGL_TRACE_SCOPE(this->traces, "clear");
+
+		if (is_empty(this->render_area)) {
 			return;
 		}
-		this->framebuffer->span().clear(color);
+		for (auto row : this->framebuffer.subspan(this->render_area)) {
+			this->kernels->fill(
+				// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+				reinterpret_cast<uint8_t*>(row.data()),
+				row.size(),
+				color.data()
+			);
+		}
+		this->add_damage(this->render_area);
 	}
 
-	fb_image_type& get_framebuffer()
+	const fb_span_type& get_framebuffer() const noexcept
 	{
-		ASSERT(this->framebuffer)
-		return *this->framebuffer;
+		return this->framebuffer;
+	}
+
+	// Restrict rendering to the given framebuffer region.
+	// Used for partial redraw of the framebuffer, e.g. redrawing only the damaged area of previous frame.
+	void set_redraw_region(const rectangle& region)
+	{
+		this->redraw_region = region;
+		this->update_render_area();
+	}
+
+	void reset_redraw_region()
+	{
+		this->redraw_region.reset();
+		this->update_render_area();
+	}
+
+	// Pixels outside of the scissor rectangle are not touched by rendering and clearing.
+	void set_scissor(const rectangle& rect)
+	{
+		this->scissor = rect;
+		this->update_render_area();
+	}
+
+	void reset_scissor()
+	{
+		this->scissor.reset();
+		this->update_render_area();
+	}
+
+	const std::optional<rectangle>& get_scissor() const noexcept
+	{
+		return this->scissor;
+	}
+
+	// Framebuffer area which rendering is allowed to touch.
+	// It is the whole framebuffer intersected with redraw region and scissor rectangle, if set.
+	const rectangle& get_render_area() const noexcept
+	{
+		return this->render_area;
+	}
+
+	// Add rectangle to the damaged area.
+	// Rendering adds bounding boxes of rasterized primitives, clipped by the render area.
+	void add_damage(const rectangle& rect)
+	{
+		this->damage = unite(this->damage, rect);
+	}
+
+	// Get bounding rectangle of all framebuffer areas touched by rendering since last reset_damage().
+	// Presenters can use it to update only changed pixels.
+	const rectangle& get_damage() const noexcept
+	{
+		return this->damage;
+	}
+
+	void reset_damage()
+	{
+		this->damage = {{0, 0}, {0, 0}};
+	}
+
+	// Stencil buffer must have same dimensions as the framebuffer.
+	void set_stencil_buffer(const stencil_span_type& sb)
+	{
+		this->stencil_buffer = sb;
+	}
+
+	void set_stencil_buffer(stencil_image_type& sb)
+	{
+		this->set_stencil_buffer(sb.span());
+	}
+
+	const stencil_span_type& get_stencil_buffer() const noexcept
+	{
+		return this->stencil_buffer;
+	}
+
+	// clears render area of the stencil buffer, see get_render_area()
+	void clear_stencil(uint8_t value)
+	{
+		CPUGL_TRACE_SCOPE(this->traces, "clear stencil");
+
+		if (is_empty(this->render_area) || this->stencil_buffer.dims().x() == 0) {
+			return;
+		}
+		ASSERT(this->stencil_buffer.dims() == this->framebuffer.dims())
+		this->stencil_buffer.subspan(this->render_area).clear(stencil_span_type::pixel_type{value});
+	}
+
+	void set_stencil_state(const stencil_state& state)
+	{
+		this->stencil = state;
+	}
+
+	const stencil_state& get_stencil_state() const noexcept
+	{
+		return this->stencil;
+	}
+
+	// stencil test is performed only if it is enabled and stencil buffer is set
+	bool is_stencil_test_enabled() const noexcept
+	{
+		return this->stencil.enabled && this->stencil_buffer.dims().x() != 0;
+	}
+
+	// Depth buffer must have same dimensions as the framebuffer.
+	// The depth buffer must only be modified through the context, otherwise the hierarchical depth buffer
+	// becomes out of sync. Depth values are unknown until clear_depth() is called.
+	void set_depth_buffer(const depth_span_type& db)
+	{
+		this->depth_buffer = db;
+		this->hi_z.resize(db.dims());
+	}
+
+	void set_depth_buffer(depth_image_type& db)
+	{
+		this->set_depth_buffer(db.span());
+	}
+
+	const depth_span_type& get_depth_buffer() const noexcept
+	{
+		return this->depth_buffer;
+	}
+
+	// depth test is performed by pipeline's render functions with depth_test = true, if depth buffer is set
+	bool has_depth_buffer() const noexcept
+	{
+		return this->depth_buffer.dims().x() != 0;
+	}
+
+	// clears render area of the depth buffer, see get_render_area()
+	void clear_depth(float value)
+	{
+		CPUGL_TRACE_SCOPE(this->traces, "clear depth");
+
+		if (is_empty(this->render_area) || !this->has_depth_buffer()) {
+			return;
+		}
+		ASSERT(this->depth_buffer.dims() == this->framebuffer.dims())
+		this->depth_buffer.subspan(this->render_area).clear(depth_span_type::pixel_type{value});
+		this->hi_z.clear(this->render_area, value);
+	}
+
+	const hi_z_buffer& get_hi_z() const noexcept
+	{
+		return this->hi_z;
+	}
+
+	hi_z_buffer& get_hi_z() noexcept
+	{
+		return this->hi_z;
+	}
+
+	// Select instruction set of the kernels used by the context.
+	// By default the best one supported by the CPU is used, see get_default_isa().
+	// Throws std::invalid_argument if the instruction set is not supported.
+	void set_isa(isa i)
+	{
+		this->kernels = &get_kernel_set(i);
+	}
+
+	const kernel_set& get_kernels() const noexcept
+	{
+		return *this->kernels;
+	}
+
+	// Set thread pool used for data parallel rendering stages, e.g. vertex processing.
+	// nullptr means that all rendering is done on the calling thread, which is the default.
+	void set_thread_pool(thread_pool* pool) noexcept
+	{
+		this->pool = pool;
+	}
+
+	thread_pool* get_thread_pool() const noexcept
+	{
+		return this->pool;
+	}
+
+	// Frame scoping of transient memory of draw calls, e.g. processed vertices and visibility buffer draws.
+	// Between begin_frame() and end_frame() the memory is taken from the frame arena and is released all at once
+	// by end_frame(), so that steady state rendering does not allocate from the heap.
+	// Outside of a frame the memory is allocated from the heap and released when no longer used.
+	void begin_frame()
+	{
+		ASSERT(!this->in_frame)
+		this->in_frame = true;
+	}
+
+	// Must be called at the end of each frame begun with begin_frame(), when no rendering is in progress and
+	// the visibility buffers are resolved. Releases transient memory of the frame's draw calls for reuse
+	// by the next frame.
+	void end_frame()
+	{
+		ASSERT(this->in_frame)
+		this->arena.reset();
+		this->in_frame = false;
+	}
+
+	bool is_in_frame() const noexcept
+	{
+		return this->in_frame;
+	}
+
+	frame_arena& get_frame_arena() noexcept
+	{
+		return this->arena;
+	}
+
+	// Allocator for transient memory of draw calls,
+	// allocates from the frame arena within a frame and from the heap otherwise, see begin_frame().
+	frame_arena::allocator<std::byte> get_frame_allocator() noexcept
+	{
+		return {this->in_frame ? &this->arena : nullptr};
+	}
+
+	// Timeline of rendering stages, recorded only if the library and the code using pipeline are
+	// compiled with CPUGL_TRACE defined.
+	tracer& get_tracer() const noexcept
+	{
+		return this->traces;
+	}
+
+	// Write the timeline in Chrome trace event format, to be viewed in Perfetto UI or chrome://tracing.
+	// Must not be called while rendering is in progress.
+	void write_trace(std::ostream& out) const
+	{
+		this->traces.write_chrome_trace(out);
+	}
+
+	// width of lines in pixels, rounded to integer, at least 1 pixel
+	void set_line_width(real width)
+	{
+		this->line_width = width;
+	}
+
+	real get_line_width() const noexcept
+	{
+		return this->line_width;
+	}
+
+	// size of point's square side in pixels
+	void set_point_size(real size)
+	{
+		this->point_size = size;
+	}
+
+	real get_point_size() const noexcept
+	{
+		return this->point_size;
+	}
+
+	// Shading rate of triangles of subsequent draws, lines and points are always shaded per pixel.
+	// Can be changed between draws to use coarse shading only for the draws which tolerate it,
+	// e.g. smooth gradients or blurred backgrounds.
+	void set_shading_rate(cpugl::shading_rate rate) noexcept
+	{
+		this->rate = rate;
+	}
+
+	cpugl::shading_rate get_shading_rate() const noexcept
+	{
+		return this->rate;
+	}
+
+	// Render asynchronously.
+	// The commands are invoked with this context as argument on a worker thread, in submission order,
+	// so that the caller can prepare the next frame or present the previous one meanwhile.
+	// Until the returned future is ready, the caller must not use the context or the framebuffer,
+	// except for calling submit() and finish().
+	// Exception thrown by the commands is rethrown by the future's get().
+	std::future<void> submit(std::function<void(context&)> commands)
+	{
+		if (!this->worker) {
+			this->worker = std::make_unique<executor>();
+		}
+
+		std::packaged_task<void()> task([this, commands = std::move(commands)]() {
+			CPUGL_TRACE_SCOPE(this->traces, "submitted commands");
+			commands(*this);
+		});
+		auto ret = task.get_future();
+		this->worker->post(std::move(task));
+		return ret;
+	}
+
+	// wait until all submitted commands are done
+	void finish()
+	{
+		if (!this->worker) {
+			return;
+		}
+		CPUGL_TRACE_SCOPE(this->traces, "finish");
+		this->submit([](context&) {}).wait();
 	}
 };
 
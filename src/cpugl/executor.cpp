@@ -0,0 +1,76 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "executor.hpp"
+
+using namespace cpugl;
+
+executor::executor() :
+	thread([this]() {
+		this->run();
+	})
+{}
+
+executor::~executor()
+{
+	{
+		std::lock_guard lock(this->mutex);
+		this->quit = true;
+	}
+	this->cond_var.notify_one();
+	this->thread.join();
+}
+
+void executor::post(std::packaged_task<void()> task)
+{
+	{
+		std::lock_guard lock(this->mutex);
+		this->tasks.push_back(std::move(task));
+	}
+	this->cond_var.notify_one();
+}
+
+void executor::run()
+{
+	for (;;) {
+		std::packaged_task<void()> task;
+		{
+			std::unique_lock lock(this->mutex);
+			this->cond_var.wait(lock, [this]() {
+				return this->quit || !this->tasks.empty();
+			});
+			if (this->tasks.empty()) {
+				// quit is requested and all tasks are done
+				return;
+			}
+			task = std::move(this->tasks.front());
+			this->tasks.pop_front();
+		}
+
+		// exceptions are stored in the task's future
+		task();
+	}
+}
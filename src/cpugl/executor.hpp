@@ -0,0 +1,65 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace cpugl {
+
+// Runs tasks one by one, in the order they were posted, on a dedicated thread.
+class executor
+{
+	std::mutex mutex;
+	std::condition_variable cond_var;
+	std::deque<std::packaged_task<void()>> tasks;
+	bool quit = false;
+
+	// must be initialized after all other members
+	std::thread thread;
+
+	void run();
+
+public:
+	executor();
+
+	executor(const executor&) = delete;
+	executor& operator=(const executor&) = delete;
+
+	executor(executor&&) = delete;
+	executor& operator=(executor&&) = delete;
+
+	// runs all pending tasks before returning
+	~executor();
+
+	void post(std::packaged_task<void()> task);
+};
+
+} // namespace cpugl
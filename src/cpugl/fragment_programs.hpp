@@ -0,0 +1,116 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <type_traits>
+
+#include "mesh.hpp"
+
+namespace cpugl {
+
+// Compile-time properties of a fragment program.
+// A fragment program type declares them as static constexpr bool members, missing members take default values.
+template <typename fragment_program_type>
+struct fragment_program_traits {
+private:
+	template <typename type>
+	constexpr static bool get_constant_output()
+	{
+		if constexpr (requires { type::constant_output; }) {
+			return type::constant_output;
+		} else {
+			return false;
+		}
+	}
+
+	template <typename type>
+	constexpr static bool get_uses_attributes()
+	{
+		if constexpr (requires { type::uses_attributes; }) {
+			return type::uses_attributes;
+		} else {
+			return true;
+		}
+	}
+
+	template <typename type>
+	constexpr static bool get_blended()
+	{
+		if constexpr (requires { type::blended; }) {
+			return type::blended;
+		} else {
+			return false;
+		}
+	}
+
+public:
+	// The fragment program returns same value for all fragments of a primitive.
+	// The pipeline invokes it once per primitive, with attributes of the primitive's first vertex,
+	// and stores the result to all covered pixels, in all rasterization paths.
+	constexpr static bool constant_output = get_constant_output<std::remove_cvref_t<fragment_program_type>>();
+
+	// If false, the pipeline does not interpolate attributes and invokes the fragment program without arguments.
+	constexpr static bool uses_attributes = get_uses_attributes<std::remove_cvref_t<fragment_program_type>>();
+
+	// Fragments are blended into the framebuffer with their alpha instead of replacing the pixels, see blend().
+	constexpr static bool blended = get_blended<std::remove_cvref_t<fragment_program_type>>();
+};
+
+// Fragment program which outputs the same color for all fragments.
+struct constant_color_fragment_program {
+	constexpr static bool constant_output = true;
+	constexpr static bool uses_attributes = false;
+
+	color_type color;
+
+	const color_type& operator()() const noexcept
+	{
+		return this->color;
+	}
+};
+
+// Fragment program which outputs color of the first vertex of a primitive for all its fragments.
+struct flat_color_fragment_program {
+	constexpr static bool constant_output = true;
+
+	const color_type& operator()(const color_type& color) const noexcept
+	{
+		return color;
+	}
+};
+
+// Fragment program which outputs interpolated vertex color as is.
+// The pipeline recognizes it and, for triangles which need no perspective correction,
+// interpolates the color in fixed point and stores it to the framebuffer without float conversion.
+struct gouraud_fragment_program {
+	color_type operator()(const color_type& color) const noexcept
+	{
+		return color;
+	}
+};
+
+} // namespace cpugl
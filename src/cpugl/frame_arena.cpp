@@ -0,0 +1,175 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "frame_arena.hpp"
+
+#include <algorithm>
+#include <array>
+
+#include <utki/debug.hpp>
+
+using namespace cpugl;
+
+namespace {
+std::atomic<uint64_t> next_epoch{1};
+
+uint64_t make_epoch()
+{
+	return next_epoch.fetch_add(1, std::memory_order_relaxed);
+}
+
+// current chunk of the thread in an arena
+struct cursor {
+	uint64_t epoch = 0;
+	std::byte* pos = nullptr;
+	std::byte* end = nullptr;
+};
+
+// a thread can allocate from several arenas, e.g. of different contexts
+constexpr size_t max_thread_cursors = 4;
+
+struct thread_cursors {
+	std::array<cursor, max_thread_cursors> cursors;
+	size_t next_replaced = 0;
+
+	cursor& get(uint64_t epoch)
+	{
+		for (auto& c : this->cursors) {
+			if (c.epoch == epoch) {
+				return c;
+			}
+		}
+
+		auto& c = this->cursors[this->next_replaced];
+		this->next_replaced = (this->next_replaced + 1) % this->cursors.size();
+		c = {.epoch = epoch};
+		return c;
+	}
+};
+
+thread_local thread_cursors cur_thread_cursors;
+
+std::byte* align_up(std::byte* p, size_t alignment)
+{
+	auto addr = reinterpret_cast<uintptr_t>(p); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	auto aligned = (addr + alignment - 1) & ~(uintptr_t(alignment) - 1);
+	return std::next(p, ptrdiff_t(aligned - addr));
+}
+} // namespace
+
+frame_arena::frame_arena(size_t chunk_size) :
+	chunk_size(chunk_size),
+	epoch(make_epoch())
+{}
+
+void* frame_arena::allocate(size_t size, size_t alignment)
+{
+	ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0)
+
+	auto& c = cur_thread_cursors.get(this->epoch.load(std::memory_order_relaxed));
+
+	if (c.pos) {
+		auto p = align_up(c.pos, alignment);
+		if (p <= c.end && size_t(c.end - p) >= size) {
+			c.pos = std::next(p, ptrdiff_t(size));
+			return p;
+		}
+	}
+
+	return this->allocate_from_new_chunk(size, alignment);
+}
+
+void* frame_arena::allocate_from_new_chunk(size_t size, size_t alignment)
+{
+	// chunk memory is aligned for any fundamental type, bigger alignment may need extra space
+	size_t needed = size + (alignment > alignof(std::max_align_t) ? alignment : 0);
+
+	std::byte* data = nullptr;
+	size_t data_size = 0;
+	{
+		std::lock_guard lock(this->mutex);
+
+		auto i = std::find_if(this->free_chunks.begin(), this->free_chunks.end(), [needed](const chunk& ch) {
+			return ch.size >= needed;
+		});
+
+		if (i != this->free_chunks.end()) {
+			this->used_chunks.push_back(std::move(*i));
+			this->free_chunks.erase(i);
+		} else {
+			// requests bigger than the chunk size get a dedicated chunk
+			auto new_size = std::max(needed, this->chunk_size);
+			this->used_chunks.push_back({
+				// NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays)
+				.data = std::make_unique_for_overwrite<std::byte[]>(new_size),
+				.size = new_size
+			});
+		}
+
+		data = this->used_chunks.back().data.get();
+		data_size = this->used_chunks.back().size;
+	}
+
+	auto& c = cur_thread_cursors.get(this->epoch.load(std::memory_order_relaxed));
+
+	auto p = align_up(data, alignment);
+	auto end = std::next(data, ptrdiff_t(data_size));
+
+	// the rest of the previous chunk is abandoned, unless the new chunk has less space left
+	auto new_pos = std::next(p, ptrdiff_t(size));
+	if (!c.pos || end - new_pos >= c.end - c.pos) {
+		c.pos = new_pos;
+		c.end = end;
+	}
+
+	return p;
+}
+
+void frame_arena::reset()
+{
+	std::lock_guard lock(this->mutex);
+
+	this->epoch.store(make_epoch(), std::memory_order_relaxed);
+
+	for (auto& ch : this->used_chunks) {
+		this->free_chunks.push_back(std::move(ch));
+	}
+	this->used_chunks.clear();
+}
+
+size_t frame_arena::get_capacity()
+{
+	std::lock_guard lock(this->mutex);
+
+	size_t ret = 0;
+	for (const auto& ch : this->used_chunks) {
+		ret += ch.size;
+	}
+	for (const auto& ch : this->free_chunks) {
+		ret += ch.size;
+	}
+	return ret;
+}
@@ -0,0 +1,151 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace cpugl {
+
+// Bump allocator for transient per-frame data.
+// Memory is taken from chunks which are kept for reuse when the arena is reset, so once the chunks are
+// allocated during first frames, steady state rendering does not allocate from the heap.
+// Each thread allocates from its own chunk, so allocation does not need locking, except for taking a new chunk.
+// Objects allocated from the arena are not destroyed by the arena.
+class frame_arena
+{
+public:
+	constexpr static size_t default_chunk_size = size_t(1) << 20;
+
+private:
+	struct chunk {
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays)
+		std::unique_ptr<std::byte[]> data;
+		size_t size;
+	};
+
+	const size_t chunk_size;
+
+	// protects the chunk lists
+	std::mutex mutex;
+
+	std::vector<chunk> used_chunks;
+	std::vector<chunk> free_chunks;
+
+	// Unique among all arenas and changed by reset(),
+	// so that threads can tell that their current chunk is not valid anymore.
+	std::atomic<uint64_t> epoch;
+
+	void* allocate_from_new_chunk(size_t size, size_t alignment);
+
+public:
+	explicit frame_arena(size_t chunk_size = default_chunk_size);
+
+	frame_arena(const frame_arena&) = delete;
+	frame_arena& operator=(const frame_arena&) = delete;
+
+	frame_arena(frame_arena&&) = delete;
+	frame_arena& operator=(frame_arena&&) = delete;
+
+	~frame_arena() = default;
+
+	// thread safe
+	void* allocate(size_t size, size_t alignment);
+
+	// Construct object in the arena memory.
+	// The arena does not call the destructor, it is up to the caller to destroy the object before reset().
+	template <typename object_type, typename... arg_type>
+	object_type* make(arg_type&&... args)
+	{
+		return new (this->allocate(sizeof(object_type), alignof(object_type)))
+			object_type(std::forward<arg_type>(args)...);
+	}
+
+	// Make all the memory allocated from the arena available for reuse.
+	// Must not be called while other threads allocate from the arena.
+	void reset();
+
+	// total size of the chunks owned by the arena
+	size_t get_capacity();
+
+	// Standard allocator, deallocation does nothing, memory is reclaimed by reset().
+	// Allocator without arena allocates from the heap.
+	template <typename value_type_arg>
+	class allocator
+	{
+		template <typename>
+		friend class allocator;
+
+		frame_arena* arena;
+
+	public:
+		using value_type = value_type_arg;
+
+		allocator(frame_arena& arena) noexcept :
+			arena(&arena)
+		{}
+
+		allocator(frame_arena* arena) noexcept :
+			arena(arena)
+		{}
+
+		template <typename other_value_type>
+		allocator(const allocator<other_value_type>& a) noexcept :
+			arena(a.arena)
+		{}
+
+		value_type* allocate(size_t n)
+		{
+			if (!this->arena) {
+				return std::allocator<value_type>().allocate(n);
+			}
+			return static_cast<value_type*>(this->arena->allocate(n * sizeof(value_type), alignof(value_type)));
+		}
+
+		void deallocate(value_type* p, size_t n) noexcept
+		{
+			if (!this->arena) {
+				std::allocator<value_type>().deallocate(p, n);
+			}
+		}
+
+		template <typename other_value_type>
+		bool operator==(const allocator<other_value_type>& a) const noexcept
+		{
+			return this->arena == a.arena;
+		}
+	};
+
+	template <typename value_type>
+	using vector = std::vector<value_type, allocator<value_type>>;
+};
+
+} // namespace cpugl
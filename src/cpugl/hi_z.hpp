@@ -0,0 +1,145 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include <r4/vector.hpp>
+#include <utki/debug.hpp>
+
+#include "rectangle.hpp"
+
+namespace cpugl {
+
+// Hierarchical depth buffer, coarse level of the depth buffer.
+// For each tile of tile_size x tile_size pixels it holds conservative bounds of the depth values within the tile,
+// i.e. all depth values of the tile are within [min_depth, max_depth].
+// Smaller depth values are closer to the viewer.
+class hi_z_buffer
+{
+public:
+	constexpr static uint32_t tile_size = 8;
+
+	struct tile {
+		float min_depth = std::numeric_limits<float>::lowest();
+		float max_depth = std::numeric_limits<float>::max();
+	};
+
+private:
+	r4::vector2<uint32_t> dims{0, 0};
+	r4::vector2<uint32_t> framebuffer_dims{0, 0};
+
+	std::vector<tile> tiles;
+
+public:
+	// depth values are unknown after resizing, so the tile bounds are set to the widest range
+	void resize(r4::vector2<uint32_t> framebuffer_dims)
+	{
+		this->framebuffer_dims = framebuffer_dims;
+		this->dims = (framebuffer_dims + r4::vector2<uint32_t>(tile_size - 1)) / tile_size;
+		this->tiles.assign(size_t(this->dims.x()) * this->dims.y(), tile{});
+	}
+
+	// dimensions in tiles
+	const r4::vector2<uint32_t>& get_dims() const noexcept
+	{
+		return this->dims;
+	}
+
+	tile& get(r4::vector2<uint32_t> pos) noexcept
+	{
+		ASSERT(pos.x() < this->dims.x() && pos.y() < this->dims.y())
+		return this->tiles[size_t(pos.y()) * this->dims.x() + pos.x()];
+	}
+
+	const tile& get(r4::vector2<uint32_t> pos) const noexcept
+	{
+		ASSERT(pos.x() < this->dims.x() && pos.y() < this->dims.y())
+		return this->tiles[size_t(pos.y()) * this->dims.x() + pos.x()];
+	}
+
+	// pixel area of the tile, tiles at right and bottom edges can be smaller than tile_size
+	rectangle get_tile_area(r4::vector2<uint32_t> pos) const noexcept
+	{
+		return intersect({pos * tile_size, {tile_size, tile_size}}, {{0, 0}, this->framebuffer_dims});
+	}
+
+	// range of tiles overlapping the pixel area, area must be within the framebuffer
+	rectangle get_tiles(const rectangle& area) const noexcept
+	{
+		ASSERT(!is_empty(area))
+		auto first = area.p / tile_size;
+		auto last = (area.p + area.d - r4::vector2<uint32_t>(1)) / tile_size;
+		return {first, last - first + r4::vector2<uint32_t>(1)};
+	}
+
+	// to be called when the area of the depth buffer is filled with the value
+	void clear(const rectangle& area, float depth)
+	{
+		if (is_empty(area)) {
+			return;
+		}
+
+		auto tiles = this->get_tiles(area);
+		for (auto y = tiles.p.y(); y != tiles.p.y() + tiles.d.y(); ++y) {
+			for (auto x = tiles.p.x(); x != tiles.p.x() + tiles.d.x(); ++x) {
+				auto& t = this->get({x, y});
+				auto tile_area = this->get_tile_area({x, y});
+				if (intersect(tile_area, area).d == tile_area.d) {
+					t.min_depth = depth;
+					t.max_depth = depth;
+				} else {
+					// only part of the tile is cleared
+					t.min_depth = std::min(t.min_depth, depth);
+					t.max_depth = std::max(t.max_depth, depth);
+				}
+			}
+		}
+	}
+
+	// Check if everything within the pixel area at the given depth or farther would fail the depth test.
+	bool is_occluded(const rectangle& area, float depth) const noexcept
+	{
+		if (is_empty(area)) {
+			return true;
+		}
+
+		auto tiles = this->get_tiles(area);
+		for (auto y = tiles.p.y(); y != tiles.p.y() + tiles.d.y(); ++y) {
+			for (auto x = tiles.p.x(); x != tiles.p.x() + tiles.d.x(); ++x) {
+				if (this->get({x, y}).max_depth > depth) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+};
+
+} // namespace cpugl
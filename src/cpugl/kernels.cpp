@@ -0,0 +1,124 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "kernels.hpp"
+
+#include <array>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "kernels/kernel_sets.hpp"
+
+#if CPUGL_KERNELS_ARM64
+#	include <sys/auxv.h>
+#endif
+
+using namespace cpugl;
+
+namespace {
+constexpr std::array<std::string_view, size_t(isa::enum_size)> isa_names = {
+	"generic", //
+	"sse4.2",
+	"avx2",
+	"avx512",
+	"sve"
+};
+
+const kernel_set* find_kernel_set(isa i)
+{
+	switch (i) {
+		case isa::generic:
+			return &generic_kernel_set;
+#if CPUGL_KERNELS_X86
+		case isa::sse4_2:
+			return __builtin_cpu_supports("sse4.2") ? &sse4_2_kernel_set : nullptr;
+		case isa::avx2:
+			return __builtin_cpu_supports("avx2") ? &avx2_kernel_set : nullptr;
+		case isa::avx512:
+			return __builtin_cpu_supports("avx512f") && //
+					__builtin_cpu_supports("avx512bw") && //
+					__builtin_cpu_supports("avx512vl")
+				? &avx512_kernel_set
+				: nullptr;
+#endif
+#if CPUGL_KERNELS_ARM64
+		case isa::sve:
+			return (getauxval(AT_HWCAP) & HWCAP_SVE) ? &sve_kernel_set : nullptr;
+#endif
+		default:
+			return nullptr;
+	}
+}
+
+isa detect_isa()
+{
+	// NOLINTNEXTLINE(concurrency-mt-unsafe): environment is not modified by the library
+	if (auto env = std::getenv("CPUGL_ISA")) {
+		for (size_t i = 0; i != isa_names.size(); ++i) {
+			if (isa_names[i] == env && is_supported(isa(i))) {
+				return isa(i);
+			}
+		}
+	}
+
+	// from best to worst
+	for (auto i : {isa::avx512, isa::avx2, isa::sse4_2, isa::sve}) {
+		if (is_supported(i)) {
+			return i;
+		}
+	}
+
+	return isa::generic;
+}
+} // namespace
+
+std::string_view cpugl::to_string(isa i)
+{
+	if (size_t(i) >= isa_names.size()) {
+		return {};
+	}
+	return isa_names[size_t(i)];
+}
+
+bool cpugl::is_supported(isa i)
+{
+	return find_kernel_set(i) != nullptr;
+}
+
+const kernel_set& cpugl::get_kernel_set(isa i)
+{
+	auto ks = find_kernel_set(i);
+	if (!ks) {
+		throw std::invalid_argument("get_kernel_set(): instruction set is not supported");
+	}
+	return *ks;
+}
+
+isa cpugl::get_default_isa()
+{
+	static const isa default_isa = detect_isa();
+	return default_isa;
+}
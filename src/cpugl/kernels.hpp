@@ -0,0 +1,77 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace cpugl {
+
+// Instruction set variants the kernels are compiled for.
+enum class isa {
+	generic,
+
+	// x86_64
+	sse4_2,
+	avx2,
+	avx512,
+
+	// arm64
+	sve,
+
+	enum_size
+};
+
+std::string_view to_string(isa i);
+
+// Table of non-template hot loops compiled for a specific instruction set.
+// Pixels are 4 bytes RGBA.
+struct kernel_set {
+	isa instruction_set;
+
+	void (*fill)(uint8_t* pixels, size_t num_pixels, const uint8_t* value);
+
+	void (*swap_red_blue)(uint8_t* pixels, size_t num_pixels);
+
+	// Blend the color, with alpha scaled by 8 bit coverage of each pixel, over the pixels as blend() does.
+	void (*blend_mask)(uint8_t* pixels, const uint8_t* mask, size_t num_pixels, const uint8_t* color);
+};
+
+// Check if kernels for the instruction set are compiled in and supported by the CPU.
+bool is_supported(isa i);
+
+// Get kernels for the instruction set.
+// Throws std::invalid_argument if the instruction set is not supported.
+const kernel_set& get_kernel_set(isa i);
+
+// Get best instruction set supported by the CPU.
+// The choice can be overridden by CPUGL_ISA environment variable set to one of the to_string(isa) values.
+// The result is detected once and cached.
+isa get_default_isa();
+
+} // namespace cpugl
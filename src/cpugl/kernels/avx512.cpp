@@ -0,0 +1,46 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "kernel_sets.hpp"
+
+#if CPUGL_KERNELS_X86
+
+// x86_64 with AVX-512
+#	define CPUGL_KERNEL_TARGET __attribute__((target("avx512f,avx512bw,avx512vl")))
+
+namespace cpugl::avx512_kernels {
+#	include "kernels.inl"
+} // namespace cpugl::avx512_kernels
+
+const cpugl::kernel_set cpugl::avx512_kernel_set = {
+	.instruction_set = isa::avx512,
+	.fill = avx512_kernels::fill,
+	.swap_red_blue = avx512_kernels::swap_red_blue,
+	.blend_mask = avx512_kernels::blend_mask
+};
+
+#endif
+
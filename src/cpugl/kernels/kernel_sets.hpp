@@ -0,0 +1,57 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include "../kernels.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#	define CPUGL_KERNELS_X86 1
+#else
+#	define CPUGL_KERNELS_X86 0
+#endif
+
+#if defined(__aarch64__) && defined(__linux__)
+#	define CPUGL_KERNELS_ARM64 1
+#else
+#	define CPUGL_KERNELS_ARM64 0
+#endif
+
+namespace cpugl {
+
+extern const kernel_set generic_kernel_set;
+
+#if CPUGL_KERNELS_X86
+extern const kernel_set sse4_2_kernel_set;
+extern const kernel_set avx2_kernel_set;
+extern const kernel_set avx512_kernel_set;
+#endif
+
+#if CPUGL_KERNELS_ARM64
+extern const kernel_set sve_kernel_set;
+#endif
+
+} // namespace cpugl
@@ -0,0 +1,92 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+// Kernels source, compiled multiple times for different instruction sets.
+// Before including this file the CPUGL_KERNEL_TARGET macro has to be defined to the function attributes
+// selecting the instruction set. The file is included inside of a namespace unique for every instruction set.
+// The kernels are plain loops without calls to inline functions, so that compiler vectorizes them
+// for the target instruction set and no functions compiled for other instruction sets get involved.
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+constexpr uint32_t first_byte_shift = 0;
+constexpr uint32_t third_byte_shift = 16;
+#else
+constexpr uint32_t first_byte_shift = 24;
+constexpr uint32_t third_byte_shift = 8;
+#endif
+
+constexpr uint32_t byte_mask = 0xff;
+
+CPUGL_KERNEL_TARGET void fill(uint8_t* pixels, size_t num_pixels, const uint8_t* value)
+{
+	uint32_t v = 0;
+	__builtin_memcpy(&v, value, sizeof(v));
+
+	for (size_t i = 0; i != num_pixels; ++i) {
+		__builtin_memcpy(pixels + i * sizeof(v), &v, sizeof(v));
+	}
+}
+
+CPUGL_KERNEL_TARGET void swap_red_blue(uint8_t* pixels, size_t num_pixels)
+{
+	constexpr uint32_t keep_mask = ~((byte_mask << first_byte_shift) | (byte_mask << third_byte_shift));
+
+	for (size_t i = 0; i != num_pixels; ++i) {
+		uint32_t v = 0;
+		__builtin_memcpy(&v, pixels + i * sizeof(v), sizeof(v));
+
+		auto first = (v >> first_byte_shift) & byte_mask;
+		auto third = (v >> third_byte_shift) & byte_mask;
+
+		v = (v & keep_mask) | (first << third_byte_shift) | (third << first_byte_shift);
+
+		__builtin_memcpy(pixels + i * sizeof(v), &v, sizeof(v));
+	}
+}
+
+CPUGL_KERNEL_TARGET void blend_mask(uint8_t* pixels, const uint8_t* mask, size_t num_pixels, const uint8_t* color)
+{
+	constexpr uint32_t num_channels = 4;
+	constexpr uint32_t alpha_channel = 3;
+
+	// rounded division by 255 is done as (v + 128 + ((v + 128) >> 8)) >> 8
+	constexpr uint32_t half = 0x80;
+	constexpr uint32_t shift = 8;
+
+	for (size_t i = 0; i != num_pixels; ++i) {
+		uint32_t a = mask[i] * uint32_t(color[alpha_channel]) + half;
+		a = (a + (a >> shift)) >> shift;
+		uint32_t one_minus_a = byte_mask - a;
+
+		uint8_t* p = pixels + i * num_channels;
+		for (uint32_t c = 0; c != num_channels; ++c) {
+			// source alpha is the scaled one
+			uint32_t src = c == alpha_channel ? a : color[c];
+			uint32_t v = src * a + p[c] * one_minus_a + half;
+			p[c] = uint8_t((v + (v >> shift)) >> shift);
+		}
+	}
+}
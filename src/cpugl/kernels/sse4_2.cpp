@@ -0,0 +1,46 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "kernel_sets.hpp"
+
+#if CPUGL_KERNELS_X86
+
+// x86_64 with SSE 4.2
+#	define CPUGL_KERNEL_TARGET __attribute__((target("sse4.2")))
+
+namespace cpugl::sse4_2_kernels {
+#	include "kernels.inl"
+} // namespace cpugl::sse4_2_kernels
+
+const cpugl::kernel_set cpugl::sse4_2_kernel_set = {
+	.instruction_set = isa::sse4_2,
+	.fill = sse4_2_kernels::fill,
+	.swap_red_blue = sse4_2_kernels::swap_red_blue,
+	.blend_mask = sse4_2_kernels::blend_mask
+};
+
+#endif
+
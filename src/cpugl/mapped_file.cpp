@@ -0,0 +1,82 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "mapped_file.hpp"
+
+#if M_OS != M_OS_WINDOWS
+
+#	include <cerrno>
+#	include <string>
+#	include <system_error>
+
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+
+#	include <utki/util.hpp>
+
+using namespace cpugl;
+
+mapped_file::mapped_file(std::string_view path)
+{
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg)
+	int fd = open(std::string(path).c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		throw std::system_error(errno, std::generic_category(), "mapped_file: could not open file");
+	}
+
+	// the mapping stays valid after the file descriptor is closed
+	utki::scope_exit close_scope_exit([fd]() {
+		close(fd);
+	});
+
+	struct stat st {};
+	if (fstat(fd, &st) != 0) {
+		throw std::system_error(errno, std::generic_category(), "mapped_file: could not get file size");
+	}
+
+	this->data_size = size_t(st.st_size);
+	if (this->data_size == 0) {
+		// zero length mappings are not allowed
+		return;
+	}
+
+	void* ptr = mmap(nullptr, this->data_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (ptr == MAP_FAILED) {
+		throw std::system_error(errno, std::generic_category(), "mapped_file: could not map file");
+	}
+	this->data_ptr = ptr;
+}
+
+mapped_file::~mapped_file()
+{
+	if (this->data_ptr) {
+		munmap(this->data_ptr, this->data_size);
+	}
+}
+
+#endif
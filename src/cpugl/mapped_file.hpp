@@ -0,0 +1,66 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <string_view>
+
+#include <utki/config.hpp>
+#include <utki/span.hpp>
+
+#if M_OS != M_OS_WINDOWS
+
+namespace cpugl {
+
+// Read-only memory mapping of a whole file.
+// Pages are mapped shared, so several processes mapping the same file use the same physical memory
+// and data is paged in from the page cache on first access instead of being read up front.
+class mapped_file
+{
+	void* data_ptr = nullptr;
+	size_t data_size = 0;
+
+public:
+	// throws std::system_error if the file could not be opened or mapped
+	explicit mapped_file(std::string_view path);
+
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+
+	mapped_file(mapped_file&&) = delete;
+	mapped_file& operator=(mapped_file&&) = delete;
+
+	~mapped_file();
+
+	utki::span<const uint8_t> data() const noexcept
+	{
+		return {static_cast<const uint8_t*>(this->data_ptr), this->data_size};
+	}
+};
+
+} // namespace cpugl
+
+#endif
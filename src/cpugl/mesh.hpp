@@ -26,6 +26,9 @@ SOFTWARE.
 
 #pragma once
 
+#include <algorithm>
+#include <functional>
+#include <limits>
 #include <numeric>
 #include <vector>
 
@@ -33,6 +36,8 @@ SOFTWARE.
 #include <utki/debug.hpp>
 #include <utki/span.hpp>
 
+#include "bounding_volume.hpp"
+#include "cluster.hpp"
 #include "config.hpp"
 
 namespace cpugl {
@@ -40,15 +45,84 @@ namespace cpugl {
 using tex_coord_type = r4::vector2<real>;
 using color_type = r4::vector4<real>;
 
+// Non-owning view of mesh data.
+// Allows rendering meshes which are stored elsewhere, e.g. memory-mapped from a file.
+template <typename... attribute_type>
+struct mesh_view {
+	using vertex_type = std::tuple<r4::vector3<real>, attribute_type...>;
+
+	utki::span<const vertex_type> vertices;
+	utki::span<const std::array<unsigned, 3>> faces;
+	utki::span<const std::array<unsigned, 4>> quads;
+	utki::span<const std::array<unsigned, 2>> lines;
+	utki::span<const unsigned> points;
+	bounding_volume bounds;
+	utki::span<const cluster> clusters;
+};
+
 template <typename... attribute_type>
 class mesh
 {
 public:
-	std::vector<std::tuple<r4::vector3<real>, attribute_type...>> vertices;
+	using vertex_type = std::tuple<r4::vector3<real>, attribute_type...>;
+
+	std::vector<vertex_type> vertices;
 
 	std::vector<std::array<unsigned, 3>> faces;
+
+	// Quads are rasterized in one pass, rather than as two triangles, if they are convex on screen.
+	// Vertices go in the same winding order as of the faces, quad (0, 1, 2, 3) is same as faces (0, 1, 2) and (0, 2, 3).
+	// Quads are not partitioned into clusters.
+	std::vector<std::array<unsigned, 4>> quads;
+
+	// indices of line ends
+	std::vector<std::array<unsigned, 2>> lines;
+
+	// indices of vertices to draw as points
+	std::vector<unsigned> points;
+
+	// bounds of vertex positions, empty bounds are unknown and the mesh is not culled as a whole,
+	// must be updated with update_bounds() after changing vertex positions
+	bounding_volume bounds;
+
+	// Optional partitioning of the faces into clusters, see make_clusters().
+	// If not empty, then faces are rendered cluster by cluster.
+	// Must be cleared or updated after changing vertex positions or faces.
+	std::vector<cluster> clusters;
+
+	void update_bounds()
+	{
+		this->bounds = make_bounding_volume(this->vertices.size(), [this](size_t i) -> const r4::vector3<real>& {
+			return std::get<0>(this->vertices[i]);
+		});
+	}
+
+	// meshes are implicitly viewable, so that functions taking mesh_view accept meshes as well
+	// NOLINTNEXTLINE(google-explicit-constructor, hicpp-explicit-conversions)
+	operator mesh_view<attribute_type...>() const noexcept
+	{
+		return this->view();
+	}
+
+	mesh_view<attribute_type...> view() const noexcept
+	{
+		return {
+			.vertices = utki::make_span(this->vertices),
+			.faces = utki::make_span(this->faces),
+			.quads = utki::make_span(this->quads),
+			.lines = utki::make_span(this->lines),
+			.points = utki::make_span(this->points),
+			.bounds = this->bounds,
+			.clusters = utki::make_span(this->clusters)
+		};
+	}
 };
 
+// Fills the given empty chunk of a mesh and returns true, or returns false when there are no more chunks.
+// See pipeline::render_stream().
+template <typename... attribute_type>
+using mesh_chunk_producer = std::function<bool(mesh<attribute_type...>& chunk)>;
+
 template <typename... attribute_type>
 mesh<attribute_type...> make_mesh(
 	std::vector<std::array<unsigned, 3>> faces,
@@ -87,6 +161,8 @@ mesh<attribute_type...> make_mesh(
 		));
 	}
 
+	vao.update_bounds();
+
 	// assert that all the indices are within vertices array
 	ASSERT(std::accumulate( //
 		vao.faces.begin(),
@@ -108,4 +184,104 @@ mesh<attribute_type...> make_mesh(
 	return vao;
 }
 
+// Partition mesh faces into clusters of at most cluster::max_vertices vertices and
+// cluster::max_faces faces. Faces are grouped in the order they go in the mesh,
+// so clusters are as compact as the mesh faces order is.
+template <typename... attribute_type>
+std::vector<cluster> make_clusters(const mesh<attribute_type...>& mesh)
+{
+	constexpr auto invalid_index = std::numeric_limits<unsigned>::max();
+
+	// mapping from mesh vertex index to cluster vertex index
+	std::vector<unsigned> local_indices(mesh.vertices.size(), invalid_index);
+
+	auto get_position = [&mesh](unsigned index) -> const r4::vector3<real>& {
+		return std::get<0>(mesh.vertices[index]);
+	};
+
+	auto finalize = [&](cluster& c) {
+		for (auto i : c.vertices) {
+			local_indices[i] = invalid_index;
+		}
+
+		c.bounds = make_bounding_volume(c.vertices.size(), [&c, &get_position](size_t i) -> const r4::vector3<real>& {
+			return get_position(c.vertices[i]);
+		});
+
+		std::vector<r4::vector3<real>> normals;
+		normals.reserve(c.faces.size());
+
+		r4::vector3<real> axis{0, 0, 0};
+		for (const auto& f : c.faces) {
+			const auto& v0 = get_position(c.vertices[f[0]]);
+			auto n = (get_position(c.vertices[f[1]]) - v0).cross(get_position(c.vertices[f[2]]) - v0);
+			if (n.is_zero()) {
+				// degenerate face
+				continue;
+			}
+			n.normalize();
+			axis += n;
+			normals.push_back(n);
+		}
+
+		if (normals.empty() || axis.is_zero()) {
+			return;
+		}
+
+		axis.normalize();
+
+		real min_cos = 1;
+		for (const auto& n : normals) {
+			using std::min;
+			min_cos = min(min_cos, n * axis);
+		}
+
+		if (min_cos <= 0) {
+			// cone is a half-space or wider
+			return;
+		}
+
+		using std::sqrt;
+		c.cone_axis = axis;
+		c.cone_cutoff = sqrt(real(1) - min_cos * min_cos);
+	};
+
+	std::vector<cluster> clusters;
+	clusters.emplace_back();
+
+	for (const auto& face : mesh.faces) {
+		auto num_new_vertices = std::count_if(face.begin(), face.end(), [&](auto i) {
+			return local_indices[i] == invalid_index;
+		});
+
+		if (clusters.back().vertices.size() + num_new_vertices > cluster::max_vertices ||
+			clusters.back().faces.size() == cluster::max_faces)
+		{
+			finalize(clusters.back());
+			clusters.emplace_back();
+		}
+
+		auto& c = clusters.back();
+
+		std::array<uint8_t, 3> local_face{};
+		for (unsigned i = 0; i != face.size(); ++i) {
+			auto& li = local_indices[face[i]];
+			if (li == invalid_index) {
+				li = unsigned(c.vertices.size());
+				c.vertices.push_back(face[i]);
+			}
+			local_face[i] = uint8_t(li);
+		}
+		c.faces.push_back(local_face);
+	}
+
+	if (clusters.back().faces.empty()) {
+		clusters.pop_back();
+	} else {
+		finalize(clusters.back());
+	}
+
+	return clusters;
+}
+
 } // namespace cpugl
@@ -0,0 +1,281 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include <utki/span.hpp>
+
+#include "mapped_file.hpp"
+#include "mesh.hpp"
+
+#if M_OS != M_OS_WINDOWS
+
+namespace cpugl {
+
+// Binary mesh file format.
+// The file is a header followed by the vertices, faces, quads, lines and points arrays stored
+// exactly as they are laid out in memory, so the file can be memory-mapped and rendered
+// without parsing or copying. As a consequence, the file is only readable on machines with
+// the same endianness, real type and vertex layout, which is checked by the header.
+// Clusters are not stored, a mapped mesh is always rendered face by face.
+struct mesh_file_header {
+	constexpr static std::array<char, 8> file_magic = {'C', 'P', 'U', 'G', 'L', 'M', 'S', 'H'};
+	constexpr static uint32_t file_version = 2;
+	constexpr static uint32_t endianness_tag = 0x01020304;
+	constexpr static size_t max_vertex_elements = 8;
+
+	// sections start at this alignment, which is enough for any vertex type
+	constexpr static size_t section_alignment = 64;
+
+	struct section {
+		uint64_t offset;
+		uint64_t count;
+	};
+
+	std::array<char, 8> magic;
+	uint32_t version;
+	uint32_t endianness;
+	uint32_t real_size;
+	uint32_t vertex_size;
+	uint32_t num_vertex_elements;
+	std::array<uint32_t, max_vertex_elements> element_offsets;
+	std::array<uint32_t, max_vertex_elements> element_sizes;
+	section vertices;
+	section faces;
+	section quads;
+	section lines;
+	section points;
+	bounding_volume bounds;
+
+	template <typename vertex_type>
+	static mesh_file_header make()
+	{
+		static_assert(
+			std::tuple_size_v<vertex_type> <= max_vertex_elements,
+			"too many vertex attributes for mesh file format"
+		);
+
+		mesh_file_header ret{};
+
+		ret.magic = file_magic;
+		ret.version = file_version;
+		ret.endianness = endianness_tag;
+		ret.real_size = sizeof(real);
+		ret.vertex_size = sizeof(vertex_type);
+		ret.num_vertex_elements = std::tuple_size_v<vertex_type>;
+
+		// element offsets within the tuple are implementation defined, so they are recorded as well
+		vertex_type v{};
+		[&]<size_t... i>(std::index_sequence<i...>) {
+			static_assert(
+				(... && std::is_trivially_copyable_v<std::tuple_element_t<i, vertex_type>>),
+				"vertex attributes must be trivially copyable"
+			);
+			(...,
+			 (ret.element_offsets[i] = uint32_t(
+				  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+				  reinterpret_cast<const uint8_t*>(&std::get<i>(v)) - reinterpret_cast<const uint8_t*>(&v)
+			  ),
+			  ret.element_sizes[i] = uint32_t(sizeof(std::tuple_element_t<i, vertex_type>))));
+		}(std::make_index_sequence<std::tuple_size_v<vertex_type>>{});
+
+		return ret;
+	}
+
+	// compares everything except section locations and bounds
+	bool is_compatible(const mesh_file_header& h) const noexcept
+	{
+		return this->magic == h.magic && this->version == h.version && this->endianness == h.endianness &&
+			this->real_size == h.real_size && this->vertex_size == h.vertex_size &&
+			this->num_vertex_elements == h.num_vertex_elements && this->element_offsets == h.element_offsets &&
+			this->element_sizes == h.element_sizes;
+	}
+};
+
+// throws std::runtime_error if the file could not be written
+template <typename... attribute_type>
+void write_mesh_file(std::string_view path, const mesh_view<attribute_type...>& mesh)
+{
+	using vertex_type = typename mesh_view<attribute_type...>::vertex_type;
+
+	auto header = mesh_file_header::make<vertex_type>();
+	header.bounds = mesh.bounds;
+
+	uint64_t offset = sizeof(header);
+	auto place = [&offset](mesh_file_header::section& s, auto span) {
+		offset = (offset + mesh_file_header::section_alignment - 1) / mesh_file_header::section_alignment *
+			mesh_file_header::section_alignment;
+		s.offset = offset;
+		s.count = span.size();
+		offset += span.size_bytes();
+	};
+
+	place(header.vertices, mesh.vertices);
+	place(header.faces, mesh.faces);
+	place(header.quads, mesh.quads);
+	place(header.lines, mesh.lines);
+	place(header.points, mesh.points);
+
+	std::ofstream stream(std::string(path), std::ios::binary | std::ios::trunc);
+	if (!stream) {
+		throw std::runtime_error("write_mesh_file(): could not open file for writing");
+	}
+
+	auto write = [&stream](const void* data, size_t size) {
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		stream.write(reinterpret_cast<const char*>(data), std::streamsize(size));
+	};
+
+	auto write_section = [&](const mesh_file_header::section& s, auto span) {
+		constexpr std::array<char, mesh_file_header::section_alignment> padding{};
+		write(padding.data(), size_t(s.offset - uint64_t(stream.tellp())));
+		write(span.data(), span.size_bytes());
+	};
+
+	write(&header, sizeof(header));
+	write_section(header.vertices, mesh.vertices);
+	write_section(header.faces, mesh.faces);
+	write_section(header.quads, mesh.quads);
+	write_section(header.lines, mesh.lines);
+	write_section(header.points, mesh.points);
+
+	if (!stream) {
+		throw std::runtime_error("write_mesh_file(): could not write file");
+	}
+}
+
+template <typename... attribute_type>
+void write_mesh_file(std::string_view path, const mesh<attribute_type...>& mesh)
+{
+	write_mesh_file(path, mesh.view());
+}
+
+// Source of a mesh file, see mapped_mesh.
+enum class mesh_file_trust {
+	// file may be corrupt or malicious, all its vertex indices are checked on loading
+	untrusted,
+
+	// file is known to be written by write_mesh_file(), e.g. shipped with the application,
+	// vertex indices are not checked
+	trusted
+};
+
+// Mesh memory-mapped from a file written with write_mesh_file().
+// Loading of a trusted file does not read the vertex data and indices, pages are brought in by the OS
+// as they are accessed during rendering and are shared between processes which map the same file.
+// Out of range indices of an untrusted file would lead to reading out of bounds during rendering, so all the
+// index arrays are read and checked on loading. The index arrays can be as large as the vertex data,
+// so the check brings a significant part of the file into memory.
+template <typename... attribute_type>
+class mapped_mesh
+{
+	mapped_file file;
+
+	mesh_view<attribute_type...> mesh;
+
+	template <typename element_type>
+	utki::span<const element_type> get_section(const mesh_file_header::section& s) const
+	{
+		auto data = this->file.data();
+		if (s.offset % alignof(element_type) != 0 || s.offset > data.size() ||
+			s.count > (data.size() - s.offset) / sizeof(element_type))
+		{
+			throw std::runtime_error("mapped_mesh: section is out of file bounds");
+		}
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		return {reinterpret_cast<const element_type*>(data.data() + s.offset), size_t(s.count)};
+	}
+
+public:
+	using vertex_type = typename mesh_view<attribute_type...>::vertex_type;
+
+	// throws std::system_error if the file could not be mapped,
+	// throws std::runtime_error if the file is not a valid mesh file for this vertex type,
+	// or if the file is untrusted and has out of range vertex indices
+	mapped_mesh(std::string_view path, mesh_file_trust trust) :
+		file(path)
+	{
+		auto data = this->file.data();
+
+		mesh_file_header header{};
+		if (data.size() < sizeof(header)) {
+			throw std::runtime_error("mapped_mesh: file is too small");
+		}
+		std::memcpy(&header, data.data(), sizeof(header));
+
+		if (!mesh_file_header::make<vertex_type>().is_compatible(header)) {
+			throw std::runtime_error("mapped_mesh: file format or vertex layout mismatch");
+		}
+
+		this->mesh.vertices = this->get_section<vertex_type>(header.vertices);
+		this->mesh.faces = this->get_section<std::array<unsigned, 3>>(header.faces);
+		this->mesh.quads = this->get_section<std::array<unsigned, 4>>(header.quads);
+		this->mesh.lines = this->get_section<std::array<unsigned, 2>>(header.lines);
+		this->mesh.points = this->get_section<unsigned>(header.points);
+		this->mesh.bounds = header.bounds;
+
+		if (trust == mesh_file_trust::trusted) {
+			return;
+		}
+
+		auto num_vertices = this->mesh.vertices.size();
+		auto is_valid_index = [num_vertices](unsigned i) {
+			return i < num_vertices;
+		};
+		if (!std::all_of(this->mesh.faces.begin(), this->mesh.faces.end(), [&](const auto& f) {
+				return std::all_of(f.begin(), f.end(), is_valid_index);
+			}) ||
+			!std::all_of(this->mesh.quads.begin(), this->mesh.quads.end(), [&](const auto& q) {
+				return std::all_of(q.begin(), q.end(), is_valid_index);
+			}) ||
+			!std::all_of(this->mesh.lines.begin(), this->mesh.lines.end(), [&](const auto& l) {
+				return std::all_of(l.begin(), l.end(), is_valid_index);
+			}) ||
+			!std::all_of(this->mesh.points.begin(), this->mesh.points.end(), is_valid_index))
+		{
+			throw std::runtime_error("mapped_mesh: vertex index is out of range");
+		}
+	}
+
+	const mesh_view<attribute_type...>& view() const noexcept
+	{
+		return this->mesh;
+	}
+};
+
+} // namespace cpugl
+
+#endif
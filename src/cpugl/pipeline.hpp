@@ -26,11 +26,25 @@ SOFTWARE.
 
 #pragma once
 
+#include <algorithm>
+#include <bit>
+#include <condition_variable>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
 #include <r4/segment2.hpp>
+#include <utki/util.hpp>
 
+#include "blend.hpp"
 #include "config.hpp"
 #include "context.hpp"
+#include "fragment_programs.hpp"
 #include "mesh.hpp"
+#include "visibility_buffer.hpp"
 
 namespace cpugl {
 
@@ -90,313 +104,2609 @@ class pipeline
 	template <typename vertex_program_res_type>
 	using processed_face_type = std::array<vertex_program_res_type, 3>;
 
-	template <bool depth_test, typename fragment_program_type, typename vertex_program_res_type>
-	static void rasterize(
-		context& ctx,
-		const fragment_program_type& fragment_program,
-		const processed_face_type<vertex_program_res_type>& face
-	)
+	// position of the vertex after perspective divide
+	template <typename vertex_program_res_type>
+	static r4::vector2<real> get_screen_position(const vertex_program_res_type& vertex)
 	{
-		std::array<r4::vector2<real>, 3> v = {
-			std::get<0>(face[0]),
-			std::get<0>(face[1]),
-			std::get<0>(face[2]),
-		};
-
-		auto edge_0_1 = make_edge(v[0], v[1]);
-		auto edge_2_0 = make_edge(v[2], v[0]);
-
-		auto triangle_area_doubled = edge_0_1.vector.cross(edge_2_0.vector) * edge_0_1.sign * edge_2_0.sign;
+		const auto& pos = std::get<0>(vertex);
+		return {pos.x(), pos.y()};
+	}
 
-		if (triangle_area_doubled <= 0) {
-			// triangle is facing away
-			return;
-		}
+	template <typename fragment_program_type, typename vertex_program_res_type>
+	constexpr static bool is_gouraud_v = //
+		std::is_same_v<fragment_program_type, gouraud_fragment_program> &&
+		std::is_same_v<vertex_program_res_type, std::tuple<r4::vector4<real>, color_type>>;
 
-		auto edge_1_2 = make_edge(v[1], v[2]);
+	// not normalized barycentric coordinates of the point, edges are opposite to vertices 0, 1, 2
+	static r4::vector3<real> calc_barycentric(const std::array<edge_info, 3>& edges, const r4::vector2<real>& p)
+	{
+		return {
+			edge_function(edges[0], p), //
+			edge_function(edges[1], p),
+			edge_function(edges[2], p)
+		};
+	}
 
-		auto& framebuffer = ctx.get_framebuffer();
+	// check if triangle covers the point using top-left fill rule
+	static bool covers(const std::array<edge_info, 3>& edges, const r4::vector3<real>& barycentric)
+	{
+		return //
+			(barycentric[0] > 0 || (barycentric[0] == 0 && is_top_left(edges[0]))) &&
+			(barycentric[1] > 0 || (barycentric[1] == 0 && is_top_left(edges[1]))) &&
+			(barycentric[2] > 0 || (barycentric[2] == 0 && is_top_left(edges[2])));
+	}
 
-		auto bb_segment = calc_bounding_box_segment(v[0], v[1], v[2]);
+	static bool covers(const std::array<edge_info, 3>& edges, const r4::vector2<real>& p)
+	{
+		return covers(edges, calc_barycentric(edges, p));
+	}
 
-		using std::floor;
-		using std::ceil;
+	// Find span of pixels covered by triangle within a row of given width starting at row_pos.
+	// The span is found analytically, since edge functions are linear, and then its ends are adjusted with
+	// the same coverage test as in the generic path, so that triangles sharing an edge do not overlap or leave gaps.
+	// Returns [begin, end) pixel offsets from row_pos.
+	static std::pair<uint32_t, uint32_t> find_covered_span(
+		const std::array<edge_info, 3>& edges,
+		const r4::vector2<real>& row_pos,
+		uint32_t width
+	)
+	{
 		using std::min;
 		using std::max;
 
-		// round and clamp to positive values
-		bb_segment.p1 = max(floor(bb_segment.p1), 0);
-		bb_segment.p2 = max(ceil(bb_segment.p2), 0);
-
-		auto uint_bb_segment = r4::segment2<uint32_t>(bb_segment.p1.to<uint32_t>(), bb_segment.p2.to<uint32_t>());
+		real span_begin = 0;
+		real span_end = real(width);
+		for (const auto& e : edges) {
+			real value = edge_function(e, row_pos);
+			real dx = e.vector.y() * e.sign;
 
-		ASSERT(uint_bb_segment.p1.x() <= uint_bb_segment.p2.x())
-		ASSERT(uint_bb_segment.p1.y() <= uint_bb_segment.p2.y())
+			if (dx == 0) {
+				if (value < 0) {
+					span_end = 0;
+				}
+				continue;
+			}
 
-		if (uint_bb_segment.p1.x() >= framebuffer.dims().x() || //
-			uint_bb_segment.p1.y() >= framebuffer.dims().y())
-		{
-			// bounding box lies outside of the screen
-			return;
+			real crossing = -value / dx;
+			if (dx > 0) {
+				span_begin = max(span_begin, std::ceil(crossing));
+			} else {
+				span_end = min(span_end, std::floor(crossing) + 1);
+			}
 		}
 
-		// clamp bounding box to framebuffer boundaries
-		uint_bb_segment.p2 = min(uint_bb_segment.p2, framebuffer.dims());
-
-		r4::rectangle<uint32_t> bounding_box{uint_bb_segment.p1, uint_bb_segment.p2 - uint_bb_segment.p1};
-
-		auto framebuffer_span = framebuffer.span().subspan(bounding_box);
-
-		r4::vector3<real> depth_reciprocal(
-			1 / std::get<0>(face[0]).w(),
-			1 / std::get<0>(face[1]).w(),
-			1 / std::get<0>(face[2]).w()
-		);
-
-		auto bb_pos = bounding_box.p.to<real>();
-
-		auto p = bb_pos;
-		for (auto line : framebuffer_span) {
-			for (auto& framebuffer_pixel : line) {
-				auto barycentric = r4::vector3<real>{
-					edge_function(edge_1_2, p),
-					edge_function(edge_2_0, p),
-					edge_function(edge_0_1, p)
-				};
-
-				bool overlaps = //
-					(barycentric[0] > 0 || (barycentric[0] == 0 && is_top_left(edge_1_2))) &&
-					(barycentric[1] > 0 || (barycentric[1] == 0 && is_top_left(edge_2_0))) &&
-					(barycentric[2] > 0 || (barycentric[2] == 0 && is_top_left(edge_0_1)));
-
-				if (overlaps) {
-					// normalize barycentric coordinates
-					barycentric /= triangle_area_doubled;
-
-					real depth = 1 / (depth_reciprocal * barycentric);
+		auto begin = uint32_t(min(span_begin, real(width)));
+		auto end = max(uint32_t(max(span_end, real(0))), begin);
 
-					auto interpolated_attributes = //
-						[&b = barycentric, &f = face, &depth]<size_t... i>(std::index_sequence<i...>) {
-							return std::make_tuple(
-								(std::get<i>(f[0]) * b[0] + std::get<i>(f[1]) * b[1] + std::get<i>(f[2]) * b[2]) *
-								depth...
-							);
-						}(utki::offset_sequence_t<
-							1,
-							std::make_index_sequence< //
-								std::tuple_size_v<vertex_program_res_type> - 1 //
-								> //
-							>{});
-
-					static_assert(
-						utki::is_specialization_of_v<std::tuple, decltype(interpolated_attributes)>,
-						"interpolated_attributes type must be std::tuple"
-					);
-
-					static_assert(
-						[]<typename... arg_type>(std::tuple<arg_type...>) constexpr {
-							return std::is_invocable_v<decltype(fragment_program), const arg_type&...>;
-						}(decltype(interpolated_attributes){}),
-						"fragment_program must be invocable"
-					);
-
-					auto pixel_color = std::apply(fragment_program, interpolated_attributes);
-
-					using framebuffer_pixel_value_type =
-						std::remove_reference_t<decltype(framebuffer_pixel)>::value_type;
-
-					framebuffer_pixel = rasterimage::to<framebuffer_pixel_value_type>(pixel_color);
-				}
-
-				++p.x();
-			}
-			p.x() = bb_pos.x();
-			++p.y();
+		// the analytical span can be off by a pixel due to rounding errors
+		auto pixel_pos = [&row_pos](uint32_t x) {
+			return r4::vector2<real>{row_pos.x() + real(x), row_pos.y()};
+		};
+		while (begin < end && !covers(edges, pixel_pos(begin))) {
+			++begin;
 		}
+		while (begin > 0 && covers(edges, pixel_pos(begin - 1))) {
+			--begin;
+		}
+		while (end > begin && !covers(edges, pixel_pos(end - 1))) {
+			--end;
+		}
+		while (end < width && covers(edges, pixel_pos(end))) {
+			++end;
+		}
+
+		return {begin, end};
 	}
 
+	// undo perspective divide of the vertex attributes
 	template <typename vertex_program_res_type>
-	static vertex_program_res_type perspective_divide(const vertex_program_res_type& vertex)
+	static auto get_vertex_attributes(const vertex_program_res_type& vertex)
 	{
 		return std::apply(
-			[]<typename... attribute_type>(const r4::vector4<real>& pos, const attribute_type&... attribute) {
-				return std::make_tuple(
-					r4::vector4<real>(
-						pos.x() / pos.w(), //
-						pos.y() / pos.w(),
-						pos.z() / pos.w(),
-						pos.w()
-					),
-					attribute / pos.w()...
-				);
+			[](const r4::vector4<real>& pos, const auto&... attribute) {
+				return std::make_tuple(attribute * pos.w()...);
 			},
 			vertex
 		);
 	}
 
-	// clip edge by z = 0.
-	// return new vertex with z = 0.
-	template <typename vertex_program_res_type>
-	static vertex_program_res_type clip_edge(
-		const vertex_program_res_type& positive_z_vertex,
-		const vertex_program_res_type& negative_z_vertex
+	// Invoke fragment program with the attributes, unless it does not use attributes.
+	template <typename fragment_program_type, typename attributes_type, typename... extra_arg_type>
+	static auto invoke_fragment_program(
+		const fragment_program_type& fragment_program,
+		const attributes_type& attributes,
+		const extra_arg_type&... extra_arg
 	)
 	{
-		const auto& pv_pos = std::get<0>(positive_z_vertex);
-		auto& nv_pos = std::get<0>(negative_z_vertex);
+		if constexpr (fragment_program_traits<fragment_program_type>::uses_attributes) {
+			return std::apply(
+				[&](const auto&... attribute) {
+					return fragment_program(attribute..., extra_arg...);
+				},
+				attributes
+			);
+		} else {
+			return fragment_program(extra_arg...);
+		}
+	}
 
-		ASSERT(nv_pos.z() < 0)
-		ASSERT(pv_pos.z() >= 0)
-		auto edge = pv_pos - nv_pos;
-		ASSERT(edge.z() > 0)
-		auto factor = -nv_pos.z() / edge.z();
-		ASSERT(factor >= 0)
-		ASSERT(factor < 1)
+	// Write fragment value to the framebuffer pixel, blend it if the fragment program is blended.
+	template <typename fragment_program_type>
+	static void store_fragment(
+		context::fb_span_type::pixel_type& pixel,
+		const context::fb_span_type::pixel_type& value
+	) noexcept
+	{
+		if constexpr (fragment_program_traits<fragment_program_type>::blended) {
+			pixel = blend(pixel, value);
+		} else {
+			pixel = value;
+		}
+	}
 
-		return
-			[&pv = positive_z_vertex, &nv = negative_z_vertex, factor, &edge]<size_t... i>(std::index_sequence<i...>) {
-				return std::make_tuple(
-					std::get<0>(nv) + edge * factor,
-					std::get<i>(nv) * (real(1) - factor) + std::get<i>(pv) * factor...
+	// Fill pixels covered by triangle with the value.
+	// Rows are filled with the context's fill kernel when there is no stencil test.
+	static void rasterize_constant(
+		context& ctx,
+		const std::array<edge_info, 3>& edges, // edges opposite to vertices 0, 1, 2
+		const context::fb_span_type::pixel_type& value,
+		const context::fb_span_type& framebuffer_span,
+		const r4::vector2<real>& bb_pos,
+		const stencil_state* stencil,
+		const context::stencil_span_type& stencil_span
+	)
+	{
+		auto width = framebuffer_span.dims().x();
+		const auto& kernels = ctx.get_kernels();
+
+		auto row_pos = bb_pos;
+		uint32_t row = 0;
+		for (auto line : framebuffer_span) {
+			auto [begin, end] = find_covered_span(edges, row_pos, width);
+
+			if (stencil) {
+				auto stencil_line = stencil_span[row];
+				for (auto x = begin; x != end; ++x) {
+					if (stencil->test_and_update(stencil_line[x][0])) {
+						line[x] = value;
+					}
+				}
+			} else if (begin != end) {
+				kernels.fill(
+					// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+					reinterpret_cast<uint8_t*>(std::next(line.data(), begin)),
+					end - begin,
+					value.data()
 				);
-			}(utki::offset_sequence_t<
-				1,
-				std::make_index_sequence< //
-					std::tuple_size_v<vertex_program_res_type> - 1 //
-					> //
-				>{});
+			}
+
+			++row_pos.y();
+			++row;
+		}
 	}
 
-	// clip face by (z < 0) half-space
+	// Rasterize triangle with gouraud_fragment_program when all vertices have same w, i.e. no perspective correction
+	// is needed. The color is interpolated in 16.16 fixed point and stepped incrementally along the rows.
+	// Returns false if the color gradients are too steep for fixed point, then the generic path has to be used.
 	template <typename vertex_program_res_type>
-	static utki::span<processed_face_type<vertex_program_res_type>> clip(
-		std::array<processed_face_type<vertex_program_res_type>, 2>& faces
+	static bool rasterize_affine_gouraud(
+		const processed_face_type<vertex_program_res_type>& face,
+		const std::array<edge_info, 3>& edges, // edges opposite to vertices 0, 1, 2
+		real triangle_area_doubled,
+		const context::fb_span_type& framebuffer_span,
+		const r4::vector2<real>& bb_pos,
+		const stencil_state* stencil,
+		const context::stencil_span_type& stencil_span
 	)
 	{
-		// TODO: use static_vector
-		std::vector<unsigned> negative_indices;
-		negative_indices.reserve(3);
+		using std::abs;
+		using std::min;
+		using std::max;
 
-		std::vector<unsigned> positive_indices;
-		positive_indices.reserve(3);
+		constexpr real channel_max = std::numeric_limits<uint8_t>::max();
 
-		for (unsigned i = 0; i != faces.front().size(); ++i) {
-			if (std::get<0>(faces.front()[i]).z() < 0) {
-				negative_indices.push_back(i);
-			} else {
-				positive_indices.push_back(i);
+		// undo perspective divide of the colors
+		std::array<color_type, 3> colors = {
+			std::get<1>(face[0]) * std::get<0>(face[0]).w() * channel_max,
+			std::get<1>(face[1]) * std::get<0>(face[1]).w() * channel_max,
+			std::get<1>(face[2]) * std::get<0>(face[2]).w() * channel_max
+		};
+
+		// Barycentric coordinates are linear functions of pixel position,
+		// so the color gradient is computed from derivatives of the edge functions.
+		color_type origin{0};
+		color_type step_x{0};
+		color_type step_y{0};
+		for (unsigned i = 0; i != edges.size(); ++i) {
+			const auto& e = edges[i];
+			origin += colors[i] * edge_function(e, bb_pos);
+			step_x += colors[i] * (e.vector.y() * e.sign);
+			step_y -= colors[i] * (e.vector.x() * e.sign);
+		}
+		origin /= triangle_area_doubled;
+		step_x /= triangle_area_doubled;
+		step_y /= triangle_area_doubled;
+
+		constexpr unsigned fraction_bits = 16;
+		constexpr real fixed_one = 1 << fraction_bits;
+
+		// make sure the color extrapolated to any bounding box corner fits into fixed point,
+		// leave some headroom for accumulated error
+		constexpr real max_value = real(1 << (std::numeric_limits<int32_t>::digits - fraction_bits - 1));
+		auto dims = framebuffer_span.dims().to<real>();
+		for (unsigned i = 0; i != origin.size(); ++i) {
+			if (abs(origin[i]) + abs(step_x[i]) * dims.x() + abs(step_y[i]) * dims.y() > max_value) {
+				return false;
 			}
 		}
 
-		ASSERT(negative_indices.size() <= 3)
-		ASSERT(positive_indices.size() <= 3)
+		using fixed_color_type = r4::vector4<int32_t>;
 
-		if (negative_indices.empty()) {
-			ASSERT(positive_indices.size() == 3)
-			// the face is completely ahead of the near plane
-			return utki::span(faces.data(), 1);
-		}
+		auto to_fixed = [](const color_type& c) {
+			return fixed_color_type{
+				int32_t(std::lround(c[0] * fixed_one)),
+				int32_t(std::lround(c[1] * fixed_one)),
+				int32_t(std::lround(c[2] * fixed_one)),
+				int32_t(std::lround(c[3] * fixed_one))
+			};
+		};
 
-		if (negative_indices.size() == 3) {
-			ASSERT(positive_indices.empty())
-			// face is completely behind near plane
-			return {};
-		}
+		// rounding is done by adding one half before truncation
+		auto row_color = to_fixed(origin + color_type(real(0.5)));
+		auto fixed_step_x = to_fixed(step_x);
+		auto fixed_step_y = to_fixed(step_y);
 
-		// TODO: optimization: drop faces which are completely out of screen
+		constexpr int32_t fixed_channel_max = std::numeric_limits<uint8_t>::max();
 
-		switch (negative_indices.size()) {
-			default:
-				ASSERT(false)
-				break;
-			case 1:
-				ASSERT(negative_indices.size() == 1)
-				ASSERT(positive_indices.size() == 2)
-				// 1 triangle turns into 2 triangles
-				{
-					auto& negative_vertex = faces.front()[negative_indices[0]];
+		auto width = framebuffer_span.dims().x();
 
-					faces[1][negative_indices[0]] = faces[0][positive_indices[1]];
-					faces[1][positive_indices[1]] = clip_edge(faces[0][positive_indices[0]], negative_vertex);
-					faces[1][positive_indices[0]] = clip_edge(faces[0][positive_indices[1]], negative_vertex);
+		auto row_pos = bb_pos;
+		uint32_t row = 0;
+		for (auto line : framebuffer_span) {
+			auto [begin, end] = find_covered_span(edges, row_pos, width);
 
-					faces[0][negative_indices[0]] = faces[1][positive_indices[1]];
-				}
-				return utki::span(faces.data(), 2);
-			case 2:
-				// 1 triangle remains 1 triangle
-				ASSERT(negative_indices.size() == 2)
-				ASSERT(positive_indices.size() == 1)
-				{
-					const auto& positive_vertex = faces.front()[positive_indices.front()];
-					for (auto i : negative_indices) {
-						auto& negative_vertex = faces.front()[i];
+			auto stencil_line = stencil ? stencil_span[row] : decltype(stencil_span[row])();
+			auto color = row_color + fixed_step_x * int32_t(begin);
 
-						negative_vertex = clip_edge(positive_vertex, negative_vertex);
+			for (auto x = begin; x != end; ++x) {
+				if (!stencil || stencil->test_and_update(stencil_line[x][0])) {
+					auto& framebuffer_pixel = line[x];
+					for (unsigned i = 0; i != color.size(); ++i) {
+						framebuffer_pixel[i] =
+							uint8_t(min(max(color[i] >> fraction_bits, int32_t(0)), fixed_channel_max));
 					}
 				}
-				return utki::span(faces.data(), 1);
+				color += fixed_step_x;
+			}
+
+			row_color += fixed_step_y;
+			++row_pos.y();
+			++row;
 		}
 
-		return {};
+		return true;
 	}
 
-public:
-	template <bool depth_test, typename vertex_program_type, typename fragment_program_type, typename... attribute_type>
-	static void render(
-		context& ctx,
-		const vertex_program_type& vertex_program,
-		const fragment_program_type& fragment_program,
-		const mesh<attribute_type...>& mesh
-	)
-	{
-		static_assert(
-			[]<typename... arg_type>(std::tuple<arg_type...>) constexpr {
-				return std::is_invocable_v<decltype(vertex_program), const r4::vector3<real>&, const arg_type&...>;
-			}(std::tuple<attribute_type...>{}),
-			"vertex_program must be invocable"
-		);
+	// Pixel covered by a primitive, found by a primitive specific locate(position) function.
+	struct sample {
+		// index of the triangle of the primitive which covers the pixel
+		unsigned triangle;
 
-		using vertex_program_res_type = decltype( //
-			vertex_program( //
-				std::declval<r4::vector4<real>>(),
-				std::declval<attribute_type>()...
-			)
-		);
+		// not normalized barycentric coordinates within the triangle
+		r4::vector3<real> barycentric;
 
-		static_assert(
-			utki::is_specialization_of_v<std::tuple, vertex_program_res_type>,
-			"vertex program return type must be std::tuple"
-		);
+		float depth;
+	};
 
-		static_assert(
-			std::is_same_v<r4::vector4<real>, std::tuple_element_t<0, vertex_program_res_type>>,
-			"first element of vertex program return tuple must be r4::vector4<real>"
-		);
+	struct triangle_setup {
+		// edges opposite to vertices 0, 1, 2
+		std::array<edge_info, 3> edges;
 
-		for (const auto& unprocessed_face : mesh.faces) {
-			// clang-format off
-			std::array<processed_face_type<vertex_program_res_type>, 2> faces{{
-				{
-					std::apply(vertex_program, mesh.vertices[unprocessed_face[0]]),
-					std::apply(vertex_program, mesh.vertices[unprocessed_face[1]]),
-					std::apply(vertex_program, mesh.vertices[unprocessed_face[2]])
-				},
- 				{}
-			}};
-			// clang-format on
+		real area_doubled;
 
-			auto clipped_faces = clip(faces);
+		// samples which the triangle can cover
+		rectangle bounding_box;
 
-			for (auto& face : clipped_faces) {
-				for (auto& f : face) {
-					f = perspective_divide(f);
-				}
+		// vertex depths after perspective divide
+		r4::vector3<real> depths;
+
+		// depth is linear in screen space, so it is interpolated with normalized barycentric coordinates,
+		// these are the vertex depths divided by the doubled area
+		r4::vector3<real> depth_factors;
+
+		float get_min_depth() const noexcept
+		{
+			using std::min;
+			return float(min(min(this->depths[0], this->depths[1]), this->depths[2]));
+		}
+
+		float get_max_depth() const noexcept
+		{
+			using std::max;
+			return float(max(max(this->depths[0], this->depths[1]), this->depths[2]));
+		}
 
-				rasterize<depth_test>(ctx, fragment_program, face);
+		std::optional<sample> locate(const r4::vector2<real>& p, unsigned triangle = 0) const
+		{
+			auto barycentric = calc_barycentric(this->edges, p);
+			if (!covers(this->edges, barycentric)) {
+				return {};
 			}
+
+			return sample{
+				.triangle = triangle,
+				.barycentric = barycentric,
+				.depth = float(this->depth_factors * barycentric)
+			};
 		}
+	};
+
+	// Returns empty optional if the triangle cannot produce any fragments, i.e. it covers no samples of
+	// the render area, it is facing away or, if depth_tested is true, it is behind already rendered geometry
+	// according to the hierarchical depth buffer. Hidden triangles are not rejected if stencil test is enabled,
+	// because their fragments still update the stencil buffer.
+	template <typename vertex_program_res_type>
+	static std::optional<triangle_setup> setup_triangle(
+		const context& ctx,
+		const processed_face_type<vertex_program_res_type>& face,
+		bool depth_tested
+	)
+	{
+		std::array<r4::vector2<real>, 3> v = {
+			std::get<0>(face[0]),
+			std::get<0>(face[1]),
+			std::get<0>(face[2]),
+		};
+
+		using std::floor;
+		using std::ceil;
+		using std::min;
+		using std::max;
+
+		const auto& render_area = ctx.get_render_area();
+
+		auto bb_segment = calc_bounding_box_segment(v[0], v[1], v[2]);
+
+		// Pixels are sampled at integer coordinates, so the triangle can only cover samples within
+		// [ceil(min), floor(max)] range. Clamp to render area in real numbers to avoid integer overflow.
+		bb_segment.p1 = max(ceil(bb_segment.p1), render_area.p.to<real>());
+		bb_segment.p2 = min(floor(bb_segment.p2) + r4::vector2<real>(1), (render_area.p + render_area.d).to<real>());
+
+		if (bb_segment.p1.x() >= bb_segment.p2.x() || //
+			bb_segment.p1.y() >= bb_segment.p2.y())
+		{
+			// the triangle lies outside of the render area or it is too small to cover any sample,
+			// culled before any edge setup
+			return {};
+		}
+
+		auto edge_0_1 = make_edge(v[0], v[1]);
+		auto edge_2_0 = make_edge(v[2], v[0]);
+
+		auto triangle_area_doubled = edge_0_1.vector.cross(edge_2_0.vector) * edge_0_1.sign * edge_2_0.sign;
+
+		if (triangle_area_doubled <= 0) {
+			// triangle is facing away
+			return {};
+		}
+
+		auto edge_1_2 = make_edge(v[1], v[2]);
+
+		auto uint_bb_segment = r4::segment2<uint32_t>(bb_segment.p1.to<uint32_t>(), bb_segment.p2.to<uint32_t>());
+
+		triangle_setup ret{
+			.edges = {edge_1_2, edge_2_0, edge_0_1},
+			.area_doubled = triangle_area_doubled,
+			.bounding_box = {uint_bb_segment.p1, uint_bb_segment.p2 - uint_bb_segment.p1},
+			.depths = {std::get<0>(face[0]).z(), std::get<0>(face[1]).z(), std::get<0>(face[2]).z()},
+			.depth_factors = {}
+		};
+		ret.depth_factors = ret.depths / triangle_area_doubled;
+
+		if (depth_tested && !ctx.is_stencil_test_enabled()) {
+			if (ctx.get_hi_z().is_occluded(ret.bounding_box, ret.get_min_depth())) {
+				// the triangle is behind already rendered geometry
+				return {};
+			}
+		}
+
+		return ret;
+	}
+
+	// Run fragment program for the point of the triangle given by its not normalized barycentric coordinates.
+	template <typename fragment_program_type, typename vertex_program_res_type>
+	static auto shade_fragment(
+		const fragment_program_type& fragment_program,
+		const processed_face_type<vertex_program_res_type>& face,
+		const r4::vector3<real>& depth_reciprocal,
+		real triangle_area_doubled,
+		r4::vector3<real> barycentric
+	)
+	{
+		if constexpr (fragment_program_traits<fragment_program_type>::uses_attributes) {
+			// normalize barycentric coordinates
+			barycentric /= triangle_area_doubled;
+
+			real depth = 1 / (depth_reciprocal * barycentric);
+
+			auto interpolated_attributes = //
+				[&b = barycentric, &f = face, &depth]<size_t... i>(std::index_sequence<i...>) {
+					return std::make_tuple(
+						(std::get<i>(f[0]) * b[0] + std::get<i>(f[1]) * b[1] + std::get<i>(f[2]) * b[2]) * depth...
+					);
+				}(utki::offset_sequence_t<
+					1,
+					std::make_index_sequence< //
+						std::tuple_size_v<vertex_program_res_type> - 1 //
+						> //
+					>{});
+
+			static_assert(
+				utki::is_specialization_of_v<std::tuple, decltype(interpolated_attributes)>,
+				"interpolated_attributes type must be std::tuple"
+			);
+
+			static_assert(
+				[]<typename... arg_type>(std::tuple<arg_type...>) constexpr {
+					return std::is_invocable_v<decltype(fragment_program), const arg_type&...>;
+				}(decltype(interpolated_attributes){}),
+				"fragment_program must be invocable"
+			);
+
+			return std::apply(fragment_program, interpolated_attributes);
+		} else {
+			// no need to interpolate attributes
+			return fragment_program();
+		}
+	}
+
+	// Rasterize primitive with depth test, tile by tile of the hierarchical depth buffer.
+	// Tiles where the stored depth is closer than the whole primitive are skipped without any per-pixel work.
+	// Fragments which fail the depth test still update the stencil with the stencil fail or depth fail operation,
+	// so no tiles are skipped when the stencil is given.
+	// The locate(position) returns the sample, or empty optional if the primitive does not cover the pixel.
+	// The shade(x, y, sample) is called for each pixel which passes the tests,
+	// the tile_done(tile_position) is called after each tile which is not skipped.
+	template <typename locate_type, typename shade_type, typename tile_done_type>
+	static void rasterize_depth_tested(
+		context& ctx,
+		float primitive_min_depth,
+		float primitive_max_depth,
+		const rectangle& bounding_box,
+		const stencil_state* stencil,
+		const locate_type& locate,
+		const shade_type& shade,
+		const tile_done_type& tile_done
+	)
+	{
+		using std::min;
+		using std::max;
+
+		const auto& depth_buffer = ctx.get_depth_buffer();
+		const auto& stencil_buffer = ctx.get_stencil_buffer();
+		auto& hi_z = ctx.get_hi_z();
+
+		auto tiles = hi_z.get_tiles(bounding_box);
+		for (auto ty = tiles.p.y(); ty != tiles.p.y() + tiles.d.y(); ++ty) {
+			for (auto tx = tiles.p.x(); tx != tiles.p.x() + tiles.d.x(); ++tx) {
+				auto& tile = hi_z.get({tx, ty});
+				if (!stencil && tile.max_depth <= primitive_min_depth) {
+					// the primitive is completely behind the tile contents
+					continue;
+				}
+
+				// the primitive is completely in front of the tile contents, no need to read the depth buffer
+				bool passes = primitive_max_depth < tile.min_depth;
+
+				auto tile_area = hi_z.get_tile_area({tx, ty});
+				auto area = intersect(tile_area, bounding_box);
+
+				// if whole tile is visited, then its maximum depth is known exactly afterwards
+				bool whole_tile = area.d == tile_area.d;
+				float tile_max_depth = std::numeric_limits<float>::lowest();
+
+				for (auto y = area.p.y(); y != area.p.y() + area.d.y(); ++y) {
+					auto depth_line = depth_buffer[y];
+					for (auto x = area.p.x(); x != area.p.x() + area.d.x(); ++x) {
+						auto& depth = depth_line[x][0];
+
+						auto s = locate(r4::vector2<real>{real(x), real(y)});
+						if (s.has_value()) {
+							bool depth_passed = passes || s->depth < depth;
+							if ((!stencil || stencil->test_and_update(stencil_buffer[y][x][0], depth_passed)) &&
+								depth_passed)
+							{
+								shade(x, y, s.value());
+								depth = s->depth;
+								tile.min_depth = min(tile.min_depth, s->depth);
+							}
+						}
+
+						tile_max_depth = max(tile_max_depth, depth);
+					}
+				}
+
+				if (whole_tile) {
+					tile.max_depth = tile_max_depth;
+				}
+
+				tile_done(tile_area.p);
+			}
+		}
+	}
+
+	// Coarse shading works on tiles of coarse_tile_size x coarse_tile_size pixels aligned to the framebuffer grid,
+	// same as the hierarchical depth buffer tiles. Covered pixels of a tile are given by a bit mask,
+	// bit (y * coarse_tile_size + x) corresponds to pixel (x, y) of the tile.
+	constexpr static uint32_t coarse_tile_size = hi_z_buffer::tile_size;
+	static_assert(coarse_tile_size * coarse_tile_size == std::numeric_limits<uint64_t>::digits);
+
+	static uint64_t coarse_pixel_bit(uint32_t x, uint32_t y) noexcept
+	{
+		return uint64_t(1) << ((y % coarse_tile_size) * coarse_tile_size + x % coarse_tile_size);
+	}
+
+	// Invoke shade(barycentric) once per rate x rate block of the tile and write the returned pixel value
+	// to all covered pixels of the block. Blocks are aligned to the framebuffer grid, so the blocks of
+	// adjacent triangles coincide.
+	template <typename fragment_program_type, typename shade_type>
+	static void shade_coarse_tile(
+		const context::fb_span_type& framebuffer,
+		const std::array<edge_info, 3>& edges,
+		const r4::vector2<uint32_t>& tile_pos,
+		uint64_t coverage,
+		uint32_t rate,
+		const shade_type& shade
+	)
+	{
+		ASSERT(coarse_tile_size % rate == 0)
+
+		uint64_t block_row_mask = (uint64_t(1) << rate) - 1;
+		uint64_t block_mask = 0;
+		for (uint32_t i = 0; i != rate; ++i) {
+			block_mask |= block_row_mask << (i * coarse_tile_size);
+		}
+
+		for (uint32_t by = 0; by != coarse_tile_size; by += rate) {
+			for (uint32_t bx = 0; bx != coarse_tile_size; bx += rate) {
+				uint64_t block_coverage = coverage & (block_mask << (by * coarse_tile_size + bx));
+				if (block_coverage == 0) {
+					continue;
+				}
+
+				auto pixel_pos = [&tile_pos](unsigned bit) -> r4::vector2<uint32_t> {
+					return {
+						tile_pos.x() + bit % coarse_tile_size,
+						tile_pos.y() + bit / coarse_tile_size
+					};
+				};
+
+				// Sample at the block center. If it is outside of the triangle, then sample at the first covered
+				// pixel instead, so that attributes are not extrapolated beyond the triangle.
+				auto barycentric = calc_barycentric(
+					edges,
+					(tile_pos + r4::vector2<uint32_t>{bx, by}).to<real>() + r4::vector2<real>(real(rate - 1) / 2)
+				);
+				if (!covers(edges, barycentric)) {
+					r4::vector2<uint32_t> p = pixel_pos(std::countr_zero(block_coverage));
+					barycentric = calc_barycentric(edges, p.to<real>());
+				}
+
+				auto value = shade(barycentric);
+
+				for (; block_coverage != 0; block_coverage &= block_coverage - 1) {
+					auto p = pixel_pos(std::countr_zero(block_coverage));
+					store_fragment<fragment_program_type>(framebuffer[p.y()][p.x()], value);
+				}
+			}
+		}
+	}
+
+	// Rasterize triangle without depth test at coarse shading rate, tile by tile, see shade_coarse_tile().
+	template <typename fragment_program_type, typename shade_type>
+	static void rasterize_coarse(
+		context& ctx,
+		const std::array<edge_info, 3>& edges, // edges opposite to vertices 0, 1, 2
+		const rectangle& bounding_box,
+		const stencil_state* stencil,
+		uint32_t rate,
+		const shade_type& shade
+	)
+	{
+		const auto& framebuffer = ctx.get_framebuffer();
+		const auto& stencil_buffer = ctx.get_stencil_buffer();
+
+		auto first_tile = bounding_box.p / coarse_tile_size;
+		auto end_tile = (bounding_box.p + bounding_box.d + r4::vector2<uint32_t>(coarse_tile_size - 1)) / //
+			coarse_tile_size;
+
+		for (auto ty = first_tile.y(); ty != end_tile.y(); ++ty) {
+			for (auto tx = first_tile.x(); tx != end_tile.x(); ++tx) {
+				r4::vector2<uint32_t> tile_pos{tx * coarse_tile_size, ty * coarse_tile_size};
+				auto area = intersect({tile_pos, {coarse_tile_size, coarse_tile_size}}, bounding_box);
+
+				uint64_t coverage = 0;
+				for (auto y = area.p.y(); y != area.p.y() + area.d.y(); ++y) {
+					for (auto x = area.p.x(); x != area.p.x() + area.d.x(); ++x) {
+						if (covers(edges, calc_barycentric(edges, {real(x), real(y)})) &&
+							(!stencil || stencil->test_and_update(stencil_buffer[y][x][0])))
+						{
+							coverage |= coarse_pixel_bit(x, y);
+						}
+					}
+				}
+
+				if (coverage != 0) {
+					shade_coarse_tile<fragment_program_type>(framebuffer, edges, tile_pos, coverage, rate, shade);
+				}
+			}
+		}
+	}
+
+	template <bool depth_test, typename fragment_program_type, typename vertex_program_res_type>
+	static void rasterize(
+		context& ctx,
+		const fragment_program_type& fragment_program,
+		const processed_face_type<vertex_program_res_type>& face
+	)
+	{
+		bool depth_tested = depth_test && ctx.has_depth_buffer();
+
+		auto setup = setup_triangle(ctx, face, depth_tested);
+		if (!setup.has_value()) {
+			return;
+		}
+
+		const std::array<edge_info, 3>& edges = setup->edges;
+		real triangle_area_doubled = setup->area_doubled;
+		const rectangle& bounding_box = setup->bounding_box;
+
+		ctx.add_damage(bounding_box);
+
+		const auto& framebuffer = ctx.get_framebuffer();
+
+		bool stencil_test = ctx.is_stencil_test_enabled();
+		const auto& stencil = ctx.get_stencil_state();
+
+		r4::vector3<real> depth_reciprocal(
+			1 / std::get<0>(face[0]).w(),
+			1 / std::get<0>(face[1]).w(),
+			1 / std::get<0>(face[2]).w()
+		);
+
+		using framebuffer_pixel_value_type = context::fb_span_type::pixel_type::value_type;
+
+		// constant output is computed once for the whole triangle
+		context::fb_span_type::pixel_type constant_value;
+		if constexpr (fragment_program_traits<fragment_program_type>::constant_output) {
+			constant_value = rasterimage::to<framebuffer_pixel_value_type>(
+				invoke_fragment_program(fragment_program, get_vertex_attributes(face[0]))
+			);
+		}
+
+		auto shade = [&](context::fb_span_type::pixel_type& framebuffer_pixel, const r4::vector3<real>& barycentric) {
+			if constexpr (fragment_program_traits<fragment_program_type>::constant_output) {
+				store_fragment<fragment_program_type>(framebuffer_pixel, constant_value);
+			} else {
+				store_fragment<fragment_program_type>(
+					framebuffer_pixel,
+					rasterimage::to<framebuffer_pixel_value_type>(
+						shade_fragment(fragment_program, face, depth_reciprocal, triangle_area_doubled, barycentric)
+					)
+				);
+			}
+		};
+
+		// constant output is not shaded per pixel anyway
+		auto rate = fragment_program_traits<fragment_program_type>::constant_output
+			? uint32_t(1)
+			: uint32_t(ctx.get_shading_rate());
+
+		auto shade_coarse = [&](const r4::vector3<real>& barycentric) {
+			return rasterimage::to<framebuffer_pixel_value_type>(
+				shade_fragment(fragment_program, face, depth_reciprocal, triangle_area_doubled, barycentric)
+			);
+		};
+
+		if (depth_tested) {
+			if (rate == 1) {
+				rasterize_depth_tested(
+					ctx,
+					setup->get_min_depth(),
+					setup->get_max_depth(),
+					bounding_box,
+					stencil_test ? &stencil : nullptr,
+					[&setup](const r4::vector2<real>& p) {
+						return setup->locate(p);
+					},
+					[&](uint32_t x, uint32_t y, const sample& s) {
+						shade(framebuffer[y][x], s.barycentric);
+					},
+					[](const r4::vector2<uint32_t>&) {}
+				);
+			} else {
+				// tiles of the hierarchical depth buffer are coarse tiles, so pixels which pass the tests
+				// are collected into the coverage mask and shaded when the tile is done
+				uint64_t coverage = 0;
+				rasterize_depth_tested(
+					ctx,
+					setup->get_min_depth(),
+					setup->get_max_depth(),
+					bounding_box,
+					stencil_test ? &stencil : nullptr,
+					[&setup](const r4::vector2<real>& p) {
+						return setup->locate(p);
+					},
+					[&coverage](uint32_t x, uint32_t y, const sample&) {
+						coverage |= coarse_pixel_bit(x, y);
+					},
+					[&](const r4::vector2<uint32_t>& tile_pos) {
+						if (coverage != 0) {
+							shade_coarse_tile<fragment_program_type>(
+								framebuffer,
+								edges,
+								tile_pos,
+								coverage,
+								rate,
+								shade_coarse
+							);
+							coverage = 0;
+						}
+					}
+				);
+			}
+			return;
+		}
+
+		if (rate != 1) {
+			rasterize_coarse<fragment_program_type>(
+				ctx,
+				edges,
+				bounding_box,
+				stencil_test ? &stencil : nullptr,
+				rate,
+				shade_coarse
+			);
+			return;
+		}
+
+		// Triangles of dense meshes cover just a few samples, test them directly
+		// without setting up framebuffer and stencil spans and specialized paths.
+		constexpr uint32_t max_small_triangle_samples = 4;
+		if (bounding_box.d.x() * bounding_box.d.y() <= max_small_triangle_samples) {
+			const auto& stencil_buffer = ctx.get_stencil_buffer();
+
+			for (uint32_t y = bounding_box.p.y(); y != bounding_box.p.y() + bounding_box.d.y(); ++y) {
+				for (uint32_t x = bounding_box.p.x(); x != bounding_box.p.x() + bounding_box.d.x(); ++x) {
+					auto barycentric = calc_barycentric(edges, {real(x), real(y)});
+
+					if (!covers(edges, barycentric)) {
+						continue;
+					}
+
+					if (stencil_test && !stencil.test_and_update(stencil_buffer[y][x][0])) {
+						continue;
+					}
+
+					shade(framebuffer[y][x], barycentric);
+				}
+			}
+			return;
+		}
+
+		auto framebuffer_span = framebuffer.subspan(bounding_box);
+
+		auto stencil_span = stencil_test ? ctx.get_stencil_buffer().subspan(bounding_box) : context::stencil_span_type();
+
+		auto bb_pos = bounding_box.p.to<real>();
+
+		// blended constant output cannot be just filled in, it goes through the generic path
+		if constexpr (fragment_program_traits<fragment_program_type>::constant_output &&
+					  !fragment_program_traits<fragment_program_type>::blended)
+		{
+			rasterize_constant(
+				ctx,
+				edges,
+				constant_value,
+				framebuffer_span,
+				bb_pos,
+				stencil_test ? &stencil : nullptr,
+				stencil_span
+			);
+			return;
+		} else if constexpr (is_gouraud_v<fragment_program_type, vertex_program_res_type>) {
+			if (std::get<0>(face[0]).w() == std::get<0>(face[1]).w() &&
+				std::get<0>(face[1]).w() == std::get<0>(face[2]).w())
+			{
+				if (rasterize_affine_gouraud<vertex_program_res_type>(
+						face,
+						edges,
+						triangle_area_doubled,
+						framebuffer_span,
+						bb_pos,
+						stencil_test ? &stencil : nullptr,
+						stencil_span
+					))
+				{
+					return;
+				}
+			}
+		}
+
+		auto p = bb_pos;
+		uint32_t row = 0;
+		for (auto line : framebuffer_span) {
+			auto stencil_line = stencil_test ? stencil_span[row] : decltype(stencil_span[row])();
+			uint32_t col = 0;
+			for (auto& framebuffer_pixel : line) {
+				auto barycentric = calc_barycentric(edges, p);
+
+				bool overlaps = covers(edges, barycentric);
+
+				// stencil test is done before shading, so masked out pixels are not shaded
+				if (overlaps && stencil_test) {
+					overlaps = stencil.test_and_update(stencil_line[col][0]);
+				}
+
+				if (overlaps) {
+					shade(framebuffer_pixel, barycentric);
+				}
+
+				++p.x();
+				++col;
+			}
+			p.x() = bb_pos.x();
+			++p.y();
+			++row;
+		}
+	}
+
+	template <typename vertex_program_res_type>
+	using processed_quad_type = std::array<vertex_program_res_type, 4>;
+
+	// Quad (0, 1, 2, 3) consists of triangles (0, 1, 2) and (0, 2, 3) sharing the (0, 2) diagonal.
+	template <typename index_type>
+	static std::array<std::array<index_type, 3>, 2> get_quad_triangles(const std::array<index_type, 4>& quad)
+	{
+		return {{{quad[0], quad[1], quad[2]}, {quad[0], quad[2], quad[3]}}};
+	}
+
+	// Rasterize convex quad in one pass over its bounding box.
+	// Both triangles of the quad are set up, then the bounding box is traversed once instead of once per triangle.
+	// With depth test each pixel is located only within the triangle on its side of the shared diagonal,
+	// otherwise each row is filled as the two adjacent spans of the triangles. The result is same as of
+	// rasterizing the triangles one by one. Quads which are not convex on screen, and the cases served by triangle
+	// specific paths, i.e. coarse shading and affine gouraud shading, are rasterized as two triangles.
+	template <bool depth_test, typename fragment_program_type, typename vertex_program_res_type>
+	static void rasterize_quad(
+		context& ctx,
+		const fragment_program_type& fragment_program,
+		const processed_quad_type<vertex_program_res_type>& quad
+	)
+	{
+		using traits = fragment_program_traits<fragment_program_type>;
+
+		std::array<processed_face_type<vertex_program_res_type>, 2> triangles;
+		{
+			auto indices = get_quad_triangles(std::array<unsigned, 4>{0, 1, 2, 3});
+			for (unsigned t = 0; t != triangles.size(); ++t) {
+				for (unsigned i = 0; i != triangles[t].size(); ++i) {
+					triangles[t][i] = quad[indices[t][i]];
+				}
+			}
+		}
+
+		auto rasterize_triangles = [&]() {
+			for (const auto& t : triangles) {
+				rasterize<depth_test>(ctx, fragment_program, t);
+			}
+		};
+
+		if (is_gouraud_v<fragment_program_type, vertex_program_res_type> ||
+			(!traits::constant_output && ctx.get_shading_rate() != shading_rate::one_per_pixel))
+		{
+			rasterize_triangles();
+			return;
+		}
+
+		// the quad is convex and front facing if all its corners turn the same way as front facing triangles do
+		bool convex = true;
+		bool back_facing = true;
+		for (unsigned i = 0; i != quad.size(); ++i) {
+			auto p0 = get_screen_position(quad[i]);
+			auto p1 = get_screen_position(quad[(i + 1) % quad.size()]);
+			auto p2 = get_screen_position(quad[(i + 2) % quad.size()]);
+			auto corner = (p1 - p0).cross(p0 - p2);
+			convex = convex && corner > 0;
+			back_facing = back_facing && corner < 0;
+		}
+
+		if (back_facing) {
+			return;
+		}
+
+		if (!convex) {
+			rasterize_triangles();
+			return;
+		}
+
+		bool depth_tested = depth_test && ctx.has_depth_buffer();
+
+		std::array<std::optional<triangle_setup>, 2> setups = {
+			setup_triangle(ctx, triangles[0], false),
+			setup_triangle(ctx, triangles[1], false)
+		};
+
+		if (!setups[0].has_value() || !setups[1].has_value()) {
+			// one of the triangles lies outside of the render area or is degenerate
+			for (unsigned t = 0; t != triangles.size(); ++t) {
+				if (setups[t].has_value()) {
+					rasterize<depth_test>(ctx, fragment_program, triangles[t]);
+				}
+			}
+			return;
+		}
+
+		auto bounding_box = unite(setups[0]->bounding_box, setups[1]->bounding_box);
+
+		using std::min;
+		using std::max;
+
+		auto min_depth = min(setups[0]->get_min_depth(), setups[1]->get_min_depth());
+
+		if (depth_tested && !ctx.is_stencil_test_enabled() && ctx.get_hi_z().is_occluded(bounding_box, min_depth)) {
+			return;
+		}
+
+		ctx.add_damage(bounding_box);
+
+		const auto& framebuffer = ctx.get_framebuffer();
+
+		bool stencil_test = ctx.is_stencil_test_enabled();
+		const auto& stencil = ctx.get_stencil_state();
+
+		std::array<r4::vector3<real>, 2> depth_reciprocals;
+		for (unsigned t = 0; t != triangles.size(); ++t) {
+			depth_reciprocals[t] = {
+				1 / std::get<0>(triangles[t][0]).w(),
+				1 / std::get<0>(triangles[t][1]).w(),
+				1 / std::get<0>(triangles[t][2]).w()
+			};
+		}
+
+		using framebuffer_pixel_value_type = context::fb_span_type::pixel_type::value_type;
+
+		// constant output is computed once for the whole quad, both triangles start with the quad's first vertex
+		context::fb_span_type::pixel_type constant_value;
+		if constexpr (traits::constant_output) {
+			constant_value = rasterimage::to<framebuffer_pixel_value_type>(
+				invoke_fragment_program(fragment_program, get_vertex_attributes(quad[0]))
+			);
+		}
+
+		auto shade = [&](context::fb_span_type::pixel_type& framebuffer_pixel,
+						 unsigned t,
+						 const r4::vector3<real>& barycentric) {
+			if constexpr (traits::constant_output) {
+				store_fragment<fragment_program_type>(framebuffer_pixel, constant_value);
+			} else {
+				store_fragment<fragment_program_type>(
+					framebuffer_pixel,
+					rasterimage::to<framebuffer_pixel_value_type>(shade_fragment(
+						fragment_program,
+						triangles[t],
+						depth_reciprocals[t],
+						setups[t]->area_doubled,
+						barycentric
+					))
+				);
+			}
+		};
+
+		if (depth_tested) {
+			// the diagonal is the edge of the first triangle opposite to its vertex 1,
+			// it is the second triangle's edge with opposite sign, so every pixel is on one triangle's side only
+			const auto& diagonal = setups[0]->edges[1];
+
+			rasterize_depth_tested(
+				ctx,
+				min_depth,
+				max(setups[0]->get_max_depth(), setups[1]->get_max_depth()),
+				bounding_box,
+				stencil_test ? &stencil : nullptr,
+				[&setups, &diagonal](const r4::vector2<real>& p) {
+					auto value = edge_function(diagonal, p);
+					unsigned t = value > 0 || (value == 0 && is_top_left(diagonal)) ? 0 : 1;
+					return setups[t]->locate(p, t);
+				},
+				[&](uint32_t x, uint32_t y, const sample& s) {
+					shade(framebuffer[y][x], s.triangle, s.barycentric);
+				},
+				[](const r4::vector2<uint32_t>&) {}
+			);
+			return;
+		}
+
+		auto framebuffer_span = framebuffer.subspan(bounding_box);
+		auto stencil_span = stencil_test ? ctx.get_stencil_buffer().subspan(bounding_box) : context::stencil_span_type();
+
+		auto width = framebuffer_span.dims().x();
+
+		// blended constant output cannot be just filled in, it is shaded per pixel
+		constexpr bool fill = traits::constant_output && !traits::blended;
+
+		const auto& kernels = ctx.get_kernels();
+
+		auto row_pos = bounding_box.p.to<real>();
+		uint32_t row = 0;
+		for (auto line : framebuffer_span) {
+			auto stencil_line = stencil_test ? stencil_span[row] : decltype(stencil_span[row])();
+
+			// the triangles' spans within a row of the convex quad are adjacent, unless one of them is empty
+			std::array<std::pair<uint32_t, uint32_t>, 2> spans = {
+				find_covered_span(setups[0]->edges, row_pos, width),
+				find_covered_span(setups[1]->edges, row_pos, width)
+			};
+
+			if (fill && !stencil_test) {
+				auto begin = std::numeric_limits<uint32_t>::max();
+				uint32_t end = 0;
+				for (const auto& [b, e] : spans) {
+					if (b != e) {
+						begin = min(begin, b);
+						end = max(end, e);
+					}
+				}
+				if (begin < end) {
+					kernels.fill(
+						// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+						reinterpret_cast<uint8_t*>(std::next(line.data(), begin)),
+						end - begin,
+						constant_value.data()
+					);
+				}
+			} else {
+				for (unsigned t = 0; t != spans.size(); ++t) {
+					for (auto x = spans[t].first; x != spans[t].second; ++x) {
+						if (stencil_test && !stencil.test_and_update(stencil_line[x][0])) {
+							continue;
+						}
+
+						if constexpr (fill) {
+							line[x] = constant_value;
+						} else {
+							shade(
+								line[x],
+								t,
+								calc_barycentric(setups[t]->edges, {row_pos.x() + real(x), row_pos.y()})
+							);
+						}
+					}
+				}
+			}
+
+			++row_pos.y();
+			++row;
+		}
+	}
+
+	template <typename vertex_program_res_type>
+	using processed_line_type = std::array<vertex_program_res_type, 2>;
+
+	// Lines are rasterized by stepping along the major axis one pixel at a time,
+	// the fragment program is invoked once per step and its result is replicated across the line width.
+	// Pixels are sampled at integer coordinates, the line covers half-open range of major axis coordinates,
+	// so that connected lines do not draw the joint pixel twice.
+	template <typename fragment_program_type, typename vertex_program_res_type>
+	static void rasterize_line(
+		context& ctx,
+		const fragment_program_type& fragment_program,
+		const processed_line_type<vertex_program_res_type>& line
+	)
+	{
+		const auto& p0 = std::get<0>(line[0]);
+		const auto& p1 = std::get<0>(line[1]);
+
+		r4::vector2<real> begin{p0.x(), p0.y()};
+		auto delta = r4::vector2<real>{p1.x(), p1.y()} - begin;
+
+		using std::abs;
+		using std::ceil;
+		using std::floor;
+		using std::min;
+		using std::max;
+
+		unsigned major = abs(delta.x()) >= abs(delta.y()) ? 0 : 1;
+		unsigned minor = 1 - major;
+
+		if (delta[major] == 0) {
+			// zero length line
+			return;
+		}
+
+		const auto& framebuffer = ctx.get_framebuffer();
+
+		const auto& render_area = ctx.get_render_area();
+		auto area_begin = render_area.p.to<int32_t>();
+		auto area_end = (render_area.p + render_area.d).to<int32_t>();
+
+		auto from = min(p0[major], p1[major]);
+		auto to = max(p0[major], p1[major]);
+
+		// clamp to render area in real numbers to avoid integer overflow
+		auto first = int32_t(max(ceil(from), real(area_begin[major])));
+		auto last = int32_t(min(ceil(to), real(area_end[major])));
+
+		if (first >= last) {
+			return;
+		}
+
+		bool stencil_test = ctx.is_stencil_test_enabled();
+		const auto& stencil = ctx.get_stencil_state();
+		const auto& stencil_buffer = ctx.get_stencil_buffer();
+
+		auto width = max(int32_t(std::round(ctx.get_line_width())), int32_t(1));
+		auto half_width = real(width - 1) / 2;
+
+		r4::vector2<real> depth_reciprocal(1 / p0.w(), 1 / p1.w());
+
+		using framebuffer_pixel_value_type = context::fb_span_type::pixel_type::value_type;
+		using traits = fragment_program_traits<fragment_program_type>;
+
+		context::fb_span_type::pixel_type constant_value;
+		if constexpr (traits::constant_output) {
+			constant_value = rasterimage::to<framebuffer_pixel_value_type>(
+				invoke_fragment_program(fragment_program, get_vertex_attributes(line[0]))
+			);
+		}
+
+		// pixels range along the minor axis actually drawn
+		auto drawn_min = area_end[minor];
+		auto drawn_max = area_begin[minor];
+
+		r4::vector2<int32_t> pixel;
+		for (pixel[major] = first; pixel[major] < last; ++pixel[major]) {
+			auto t = (real(pixel[major]) - begin[major]) / delta[major];
+
+			auto minor_first = int32_t(
+				max(floor(begin[minor] + delta[minor] * t - half_width + real(0.5)), real(area_begin[minor] - width))
+			);
+			auto minor_last = min(minor_first + width, area_end[minor]);
+			minor_first = max(minor_first, area_begin[minor]);
+
+			if (minor_first >= minor_last) {
+				continue;
+			}
+
+			drawn_min = min(drawn_min, minor_first);
+			drawn_max = max(drawn_max, minor_last);
+
+			auto value = [&]() {
+				if constexpr (traits::constant_output) {
+					return constant_value;
+				} else if constexpr (!traits::uses_attributes) {
+					return rasterimage::to<framebuffer_pixel_value_type>(fragment_program());
+				} else {
+					r4::vector2<real> weights(1 - t, t);
+
+					real depth = 1 / (depth_reciprocal * weights);
+
+					auto pixel_color = std::apply(
+						fragment_program,
+						[&w = weights, &l = line, &depth]<size_t... i>(std::index_sequence<i...>) {
+							return std::make_tuple((std::get<i>(l[0]) * w[0] + std::get<i>(l[1]) * w[1]) * depth...);
+						}(utki::offset_sequence_t<
+							1,
+							std::make_index_sequence< //
+								std::tuple_size_v<vertex_program_res_type> - 1 //
+								> //
+							>{})
+					);
+
+					return rasterimage::to<framebuffer_pixel_value_type>(pixel_color);
+				}
+			}();
+
+			for (pixel[minor] = minor_first; pixel[minor] < minor_last; ++pixel[minor]) {
+				if (stencil_test && !stencil.test_and_update(stencil_buffer[pixel.y()][pixel.x()][0])) {
+					continue;
+				}
+				store_fragment<fragment_program_type>(framebuffer[pixel.y()][pixel.x()], value);
+			}
+		}
+
+		if (drawn_min < drawn_max) {
+			r4::vector2<uint32_t> damage_pos;
+			r4::vector2<uint32_t> damage_dims;
+			damage_pos[major] = uint32_t(first);
+			damage_dims[major] = uint32_t(last - first);
+			damage_pos[minor] = uint32_t(drawn_min);
+			damage_dims[minor] = uint32_t(drawn_max - drawn_min);
+			ctx.add_damage({damage_pos, damage_dims});
+		}
+	}
+
+	// Points are drawn as squares of context's point size.
+	// If the fragment program accepts point coordinates as extra last argument,
+	// then it is invoked for every pixel of the point with coordinates of the pixel within the point square,
+	// i.e. (0, 0) is top left corner of the point and (1, 1) is bottom right corner.
+	// Otherwise the fragment program is invoked once per point.
+	// Note, that the fragment program is also used for faces and lines of the same mesh,
+	// so it still has to be invocable without the point coordinates.
+	template <typename fragment_program_type, typename vertex_program_res_type>
+	static void rasterize_point(
+		context& ctx,
+		const fragment_program_type& fragment_program,
+		const vertex_program_res_type& point
+	)
+	{
+		const auto& pos = std::get<0>(point);
+
+		using std::ceil;
+		using std::min;
+		using std::max;
+
+		const auto& framebuffer = ctx.get_framebuffer();
+
+		const auto& render_area = ctx.get_render_area();
+
+		auto size = max(ctx.get_point_size(), real(0));
+		auto half_size = size / 2;
+
+		auto p1 = r4::vector2<real>{pos.x() - half_size, pos.y() - half_size};
+		auto p2 = p1 + r4::vector2<real>(size);
+
+		// clamp to render area in real numbers to avoid integer overflow
+		auto first_real = max(ceil(p1), render_area.p.to<real>());
+		auto last_real = min(ceil(p2), (render_area.p + render_area.d).to<real>());
+
+		if (first_real.x() >= last_real.x() || first_real.y() >= last_real.y()) {
+			return;
+		}
+
+		auto first = first_real.to<uint32_t>();
+		auto last = last_real.to<uint32_t>();
+
+		ctx.add_damage({first, last - first});
+
+		// there is nothing to interpolate
+		auto attributes = get_vertex_attributes(point);
+
+		using framebuffer_pixel_value_type = context::fb_span_type::pixel_type::value_type;
+
+		constexpr bool is_sprite = []<typename... attribute_type>(std::tuple<attribute_type...>) constexpr {
+			if constexpr (fragment_program_traits<fragment_program_type>::constant_output) {
+				return false;
+			} else if constexpr (fragment_program_traits<fragment_program_type>::uses_attributes) {
+				return std::is_invocable_v<fragment_program_type, const attribute_type&..., const r4::vector2<real>&>;
+			} else {
+				return std::is_invocable_v<fragment_program_type, const r4::vector2<real>&>;
+			}
+		}(decltype(attributes){});
+
+		bool stencil_test = ctx.is_stencil_test_enabled();
+		const auto& stencil = ctx.get_stencil_state();
+		const auto& stencil_buffer = ctx.get_stencil_buffer();
+
+		if constexpr (is_sprite) {
+			for (uint32_t y = first.y(); y != last.y(); ++y) {
+				for (uint32_t x = first.x(); x != last.x(); ++x) {
+					if (stencil_test && !stencil.test_and_update(stencil_buffer[y][x][0])) {
+						continue;
+					}
+					auto point_coord = (r4::vector2<real>{real(x), real(y)} - p1) / size;
+					auto pixel_color = invoke_fragment_program(fragment_program, attributes, point_coord);
+					store_fragment<fragment_program_type>(
+						framebuffer[y][x],
+						rasterimage::to<framebuffer_pixel_value_type>(pixel_color)
+					);
+				}
+			}
+		} else {
+			auto value = rasterimage::to<framebuffer_pixel_value_type>(invoke_fragment_program(fragment_program, attributes));
+
+			for (uint32_t y = first.y(); y != last.y(); ++y) {
+				auto row = framebuffer[y];
+				if (stencil_test || fragment_program_traits<fragment_program_type>::blended) {
+					for (uint32_t x = first.x(); x != last.x(); ++x) {
+						if (!stencil_test || stencil.test_and_update(stencil_buffer[y][x][0])) {
+							store_fragment<fragment_program_type>(row[x], value);
+						}
+					}
+				} else {
+					ctx.get_kernels().fill(
+						// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+						reinterpret_cast<uint8_t*>(std::next(row.data(), first.x())),
+						last.x() - first.x(),
+						value.data()
+					);
+				}
+			}
+		}
+	}
+
+	template <typename vertex_program_res_type>
+	static vertex_program_res_type perspective_divide(const vertex_program_res_type& vertex)
+	{
+		return std::apply(
+			[]<typename... attribute_type>(const r4::vector4<real>& pos, const attribute_type&... attribute) {
+				return std::make_tuple(
+					r4::vector4<real>(
+						pos.x() / pos.w(), //
+						pos.y() / pos.w(),
+						pos.z() / pos.w(),
+						pos.w()
+					),
+					attribute / pos.w()...
+				);
+			},
+			vertex
+		);
+	}
+
+	// clip edge by z = 0.
+	// return new vertex with z = 0.
+	template <typename vertex_program_res_type>
+	static vertex_program_res_type clip_edge(
+		const vertex_program_res_type& positive_z_vertex,
+		const vertex_program_res_type& negative_z_vertex
+	)
+	{
+		const auto& pv_pos = std::get<0>(positive_z_vertex);
+		auto& nv_pos = std::get<0>(negative_z_vertex);
+
+		ASSERT(nv_pos.z() < 0)
+		ASSERT(pv_pos.z() >= 0)
+		auto edge = pv_pos - nv_pos;
+		ASSERT(edge.z() > 0)
+		auto factor = -nv_pos.z() / edge.z();
+		ASSERT(factor >= 0)
+		ASSERT(factor <= 1)
+
+		return
+			[&pv = positive_z_vertex, &nv = negative_z_vertex, factor, &edge]<size_t... i>(std::index_sequence<i...>) {
+				return std::make_tuple(
+					std::get<0>(nv) + edge * factor,
+					std::get<i>(nv) * (real(1) - factor) + std::get<i>(pv) * factor...
+				);
+			}(utki::offset_sequence_t<
+				1,
+				std::make_index_sequence< //
+					std::tuple_size_v<vertex_program_res_type> - 1 //
+					> //
+				>{});
+	}
+
+	// clip face by (z < 0) half-space
+	template <typename vertex_program_res_type>
+	static utki::span<processed_face_type<vertex_program_res_type>> clip(
+		std::array<processed_face_type<vertex_program_res_type>, 2>& faces
+	)
+	{
+		// the function is called for each face, so avoid heap allocations
+		std::array<unsigned, 3> negative_indices_buffer{};
+		size_t num_negative_indices = 0;
+
+		std::array<unsigned, 3> positive_indices_buffer{};
+		size_t num_positive_indices = 0;
+
+		for (unsigned i = 0; i != faces.front().size(); ++i) {
+			if (std::get<0>(faces.front()[i]).z() < 0) {
+				negative_indices_buffer[num_negative_indices++] = i;
+			} else {
+				positive_indices_buffer[num_positive_indices++] = i;
+			}
+		}
+
+		auto negative_indices = utki::make_span(negative_indices_buffer.data(), num_negative_indices);
+		auto positive_indices = utki::make_span(positive_indices_buffer.data(), num_positive_indices);
+
+		if (negative_indices.empty()) {
+			ASSERT(positive_indices.size() == 3)
+			// the face is completely ahead of the near plane
+			return utki::span(faces.data(), 1);
+		}
+
+		if (negative_indices.size() == 3) {
+			ASSERT(positive_indices.empty())
+			// face is completely behind near plane
+			return {};
+		}
+
+		// TODO: optimization: drop faces which are completely out of screen
+
+		switch (negative_indices.size()) {
+			default:
+				ASSERT(false)
+				break;
+			case 1:
+				ASSERT(negative_indices.size() == 1)
+				ASSERT(positive_indices.size() == 2)
+				// 1 triangle turns into 2 triangles
+				{
+					auto& negative_vertex = faces.front()[negative_indices[0]];
+
+					faces[1][negative_indices[0]] = faces[0][positive_indices[1]];
+					faces[1][positive_indices[1]] = clip_edge(faces[0][positive_indices[0]], negative_vertex);
+					faces[1][positive_indices[0]] = clip_edge(faces[0][positive_indices[1]], negative_vertex);
+
+					faces[0][negative_indices[0]] = faces[1][positive_indices[1]];
+				}
+				return utki::span(faces.data(), 2);
+			case 2:
+				// 1 triangle remains 1 triangle
+				ASSERT(negative_indices.size() == 2)
+				ASSERT(positive_indices.size() == 1)
+				{
+					const auto& positive_vertex = faces.front()[positive_indices.front()];
+					for (auto i : negative_indices) {
+						auto& negative_vertex = faces.front()[i];
+
+						negative_vertex = clip_edge(positive_vertex, negative_vertex);
+					}
+				}
+				return utki::span(faces.data(), 1);
+		}
+
+		return {};
+	}
+
+	// process_vertex(index) returns vertex program result for the vertex with given index,
+	// rasterize_face(face) is called for each face after clipping and perspective divide
+	template <bool clip_faces, typename index_type, typename process_vertex_type, typename rasterize_face_type>
+	static void process_faces(
+		utki::span<const std::array<index_type, 3>> faces,
+		const process_vertex_type& process_vertex,
+		const rasterize_face_type& rasterize_face
+	)
+	{
+		using vertex_program_res_type = std::remove_cvref_t<std::invoke_result_t<process_vertex_type, unsigned>>;
+
+		for (const auto& unprocessed_face : faces) {
+			// clang-format off
+			std::array<processed_face_type<vertex_program_res_type>, 2> processed_faces{{
+				{
+					process_vertex(unprocessed_face[0]),
+					process_vertex(unprocessed_face[1]),
+					process_vertex(unprocessed_face[2])
+				},
+ 				{}
+			}};
+			// clang-format on
+
+			auto clipped_faces = [&processed_faces]() {
+				if constexpr (clip_faces) {
+					return clip(processed_faces);
+				} else {
+					return utki::span(processed_faces.data(), 1);
+				}
+			}();
+
+			for (auto& face : clipped_faces) {
+				for (auto& f : face) {
+					f = perspective_divide(f);
+				}
+
+				rasterize_face(face);
+			}
+		}
+	}
+
+	// clip line by (z < 0) half-space,
+	// returns false if the line is completely clipped out
+	template <typename vertex_program_res_type>
+	static bool clip(processed_line_type<vertex_program_res_type>& line)
+	{
+		bool negative_0 = std::get<0>(line[0]).z() < 0;
+		bool negative_1 = std::get<0>(line[1]).z() < 0;
+
+		if (negative_0 && negative_1) {
+			return false;
+		}
+
+		if (negative_0) {
+			line[0] = clip_edge(line[1], line[0]);
+		} else if (negative_1) {
+			line[1] = clip_edge(line[0], line[1]);
+		}
+
+		return true;
+	}
+
+	// process_vertex(index) returns vertex program result for the vertex with given index
+	template <bool clip_primitives, typename fragment_program_type, typename process_vertex_type>
+	static void process_lines_and_points(
+		context& ctx,
+		const fragment_program_type& fragment_program,
+		utki::span<const std::array<unsigned, 2>> lines,
+		utki::span<const unsigned> points,
+		const process_vertex_type& process_vertex
+	)
+	{
+		using vertex_program_res_type = std::remove_cvref_t<std::invoke_result_t<process_vertex_type, unsigned>>;
+
+		for (const auto& unprocessed_line : lines) {
+			processed_line_type<vertex_program_res_type> line = {
+				process_vertex(unprocessed_line[0]),
+				process_vertex(unprocessed_line[1])
+			};
+
+			if constexpr (clip_primitives) {
+				if (!clip(line)) {
+					continue;
+				}
+			}
+
+			for (auto& v : line) {
+				v = perspective_divide(v);
+			}
+
+			rasterize_line(ctx, fragment_program, line);
+		}
+
+		for (auto index : points) {
+			vertex_program_res_type point = process_vertex(index);
+
+			if constexpr (clip_primitives) {
+				if (std::get<0>(point).z() < 0) {
+					continue;
+				}
+			}
+
+			rasterize_point(ctx, fragment_program, perspective_divide(point));
+		}
+	}
+
+public:
+	enum class visibility {
+		outside,
+		intersecting,
+		inside
+	};
+
+	// Test bounding volume against the clip volume of the given matrix.
+	// The clip volume is the (z >= 0) half-space and the context's render area.
+	// The margin is the screen-space extent of primitives beyond their vertex positions, e.g. half of the point size,
+	// the volume is reported as outside only if it is outside of the render area expanded by the margin.
+	// Empty bounds mean that the bounds are unknown, e.g. mesh_view filled by hand without computing the bounds,
+	// so the volume is reported as intersecting the clip volume.
+	static visibility test_visibility(
+		context& ctx,
+		const r4::matrix4<real>& matrix,
+		const bounding_volume& bounds,
+		real margin = 0
+	)
+	{
+		if (bounds.empty()) {
+			return visibility::intersecting;
+		}
+
+		enum outcode : unsigned {
+			behind_near_plane = 1 << 0,
+			behind_eye = 1 << 1,
+			left = 1 << 2,
+			right = 1 << 3,
+			above = 1 << 4,
+			below = 1 << 5
+		};
+
+		const auto& render_area = ctx.get_render_area();
+		auto area_begin = render_area.p.to<real>();
+		auto area_end = (render_area.p + render_area.d).to<real>();
+		auto expanded_area_begin = area_begin - r4::vector2<real>(margin);
+		auto expanded_area_end = area_end + r4::vector2<real>(margin);
+
+		// compare in homogeneous coordinates to avoid perspective divide,
+		// valid only for points in front of the eye
+		auto get_area_outcode = [](const r4::vector4<real>& p, const auto& begin, const auto& end) {
+			unsigned code = 0;
+
+			if (p.x() < begin.x() * p.w()) {
+				code |= left;
+			} else if (p.x() > end.x() * p.w()) {
+				code |= right;
+			}
+
+			if (p.y() < begin.y() * p.w()) {
+				code |= above;
+			} else if (p.y() > end.y() * p.w()) {
+				code |= below;
+			}
+
+			return code;
+		};
+
+		// outcode bits shared by all box corners, tested against the render area expanded by the margin
+		unsigned common_outcode = ~0u;
+
+		// outcode bits of any of the box corners
+		unsigned any_outcode = 0;
+
+		constexpr auto num_box_corners = 8;
+		for (unsigned i = 0; i != num_box_corners; ++i) {
+			auto corner = r4::vector3<real>(
+				(i & 1) ? bounds.max.x() : bounds.min.x(),
+				(i & 2) ? bounds.max.y() : bounds.min.y(),
+				(i & 4) ? bounds.max.z() : bounds.min.z()
+			);
+
+			r4::vector4<real> p = matrix * corner;
+
+			unsigned code = 0;
+
+			if (p.z() < 0) {
+				code |= behind_near_plane;
+			}
+
+			if (p.w() <= 0) {
+				code |= behind_eye;
+				common_outcode &= code;
+				any_outcode |= code;
+			} else {
+				common_outcode &= code | get_area_outcode(p, expanded_area_begin, expanded_area_end);
+				any_outcode |= code | get_area_outcode(p, area_begin, area_end);
+			}
+		}
+
+		if (common_outcode != 0) {
+			// all corners are outside of the same clip plane
+			return visibility::outside;
+		}
+
+		if (any_outcode == 0) {
+			return visibility::inside;
+		}
+
+		return visibility::intersecting;
+	}
+
+	// Test bounding volume against the context's hierarchical depth buffer.
+	// Returns true if the volume is certainly hidden behind already rendered geometry,
+	// so that the mesh does not need to be rendered with depth test.
+	// Volumes crossing the (z = 0) plane are never reported as occluded.
+	// Nothing is reported as occluded if stencil test is enabled, because hidden fragments still update the stencil.
+	static bool is_occluded(const context& ctx, const r4::matrix4<real>& matrix, const bounding_volume& bounds)
+	{
+		if (!ctx.has_depth_buffer() || ctx.is_stencil_test_enabled() || bounds.empty()) {
+			return false;
+		}
+
+		using std::min;
+		using std::max;
+		using std::ceil;
+		using std::floor;
+
+		r4::vector2<real> min_pos(std::numeric_limits<real>::max());
+		r4::vector2<real> max_pos(std::numeric_limits<real>::lowest());
+		real min_depth = std::numeric_limits<real>::max();
+
+		constexpr auto num_box_corners = 8;
+		for (unsigned i = 0; i != num_box_corners; ++i) {
+			auto corner = r4::vector3<real>(
+				(i & 1) ? bounds.max.x() : bounds.min.x(),
+				(i & 2) ? bounds.max.y() : bounds.min.y(),
+				(i & 4) ? bounds.max.z() : bounds.min.z()
+			);
+
+			r4::vector4<real> p = matrix * corner;
+
+			if (p.z() < 0 || p.w() <= 0) {
+				return false;
+			}
+
+			r4::vector2<real> pos{p.x() / p.w(), p.y() / p.w()};
+			min_pos = min(min_pos, pos);
+			max_pos = max(max_pos, pos);
+			min_depth = min(min_depth, p.z() / p.w());
+		}
+
+		// samples covered by the projected box, clamped to the render area in real numbers to avoid integer overflow
+		const auto& render_area = ctx.get_render_area();
+		auto p1 = max(ceil(min_pos), render_area.p.to<real>());
+		auto p2 = min(floor(max_pos) + r4::vector2<real>(1), (render_area.p + render_area.d).to<real>());
+
+		if (p1.x() >= p2.x() || p1.y() >= p2.y()) {
+			// covers no samples within the render area
+			return false;
+		}
+
+		auto area_p1 = p1.to<uint32_t>();
+		return ctx.get_hi_z().is_occluded({area_p1, p2.to<uint32_t>() - area_p1}, float(min_depth));
+	}
+
+private:
+	template <bool depth_test, typename fragment_program_type, typename index_type, typename process_vertex_type>
+	static void render_faces(
+		context& ctx,
+		visibility vis,
+		const fragment_program_type& fragment_program,
+		utki::span<const std::array<index_type, 3>> faces,
+		const process_vertex_type& process_vertex
+	)
+	{
+		ASSERT(vis != visibility::outside)
+
+		CPUGL_TRACE_SCOPE(ctx.get_tracer(), "faces");
+
+		auto rasterize_face = [&](const auto& face) {
+			rasterize<depth_test>(ctx, fragment_program, face);
+		};
+
+		if (vis == visibility::inside) {
+			// faces cannot cross the clip volume boundaries, no need to clip them
+			process_faces<false>(faces, process_vertex, rasterize_face);
+		} else {
+			process_faces<true>(faces, process_vertex, rasterize_face);
+		}
+	}
+
+	// process_vertex(index) returns vertex program result for the vertex with given index
+	template <bool depth_test, typename fragment_program_type, typename process_vertex_type>
+	static void render_quads(
+		context& ctx,
+		visibility vis,
+		const fragment_program_type& fragment_program,
+		utki::span<const std::array<unsigned, 4>> quads,
+		const process_vertex_type& process_vertex
+	)
+	{
+		ASSERT(vis != visibility::outside)
+
+		if (quads.empty()) {
+			return;
+		}
+
+		CPUGL_TRACE_SCOPE(ctx.get_tracer(), "quads");
+
+		using vertex_program_res_type = std::remove_cvref_t<std::invoke_result_t<process_vertex_type, unsigned>>;
+
+		for (const auto& unprocessed_quad : quads) {
+			// clang-format off
+			processed_quad_type<vertex_program_res_type> quad = {
+				process_vertex(unprocessed_quad[0]),
+				process_vertex(unprocessed_quad[1]),
+				process_vertex(unprocessed_quad[2]),
+				process_vertex(unprocessed_quad[3])
+			};
+			// clang-format on
+
+			if (vis != visibility::inside && std::any_of(quad.begin(), quad.end(), [](const auto& v) {
+					return std::get<0>(v).z() < 0;
+				}))
+			{
+				// the quad crosses the near plane, it is clipped as two triangles
+				const auto triangles = get_quad_triangles(std::array<unsigned, 4>{0, 1, 2, 3});
+				process_faces<true>(
+					utki::make_span(triangles),
+					[&quad](unsigned index) -> const vertex_program_res_type& {
+						return quad[index];
+					},
+					[&](const auto& face) {
+						rasterize<depth_test>(ctx, fragment_program, face);
+					}
+				);
+				continue;
+			}
+
+			for (auto& v : quad) {
+				v = perspective_divide(v);
+			}
+
+			rasterize_quad<depth_test>(ctx, fragment_program, quad);
+		}
+	}
+
+	// Calculate eye position in homogeneous coordinates, i.e. the point which the matrix maps to (0, 0, z, 0).
+	// It is calculated as cofactors of the matrix row which produces z coordinate,
+	// so the result is the eye position scaled by the matrix determinant.
+	// Such scaling makes the sign of face orientation test independent of the matrix handedness:
+	// face is back-facing, i.e. is discarded by rasterize(), when n * (e.xyz - e.w * v) >= 0,
+	// where e is the returned vector, n is the face normal (v1 - v0) x (v2 - v0) and v is any of the face vertices.
+	static r4::vector4<real> calc_eye(const r4::matrix4<real>& m)
+	{
+		constexpr unsigned z_row = 2;
+
+		auto calc_cofactor = [&m](unsigned col) {
+			std::array<unsigned, 3> cols{};
+			for (unsigned i = 0, j = 0; i != 4; ++i) {
+				if (i != col) {
+					cols[j] = i;
+					++j;
+				}
+			}
+
+			const auto& a = m[0];
+			const auto& b = m[1];
+			const auto& c = m[3];
+
+			auto minor = a[cols[0]] * (b[cols[1]] * c[cols[2]] - b[cols[2]] * c[cols[1]]) -
+				a[cols[1]] * (b[cols[0]] * c[cols[2]] - b[cols[2]] * c[cols[0]]) +
+				a[cols[2]] * (b[cols[0]] * c[cols[1]] - b[cols[1]] * c[cols[0]]);
+
+			return (z_row + col) % 2 == 0 ? minor : -minor;
+		};
+
+		return {calc_cofactor(0), calc_cofactor(1), calc_cofactor(2), calc_cofactor(3)};
+	}
+
+	// check if all cluster's faces are back-facing using cluster's normal cone and bounding sphere,
+	// see calc_eye() for the back-facing condition
+	static bool is_back_facing(const r4::vector4<real>& eye, const cluster& c)
+	{
+		if (c.cone_cutoff >= 1) {
+			return false;
+		}
+
+		using std::abs;
+
+		// (e.xyz - e.w * v) for all cluster vertices lie within the sphere
+		auto center = r4::vector3<real>(eye.x(), eye.y(), eye.z()) - c.bounds.center * eye.w();
+		auto radius = abs(eye.w()) * c.bounds.radius;
+
+		// all vectors within the sphere must be within (90 - cone half-angle) degrees from the cone axis
+		return c.cone_axis * center - radius >= c.cone_cutoff * (center.norm() + radius);
+	}
+
+	// process_vertex(vertex) returns vertex program result for the mesh vertex
+	template <bool depth_test, typename fragment_program_type, typename process_vertex_type, typename... attribute_type>
+	static void render_clusters(
+		context& ctx,
+		const r4::matrix4<real>& matrix,
+		visibility vis,
+		const fragment_program_type& fragment_program,
+		const mesh_view<attribute_type...>& mesh,
+		const process_vertex_type& process_vertex
+	)
+	{
+		using vertex_program_res_type = std::remove_cvref_t<
+			std::invoke_result_t<process_vertex_type, const typename mesh_view<attribute_type...>::vertex_type&>>;
+
+		CPUGL_TRACE_SCOPE(ctx.get_tracer(), "clusters");
+
+		auto eye = calc_eye(matrix);
+
+		std::array<vertex_program_res_type, cluster::max_vertices> processed_vertices;
+
+		for (const auto& c : mesh.clusters) {
+			auto cluster_vis = vis == visibility::inside ? visibility::inside : test_visibility(ctx, matrix, c.bounds);
+			if (cluster_vis == visibility::outside) {
+				continue;
+			}
+
+			if (depth_test && is_occluded(ctx, matrix, c.bounds)) {
+				continue;
+			}
+
+			if (is_back_facing(eye, c)) {
+				continue;
+			}
+
+			ASSERT(c.vertices.size() <= processed_vertices.size())
+			std::transform(c.vertices.begin(), c.vertices.end(), processed_vertices.begin(), [&](unsigned i) {
+				return process_vertex(mesh.vertices[i]);
+			});
+
+			render_faces<depth_test>(
+				ctx,
+				cluster_vis,
+				fragment_program,
+				utki::make_span(c.faces),
+				[&processed_vertices](unsigned index) -> const vertex_program_res_type& {
+					return processed_vertices[index];
+				}
+			);
+		}
+	}
+
+	// Screen-space extent of the mesh's lines and points beyond their vertex positions,
+	// one extra pixel accounts for rounding of the line and point pixel ranges.
+	template <typename... attribute_type>
+	static real get_primitive_margin(const context& ctx, const mesh_view<attribute_type...>& mesh)
+	{
+		using std::max;
+
+		real size = 0;
+		if (!mesh.lines.empty()) {
+			size = max(size, std::round(ctx.get_line_width()));
+		}
+		if (!mesh.points.empty()) {
+			size = max(size, ctx.get_point_size());
+		}
+
+		if (size <= 0) {
+			return 0;
+		}
+
+		return size / 2 + 1;
+	}
+
+	template <typename fragment_program_type, typename process_vertex_type>
+	static void render_lines_and_points(
+		context& ctx,
+		visibility vis,
+		const fragment_program_type& fragment_program,
+		utki::span<const std::array<unsigned, 2>> lines,
+		utki::span<const unsigned> points,
+		const process_vertex_type& process_vertex
+	)
+	{
+		ASSERT(vis != visibility::outside)
+
+		if (lines.empty() && points.empty()) {
+			return;
+		}
+
+		CPUGL_TRACE_SCOPE(ctx.get_tracer(), "lines and points");
+
+		if (vis == visibility::inside) {
+			process_lines_and_points<false>(ctx, fragment_program, lines, points, process_vertex);
+		} else {
+			process_lines_and_points<true>(ctx, fragment_program, lines, points, process_vertex);
+		}
+	}
+
+	template <typename vertex_program_res_type>
+	static void check_vertex_program_res_type()
+	{
+		static_assert(
+			utki::is_specialization_of_v<std::tuple, vertex_program_res_type>,
+			"vertex program return type must be std::tuple"
+		);
+
+		static_assert(
+			std::is_same_v<r4::vector4<real>, std::tuple_element_t<0, vertex_program_res_type>>,
+			"first element of vertex program return tuple must be r4::vector4<real>"
+		);
+	}
+
+	// Vertices are processed in chunks of this size, in parallel if context has a thread pool.
+	// Meshes with fewer vertices are processed on the calling thread.
+	constexpr static size_t vertex_chunk_size = 4096;
+
+	// The process_vertex is called concurrently from the context's thread pool threads,
+	// so vertex programs must not modify shared state.
+	template <typename vertex_type, typename process_vertex_type, typename out_vector_type>
+	static void process_vertices(
+		const context& ctx,
+		utki::span<const vertex_type> vertices,
+		const process_vertex_type& process_vertex,
+		out_vector_type& out
+	)
+	{
+		out.resize(vertices.size());
+
+		auto process_range = [&](size_t begin, size_t end) {
+			CPUGL_TRACE_SCOPE(ctx.get_tracer(), "vertices");
+			std::transform(
+				std::next(vertices.begin(), ptrdiff_t(begin)),
+				std::next(vertices.begin(), ptrdiff_t(end)),
+				std::next(out.begin(), ptrdiff_t(begin)),
+				process_vertex
+			);
+		};
+
+		auto pool = ctx.get_thread_pool();
+		if (!pool) {
+			process_range(0, vertices.size());
+			return;
+		}
+
+		pool->parallel_for(vertices.size(), vertex_chunk_size, process_range);
+	}
+
+	// The processed_vertices is the storage for vertex program results, so that callers choose where they are allocated.
+	template <
+		bool depth_test,
+		typename vertex_program_type,
+		typename fragment_program_type,
+		typename out_vector_type,
+		typename... attribute_type>
+	static void render_mesh(
+		context& ctx,
+		const r4::matrix4<real>& matrix,
+		const vertex_program_type& vertex_program,
+		const fragment_program_type& fragment_program,
+		const mesh_view<attribute_type...>& mesh,
+		out_vector_type& processed_vertices
+	)
+	{
+		using vertex_program_res_type = typename out_vector_type::value_type;
+
+		auto vis = test_visibility(ctx, matrix, mesh.bounds, get_primitive_margin(ctx, mesh));
+		if (vis == visibility::outside) {
+			return;
+		}
+
+		// lines and points are not depth tested, so they are drawn even if the mesh is occluded
+		bool occluded = depth_test && is_occluded(ctx, matrix, mesh.bounds);
+		if (occluded && mesh.lines.empty() && mesh.points.empty()) {
+			return;
+		}
+
+		auto process_vertex = [&vertex_program](const auto& vertex) -> vertex_program_res_type {
+			return std::apply(vertex_program, vertex);
+		};
+
+		if (occluded || !mesh.clusters.empty()) {
+			if (!occluded) {
+				// only vertices of visible clusters are processed
+				render_clusters<depth_test>(ctx, matrix, vis, fragment_program, mesh, process_vertex);
+			}
+
+			// quads, lines and points are not clustered,
+			// only vertices of lines and points are processed if the mesh is occluded
+			auto process_indexed_vertex = [&process_vertex, &vertices = mesh.vertices](unsigned index) {
+				return process_vertex(vertices[index]);
+			};
+
+			if (!occluded) {
+				render_quads<depth_test>(ctx, vis, fragment_program, mesh.quads, process_indexed_vertex);
+			}
+
+			render_lines_and_points(ctx, vis, fragment_program, mesh.lines, mesh.points, process_indexed_vertex);
+			return;
+		}
+
+		// vertex stage, each vertex is processed once, no matter how many primitives share it
+		process_vertices(ctx, mesh.vertices, process_vertex, processed_vertices);
+
+		auto get_processed_vertex = [&processed_vertices](unsigned index) -> const vertex_program_res_type& {
+			return processed_vertices[index];
+		};
+
+		render_faces<depth_test>(ctx, vis, fragment_program, mesh.faces, get_processed_vertex);
+
+		render_quads<depth_test>(ctx, vis, fragment_program, mesh.quads, get_processed_vertex);
+
+		render_lines_and_points(ctx, vis, fragment_program, mesh.lines, mesh.points, get_processed_vertex);
+	}
+
+public:
+	// The matrix is the transformation which vertex program applies to vertex positions,
+	// it is used to cull the whole mesh by its bounds before processing any vertices.
+	// If the mesh has clusters, then each cluster is culled by its bounds and normal cone as well.
+	template <bool depth_test, typename vertex_program_type, typename fragment_program_type, typename... attribute_type>
+	static void render(
+		context& ctx,
+		const r4::matrix4<real>& matrix,
+		const vertex_program_type& vertex_program,
+		const fragment_program_type& fragment_program,
+		const mesh_view<attribute_type...>& mesh
+	)
+	{
+		static_assert(
+			[]<typename... arg_type>(std::tuple<arg_type...>) constexpr {
+				return std::is_invocable_v<decltype(vertex_program), const r4::vector3<real>&, const arg_type&...>;
+			}(std::tuple<attribute_type...>{}),
+			"vertex_program must be invocable"
+		);
+
+		using vertex_program_res_type = decltype( //
+			vertex_program( //
+				std::declval<r4::vector4<real>>(),
+				std::declval<attribute_type>()...
+			)
+		);
+
+		check_vertex_program_res_type<vertex_program_res_type>();
+
+		CPUGL_TRACE_SCOPE(ctx.get_tracer(), "render");
+
+		frame_arena::vector<vertex_program_res_type> processed_vertices(ctx.get_frame_allocator());
+		render_mesh<depth_test>(ctx, matrix, vertex_program, fragment_program, mesh, processed_vertices);
+	}
+
+	template <bool depth_test, typename vertex_program_type, typename fragment_program_type, typename... attribute_type>
+	static void render(
+		context& ctx,
+		const r4::matrix4<real>& matrix,
+		const vertex_program_type& vertex_program,
+		const fragment_program_type& fragment_program,
+		const mesh<attribute_type...>& mesh
+	)
+	{
+		render<depth_test>(ctx, matrix, vertex_program, fragment_program, mesh.view());
+	}
+
+	// Render the mesh which is produced chunk by chunk, e.g. generated or decompressed on the fly.
+	// The produce(chunk) fills the empty chunk and returns true, or returns false when there are no more chunks.
+	// Faces, quads, lines and points of a chunk index the chunk's vertices, bounds of the chunk are updated by the pipeline.
+	// The next chunk is produced on a producer thread, started once per draw, while the current one is rendered,
+	// so at most two chunks exist at a time and their memory is reused, whatever the size of the whole mesh is.
+	// The chunks are the storage for the two chunks, it can be kept by the caller to reuse the memory across draws.
+	// The produce is called only from the producer thread.
+	// Exception thrown by the produce is rethrown after rendering of the already produced chunks is done.
+	template <
+		bool depth_test,
+		typename vertex_program_type,
+		typename fragment_program_type,
+		typename producer_type,
+		typename... attribute_type>
+	static void render_stream(
+		context& ctx,
+		const r4::matrix4<real>& matrix,
+		const vertex_program_type& vertex_program,
+		const fragment_program_type& fragment_program,
+		const producer_type& produce,
+		std::array<mesh<attribute_type...>, 2>& chunks
+	)
+	{
+		using vertex_program_res_type = decltype( //
+			vertex_program( //
+				std::declval<r4::vector4<real>>(),
+				std::declval<attribute_type>()...
+			)
+		);
+
+		check_vertex_program_res_type<vertex_program_res_type>();
+
+		CPUGL_TRACE_SCOPE(ctx.get_tracer(), "render stream");
+
+		auto produce_chunk = [&ctx, &produce](mesh<attribute_type...>& chunk) {
+			CPUGL_TRACE_SCOPE(ctx.get_tracer(), "produce chunk");
+
+			chunk.vertices.clear();
+			chunk.faces.clear();
+			chunk.quads.clear();
+			chunk.lines.clear();
+			chunk.points.clear();
+			chunk.clusters.clear();
+
+			if (!produce(chunk)) {
+				return false;
+			}
+
+			chunk.update_bounds();
+			return true;
+		};
+
+		// Chunk number i is stored in chunks[i % 2]. The producer fills a chunk only after the chunk which
+		// was stored in the same slot before is rendered.
+		std::mutex mutex;
+		std::condition_variable cond_var;
+		size_t num_produced = 0;
+		size_t num_rendered = 0;
+
+		// set by the producer when there are no more chunks, or when the produce has thrown
+		bool produced_all = false;
+		std::exception_ptr exception;
+
+		// set when rendering is over, e.g. because it has thrown, so that the producer does not fill more chunks
+		bool stop = false;
+
+		{
+			std::thread producer([&]() {
+				for (size_t i = 0;; ++i) {
+					{
+						std::unique_lock lock(mutex);
+						cond_var.wait(lock, [&]() {
+							return stop || i < num_rendered + chunks.size();
+						});
+						if (stop) {
+							return;
+						}
+					}
+
+					bool produced = false;
+					std::exception_ptr e;
+					try {
+						produced = produce_chunk(chunks[i % chunks.size()]);
+					} catch (...) {
+						e = std::current_exception();
+					}
+
+					std::lock_guard lock(mutex);
+					if (!produced) {
+						produced_all = true;
+						exception = e;
+						cond_var.notify_all();
+						return;
+					}
+					++num_produced;
+					cond_var.notify_all();
+				}
+			});
+
+			utki::scope_exit producer_scope_exit([&]() {
+				{
+					std::lock_guard lock(mutex);
+					stop = true;
+				}
+				cond_var.notify_all();
+				producer.join();
+			});
+
+			// Vertex program results are stored out of the frame arena, because the arena would grow with each chunk.
+			std::vector<vertex_program_res_type> processed_vertices;
+
+			for (size_t i = 0;; ++i) {
+				{
+					std::unique_lock lock(mutex);
+					cond_var.wait(lock, [&]() {
+						return i < num_produced || produced_all;
+					});
+					if (i == num_produced) {
+						break;
+					}
+				}
+
+				const auto& chunk = chunks[i % chunks.size()];
+				render_mesh<depth_test>(ctx, matrix, vertex_program, fragment_program, chunk.view(), processed_vertices);
+
+				{
+					std::lock_guard lock(mutex);
+					++num_rendered;
+				}
+				cond_var.notify_all();
+			}
+		}
+
+		if (exception) {
+			std::rethrow_exception(exception);
+		}
+	}
+
+	// Render the mesh once per instance.
+	// The vertex program is invoked with the instance as first argument followed by vertex attributes.
+	// Each vertex is processed only once per instance, regardless of how many faces share it.
+	// The instance_type must have 'matrix' member, see render() for how it is used.
+	template <
+		bool depth_test,
+		typename vertex_program_type,
+		typename fragment_program_type,
+		typename instance_type,
+		typename... attribute_type>
+	static void render_instanced(
+		context& ctx,
+		const vertex_program_type& vertex_program,
+		const fragment_program_type& fragment_program,
+		const mesh_view<attribute_type...>& mesh,
+		utki::span<const instance_type> instances
+	)
+	{
+		static_assert(
+			[]<typename... arg_type>(std::tuple<arg_type...>) constexpr {
+				return std::is_invocable_v<
+					decltype(vertex_program),
+					const instance_type&,
+					const r4::vector3<real>&,
+					const arg_type&...>;
+			}(std::tuple<attribute_type...>{}),
+			"vertex_program must be invocable"
+		);
+
+		using vertex_program_res_type = decltype( //
+			vertex_program( //
+				std::declval<const instance_type&>(),
+				std::declval<r4::vector4<real>>(),
+				std::declval<attribute_type>()...
+			)
+		);
+
+		check_vertex_program_res_type<vertex_program_res_type>();
+
+		CPUGL_TRACE_SCOPE(ctx.get_tracer(), "render instanced");
+
+		if (instances.empty() || mesh.vertices.empty()) {
+			return;
+		}
+
+		// the buffer is reused for all instances
+		frame_arena::vector<vertex_program_res_type> processed_vertices(ctx.get_frame_allocator());
+
+		auto margin = get_primitive_margin(ctx, mesh);
+
+		for (const auto& inst : instances) {
+			auto vis = test_visibility(ctx, inst.matrix, mesh.bounds, margin);
+			if (vis == visibility::outside) {
+				continue;
+			}
+
+			// lines and points are not depth tested, so they are drawn even if the instance is occluded
+			bool occluded = depth_test && is_occluded(ctx, inst.matrix, mesh.bounds);
+			if (occluded && mesh.lines.empty() && mesh.points.empty()) {
+				continue;
+			}
+
+			auto process_vertex = [&vertex_program, &inst](const auto& vertex) -> vertex_program_res_type {
+				return std::apply(
+					[&vertex_program, &inst](const auto&... attribute) {
+						return vertex_program(inst, attribute...);
+					},
+					vertex
+				);
+			};
+
+			if (occluded || !mesh.clusters.empty()) {
+				if (!occluded) {
+					render_clusters<depth_test>(ctx, inst.matrix, vis, fragment_program, mesh, process_vertex);
+				}
+
+				auto process_indexed_vertex = [&process_vertex, &vertices = mesh.vertices](unsigned index) {
+					return process_vertex(vertices[index]);
+				};
+
+				if (!occluded) {
+					render_quads<depth_test>(ctx, vis, fragment_program, mesh.quads, process_indexed_vertex);
+				}
+
+				render_lines_and_points(ctx, vis, fragment_program, mesh.lines, mesh.points, process_indexed_vertex);
+				continue;
+			}
+
+			process_vertices(ctx, mesh.vertices, process_vertex, processed_vertices);
+
+			auto get_processed_vertex = [&processed_vertices](unsigned index) -> const vertex_program_res_type& {
+				return processed_vertices[index];
+			};
+
+			render_faces<depth_test>(
+				ctx,
+				vis,
+				fragment_program,
+				mesh.faces,
+				get_processed_vertex
+			);
+
+			render_quads<depth_test>(ctx, vis, fragment_program, mesh.quads, get_processed_vertex);
+
+			render_lines_and_points(
+				ctx,
+				vis,
+				fragment_program,
+				mesh.lines,
+				mesh.points,
+				get_processed_vertex
+			);
+		}
+	}
+
+	template <
+		bool depth_test,
+		typename vertex_program_type,
+		typename fragment_program_type,
+		typename instance_type,
+		typename... attribute_type>
+	static void render_instanced(
+		context& ctx,
+		const vertex_program_type& vertex_program,
+		const fragment_program_type& fragment_program,
+		const mesh<attribute_type...>& mesh,
+		utki::span<const instance_type> instances
+	)
+	{
+		render_instanced<depth_test>(ctx, vertex_program, fragment_program, mesh.view(), instances);
+	}
+
+private:
+	template <typename fragment_program_type, typename vertex_program_res_type>
+	class deferred_draw : public visibility_buffer::draw
+	{
+	public:
+		struct triangle {
+			processed_face_type<vertex_program_res_type> face;
+			std::array<edge_info, 3> edges;
+			real area_doubled;
+			r4::vector3<real> depth_reciprocal;
+
+			// value of the fragment program with constant output
+			context::fb_span_type::pixel_type constant_value;
+		};
+
+		// fragment program is copied, because it is run after the draw call returns
+		const fragment_program_type fragment_program;
+
+		frame_arena::vector<triangle> triangles;
+
+		deferred_draw(const fragment_program_type& fragment_program, frame_arena::allocator<triangle> allocator) :
+			fragment_program(fragment_program),
+			triangles(allocator)
+		{}
+
+		void shade(
+			utki::span<context::fb_span_type::pixel_type> pixels,
+			utki::span<const visibility_buffer::fragment_id> ids,
+			r4::vector2<uint32_t> pos
+		) const override
+		{
+			ASSERT(pixels.size() == ids.size())
+
+			r4::vector2<real> p = pos.to<real>();
+			auto id = ids.begin();
+			for (auto& pixel : pixels) {
+				ASSERT(id->triangle < this->triangles.size())
+				const auto& t = this->triangles[id->triangle];
+
+				if constexpr (fragment_program_traits<fragment_program_type>::constant_output) {
+					store_fragment<fragment_program_type>(pixel, t.constant_value);
+				} else {
+					store_fragment<fragment_program_type>(
+						pixel,
+						rasterimage::to<context::fb_span_type::pixel_type::value_type>(shade_fragment(
+							this->fragment_program,
+							t.face,
+							t.depth_reciprocal,
+							t.area_doubled,
+							calc_barycentric(t.edges, p)
+						))
+					);
+				}
+
+				++p.x();
+				++id;
+			}
+		}
+	};
+
+	template <typename fragment_program_type, typename vertex_program_res_type>
+	static void rasterize_visibility(
+		context& ctx,
+		visibility_buffer& vb,
+		uint32_t draw_index,
+		deferred_draw<fragment_program_type, vertex_program_res_type>& draw,
+		const processed_face_type<vertex_program_res_type>& face
+	)
+	{
+		auto setup = setup_triangle(ctx, face, true);
+		if (!setup.has_value()) {
+			return;
+		}
+
+		ctx.add_damage(setup->bounding_box);
+		vb.add_written_area(setup->bounding_box);
+
+		auto triangle_index = uint32_t(draw.triangles.size());
+		draw.triangles.push_back({
+			.face = face,
+			.edges = setup->edges,
+			.area_doubled = setup->area_doubled,
+			.depth_reciprocal = {
+				1 / std::get<0>(face[0]).w(),
+				1 / std::get<0>(face[1]).w(),
+				1 / std::get<0>(face[2]).w()
+			}
+		});
+
+		// constant output does not depend on the pixel, so it is computed once per triangle
+		if constexpr (fragment_program_traits<fragment_program_type>::constant_output) {
+			draw.triangles.back().constant_value = rasterimage::to<context::fb_span_type::pixel_type::value_type>(
+				invoke_fragment_program(draw.fragment_program, get_vertex_attributes(face[0]))
+			);
+		}
+
+		rasterize_depth_tested(
+			ctx,
+			setup->get_min_depth(),
+			setup->get_max_depth(),
+			setup->bounding_box,
+			nullptr,
+			[&setup](const r4::vector2<real>& p) {
+				return setup->locate(p);
+			},
+			[&vb, draw_index, triangle_index](uint32_t x, uint32_t y, const sample&) {
+				vb[y][x] = {.draw = draw_index, .triangle = triangle_index};
+			},
+			[](const r4::vector2<uint32_t>&) {}
+		);
+	}
+
+public:
+	// First pass of visibility buffer rendering, see visibility_buffer.
+	// Faces are rasterized with depth test into the visibility buffer without running the fragment program,
+	// it is copied and run later by visibility_buffer::resolve() for each visible pixel, so whatever
+	// the fragment program refers to must stay alive until then.
+	// Throws std::invalid_argument if the context has no depth buffer, if stencil test is enabled
+	// or if the mesh has lines or points, those are to be rendered with render().
+	template <typename vertex_program_type, typename fragment_program_type, typename... attribute_type>
+	static void render_visibility(
+		context& ctx,
+		visibility_buffer& vb,
+		const r4::matrix4<real>& matrix,
+		const vertex_program_type& vertex_program,
+		const fragment_program_type& fragment_program,
+		const mesh_view<attribute_type...>& mesh
+	)
+	{
+		static_assert(
+			[]<typename... arg_type>(std::tuple<arg_type...>) constexpr {
+				return std::is_invocable_v<decltype(vertex_program), const r4::vector3<real>&, const arg_type&...>;
+			}(std::tuple<attribute_type...>{}),
+			"vertex_program must be invocable"
+		);
+
+		using vertex_program_res_type = decltype( //
+			vertex_program( //
+				std::declval<r4::vector4<real>>(),
+				std::declval<attribute_type>()...
+			)
+		);
+
+		check_vertex_program_res_type<vertex_program_res_type>();
+
+		CPUGL_TRACE_SCOPE(ctx.get_tracer(), "render visibility");
+
+		if (!ctx.has_depth_buffer()) {
+			throw std::invalid_argument("pipeline::render_visibility(): context has no depth buffer");
+		}
+		if (ctx.is_stencil_test_enabled()) {
+			throw std::invalid_argument("pipeline::render_visibility(): stencil test is not supported");
+		}
+		if (!mesh.lines.empty() || !mesh.points.empty()) {
+			throw std::invalid_argument("pipeline::render_visibility(): lines and points are not supported");
+		}
+		ASSERT(vb.get_dims() == ctx.get_framebuffer().dims())
+
+		auto vis = test_visibility(ctx, matrix, mesh.bounds);
+		if (vis == visibility::outside || is_occluded(ctx, matrix, mesh.bounds)) {
+			return;
+		}
+
+		frame_arena::vector<vertex_program_res_type> processed_vertices(ctx.get_frame_allocator());
+		process_vertices(
+			ctx,
+			mesh.vertices,
+			[&vertex_program](const auto& vertex) -> vertex_program_res_type {
+				return std::apply(vertex_program, vertex);
+			},
+			processed_vertices
+		);
+
+		auto get_processed_vertex = [&processed_vertices](unsigned index) -> const vertex_program_res_type& {
+			return processed_vertices[index];
+		};
+
+		using draw_type = deferred_draw<fragment_program_type, vertex_program_res_type>;
+
+		// the draw lives until the visibility buffer is resolved, outside of a frame it is allocated from the heap
+		auto allocator = ctx.get_frame_allocator();
+		visibility_buffer::owned_draw owned_draw(nullptr, {.in_arena = ctx.is_in_frame()});
+		if (ctx.is_in_frame()) {
+			owned_draw.reset(ctx.get_frame_arena().make<draw_type>(fragment_program, allocator));
+		} else {
+			owned_draw.reset(new draw_type(fragment_program, allocator));
+		}
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-static-cast-downcast)
+		auto& draw = static_cast<draw_type&>(*owned_draw);
+		auto draw_index = vb.add_draw(std::move(owned_draw));
+
+		// clipping can split a face in two, but usually it does not
+		draw.triangles.reserve(mesh.faces.size() + mesh.quads.size() * 2);
+
+		CPUGL_TRACE_SCOPE(ctx.get_tracer(), "faces");
+
+		auto rasterize_face = [&](const processed_face_type<vertex_program_res_type>& face) {
+			rasterize_visibility(ctx, vb, draw_index, draw, face);
+		};
+
+		auto render_triangles = [&](utki::span<const std::array<unsigned, 3>> faces) {
+			if (vis == visibility::inside) {
+				process_faces<false>(faces, get_processed_vertex, rasterize_face);
+			} else {
+				process_faces<true>(faces, get_processed_vertex, rasterize_face);
+			}
+		};
+
+		render_triangles(mesh.faces);
+
+		// the visibility buffer refers to triangles, so quads are rendered as two triangles
+		for (const auto& q : mesh.quads) {
+			const auto triangles = get_quad_triangles(q);
+			render_triangles(utki::make_span(triangles));
+		}
+	}
+
+	template <typename vertex_program_type, typename fragment_program_type, typename... attribute_type>
+	static void render_visibility(
+		context& ctx,
+		visibility_buffer& vb,
+		const r4::matrix4<real>& matrix,
+		const vertex_program_type& vertex_program,
+		const fragment_program_type& fragment_program,
+		const mesh<attribute_type...>& mesh
+	)
+	{
+		render_visibility(ctx, vb, matrix, vertex_program, fragment_program, mesh.view());
 	}
 };
 
-} // namespace cpugl
\ No newline at end of file
+} // namespace cpugl
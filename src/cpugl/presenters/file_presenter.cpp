@@ -0,0 +1,71 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "file_presenter.hpp"
+
+#include <stdexcept>
+
+using namespace cpugl;
+
+file_presenter::file_presenter(std::string_view path) :
+	stream(std::string(path), std::ios::binary | std::ios::trunc)
+{
+	if (!this->stream) {
+		throw std::runtime_error("file_presenter: could not open file for writing");
+	}
+}
+
+void file_presenter::present(unsigned index, const rectangle& area)
+{
+	this->memory_presenter::present(index, area);
+
+	// file frames are always complete, so write the whole framebuffer
+	auto fb = this->get_buffer(index);
+
+	constexpr auto num_channels = 4;
+
+	this->stream << "P7\n"
+				 << "WIDTH " << fb.dims().x() << "\n"
+				 << "HEIGHT " << fb.dims().y() << "\n"
+				 << "DEPTH " << num_channels << "\n"
+				 << "MAXVAL 255\n"
+				 << "TUPLTYPE RGB_ALPHA\n"
+				 << "ENDHDR\n";
+
+	for (auto line : fb) {
+		this->stream.write(
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+			reinterpret_cast<const char*>(line.data()),
+			std::streamsize(line.size() * sizeof(fb_span_type::pixel_type))
+		);
+	}
+
+	this->stream.flush();
+
+	if (!this->stream) {
+		throw std::runtime_error("file_presenter: could not write frame to file");
+	}
+}
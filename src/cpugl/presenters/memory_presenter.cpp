@@ -0,0 +1,58 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "memory_presenter.hpp"
+
+using namespace cpugl;
+
+void memory_presenter::resize(r4::vector2<uint32_t> dims, unsigned num_buffers)
+{
+	this->buffers.clear();
+	for (unsigned i = 0; i != num_buffers; ++i) {
+		this->buffers.emplace_back(dims);
+	}
+	this->presented.reset();
+}
+
+presenter::fb_span_type memory_presenter::get_buffer(unsigned index)
+{
+	ASSERT(index < this->buffers.size())
+	return this->buffers[index].span();
+}
+
+void memory_presenter::present(unsigned index, const rectangle& /* area */)
+{
+	ASSERT(index < this->buffers.size())
+	this->presented = index;
+}
+
+presenter::fb_span_type memory_presenter::get_presented()
+{
+	if (!this->presented.has_value()) {
+		return {};
+	}
+	return this->get_buffer(this->presented.value());
+}
@@ -0,0 +1,58 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <optional>
+
+#include "../swapchain.hpp"
+
+namespace cpugl {
+
+// Presenter which keeps framebuffers in memory, e.g. for headless rendering.
+// Presentation completes immediately, the last presented framebuffer can be read with get_presented().
+class memory_presenter : public presenter
+{
+	std::vector<context::fb_image_type> buffers;
+
+	std::optional<unsigned> presented;
+
+public:
+	void resize(r4::vector2<uint32_t> dims, unsigned num_buffers) override;
+
+	fb_span_type get_buffer(unsigned index) override;
+
+	void present(unsigned index, const rectangle& area) override;
+
+	void wait(unsigned /* index */) override {}
+
+	// Get last presented framebuffer.
+	// It stays valid until the same buffer is acquired from the swapchain again.
+	// Returns empty span if nothing was presented since last resize.
+	fb_span_type get_presented();
+};
+
+} // namespace cpugl
@@ -0,0 +1,252 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "x11_shm_presenter.hpp"
+
+#if M_OS == M_OS_LINUX && !defined(CPUGL_NO_X11)
+
+#	include <stdexcept>
+
+#	include <sys/ipc.h>
+#	include <sys/shm.h>
+
+using namespace cpugl;
+
+x11_shm_presenter::x11_shm_presenter(Display* display, Window window) :
+	display(display),
+	window(window)
+{
+	ASSERT(display)
+
+	if (!XShmQueryExtension(this->display)) {
+		throw std::runtime_error("x11_shm_presenter: MIT-SHM extension is not available");
+	}
+
+	XWindowAttributes attrs;
+	XGetWindowAttributes(this->display, this->window, &attrs);
+
+	this->visual = attrs.visual;
+	this->depth = attrs.depth;
+
+	if (this->visual->c_class != TrueColor) {
+		throw std::runtime_error("x11_shm_presenter: only true color visuals are supported");
+	}
+
+	// framebuffer pixels are RGBA bytes in memory
+	constexpr auto rgba_red_mask = 0xff;
+	constexpr auto bgra_red_mask = 0xff0000;
+
+	auto red_mask = ImageByteOrder(this->display) == LSBFirst ? this->visual->red_mask : this->visual->blue_mask;
+
+	if (red_mask == rgba_red_mask) {
+		this->swap_red_blue = false;
+	} else if (red_mask == bgra_red_mask) {
+		this->swap_red_blue = true;
+	} else {
+		throw std::runtime_error("x11_shm_presenter: unsupported visual color masks");
+	}
+
+	this->gc = XCreateGC(this->display, this->window, 0, nullptr);
+}
+
+x11_shm_presenter::~x11_shm_presenter()
+{
+	this->free_buffers();
+	XFreeGC(this->display, this->gc);
+}
+
+void x11_shm_presenter::free_buffers()
+{
+	for (unsigned i = 0; i != this->buffers.size(); ++i) {
+		this->wait(i);
+
+		auto& b = this->buffers[i];
+
+		XShmDetach(this->display, &b.shm_info);
+		XDestroyImage(b.ximage);
+		shmdt(b.shm_info.shmaddr);
+	}
+	this->buffers.clear();
+
+	// make sure X server has detached from the segments
+	XSync(this->display, False);
+}
+
+void x11_shm_presenter::resize(r4::vector2<uint32_t> dims, unsigned num_buffers)
+{
+	this->free_buffers();
+
+	if (dims.x() == 0 || dims.y() == 0) {
+		return;
+	}
+
+	this->buffers.reserve(num_buffers);
+
+	for (unsigned i = 0; i != num_buffers; ++i) {
+		buffer b;
+
+		b.ximage = XShmCreateImage(
+			this->display,
+			this->visual,
+			unsigned(this->depth),
+			ZPixmap,
+			nullptr,
+			&b.shm_info,
+			dims.x(),
+			dims.y()
+		);
+		if (!b.ximage) {
+			throw std::runtime_error("x11_shm_presenter: XShmCreateImage() failed");
+		}
+
+		constexpr auto bits_per_pixel = utki::byte_bits * sizeof(fb_span_type::pixel_type);
+
+		if (unsigned(b.ximage->bits_per_pixel) != bits_per_pixel) {
+			XDestroyImage(b.ximage);
+			throw std::runtime_error("x11_shm_presenter: only 32 bits per pixel images are supported");
+		}
+
+		b.shm_info.shmid = shmget(
+			IPC_PRIVATE,
+			size_t(b.ximage->bytes_per_line) * size_t(b.ximage->height),
+			IPC_CREAT | 0600 // NOLINT(cppcoreguidelines-avoid-magic-numbers): owner read/write permissions
+		);
+		if (b.shm_info.shmid < 0) {
+			XDestroyImage(b.ximage);
+			throw std::runtime_error("x11_shm_presenter: shmget() failed");
+		}
+
+		b.shm_info.shmaddr = static_cast<char*>(shmat(b.shm_info.shmid, nullptr, 0));
+
+		// mark the segment for destruction, it will be actually destroyed when detached by both processes
+		shmctl(b.shm_info.shmid, IPC_RMID, nullptr);
+
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast, performance-no-int-to-ptr)
+		if (b.shm_info.shmaddr == reinterpret_cast<char*>(-1)) {
+			XDestroyImage(b.ximage);
+			throw std::runtime_error("x11_shm_presenter: shmat() failed");
+		}
+
+		b.ximage->data = b.shm_info.shmaddr;
+		b.shm_info.readOnly = False;
+
+		XShmAttach(this->display, &b.shm_info);
+
+		this->buffers.push_back(b);
+	}
+
+	XSync(this->display, False);
+}
+
+presenter::fb_span_type x11_shm_presenter::get_buffer(unsigned index)
+{
+	if (this->buffers.empty()) {
+		return {};
+	}
+
+	ASSERT(index < this->buffers.size())
+	auto& b = this->buffers[index];
+
+	return {
+		r4::vector2<uint32_t>(unsigned(b.ximage->width), unsigned(b.ximage->height)),
+		size_t(b.ximage->bytes_per_line) / sizeof(fb_span_type::pixel_type),
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		reinterpret_cast<fb_span_type::pixel_type*>(b.ximage->data)
+	};
+}
+
+void x11_shm_presenter::swap_red_blue_area(unsigned index, const rectangle& area)
+{
+	for (auto row : this->get_buffer(index).subspan(area)) {
+		this->kernels.swap_red_blue(
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+			reinterpret_cast<uint8_t*>(row.data()),
+			row.size()
+		);
+	}
+}
+
+void x11_shm_presenter::present(unsigned index, const rectangle& area)
+{
+	if (this->buffers.empty() || is_empty(area)) {
+		return;
+	}
+
+	ASSERT(index < this->buffers.size())
+	auto& b = this->buffers[index];
+
+	ASSERT(b.request_serial == 0)
+
+	if (this->swap_red_blue) {
+		this->swap_red_blue_area(index, area);
+	}
+
+	b.presented_area = area;
+	b.request_serial = NextRequest(this->display);
+
+	XShmPutImage(
+		this->display,
+		this->window,
+		this->gc,
+		b.ximage,
+		int(area.p.x()),
+		int(area.p.y()),
+		int(area.p.x()),
+		int(area.p.y()),
+		area.d.x(),
+		area.d.y(),
+		False // do not send completion event, completion is detected by request serial number
+	);
+
+	XFlush(this->display);
+}
+
+void x11_shm_presenter::wait(unsigned index)
+{
+	if (index >= this->buffers.size()) {
+		return;
+	}
+
+	auto& b = this->buffers[index];
+
+	if (b.request_serial == 0) {
+		return;
+	}
+
+	// X server reads shared memory while processing the XShmPutImage request,
+	// so the buffer is free once the request is processed
+	if (LastKnownRequestProcessed(this->display) < b.request_serial) {
+		XSync(this->display, False);
+	}
+
+	b.request_serial = 0;
+
+	if (this->swap_red_blue) {
+		this->swap_red_blue_area(index, b.presented_area);
+	}
+}
+
+#endif
@@ -0,0 +1,101 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <utki/config.hpp>
+
+#if M_OS == M_OS_LINUX && !defined(CPUGL_NO_X11)
+
+#	include <X11/Xlib.h>
+#	include <X11/Xutil.h>
+
+// XShm.h needs Xlib.h to be included first
+#	include <X11/extensions/XShm.h>
+
+#	include "../swapchain.hpp"
+
+namespace cpugl {
+
+// Presenter which displays framebuffers in X11 window using the MIT-SHM extension.
+// The framebuffers are allocated in shared memory and X server reads pixels directly from there,
+// so no pixel data is copied through the X connection.
+// Only 32 bits per pixel true color visuals are supported.
+// Not available if CPUGL_NO_X11 is defined, which is the case when the library is built with no_x11=true.
+class x11_shm_presenter : public presenter
+{
+	Display* display;
+	Window window;
+	Visual* visual;
+	int depth;
+	GC gc;
+
+	// X server expects blue channel to go first in memory, in this case the presented area
+	// is converted in place before presenting and converted back when presentation completes
+	bool swap_red_blue;
+
+	const kernel_set& kernels = get_kernel_set(get_default_isa());
+
+	void swap_red_blue_area(unsigned index, const rectangle& area);
+
+	struct buffer {
+		XShmSegmentInfo shm_info{};
+		XImage* ximage = nullptr;
+
+		// serial number of the XShmPutImage request, 0 if the buffer is not being presented
+		unsigned long request_serial = 0;
+
+		rectangle presented_area{{0, 0}, {0, 0}};
+	};
+
+	std::vector<buffer> buffers;
+
+	void free_buffers();
+
+public:
+	// throws std::runtime_error if MIT-SHM extension is not available
+	x11_shm_presenter(Display* display, Window window);
+
+	x11_shm_presenter(const x11_shm_presenter&) = delete;
+	x11_shm_presenter& operator=(const x11_shm_presenter&) = delete;
+
+	x11_shm_presenter(x11_shm_presenter&&) = delete;
+	x11_shm_presenter& operator=(x11_shm_presenter&&) = delete;
+
+	~x11_shm_presenter() override;
+
+	void resize(r4::vector2<uint32_t> dims, unsigned num_buffers) override;
+
+	fb_span_type get_buffer(unsigned index) override;
+
+	void present(unsigned index, const rectangle& area) override;
+
+	void wait(unsigned index) override;
+};
+
+} // namespace cpugl
+
+#endif
@@ -0,0 +1,78 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#include <r4/rectangle.hpp>
+
+namespace cpugl {
+
+// rectangle of framebuffer pixels
+using rectangle = r4::rectangle<uint32_t>;
+
+inline bool is_empty(const rectangle& r) noexcept
+{
+	return r.d.x() == 0 || r.d.y() == 0;
+}
+
+inline rectangle intersect(const rectangle& a, const rectangle& b) noexcept
+{
+	using std::min;
+	using std::max;
+
+	auto p1 = max(a.p, b.p);
+	auto p2 = min(a.p + a.d, b.p + b.d);
+
+	if (p1.x() >= p2.x() || p1.y() >= p2.y()) {
+		return {p1, {0, 0}};
+	}
+
+	return {p1, p2 - p1};
+}
+
+// bounding rectangle of the two rectangles, empty rectangles are ignored
+inline rectangle unite(const rectangle& a, const rectangle& b) noexcept
+{
+	if (is_empty(a)) {
+		return b;
+	}
+	if (is_empty(b)) {
+		return a;
+	}
+
+	using std::min;
+	using std::max;
+
+	auto p1 = min(a.p, b.p);
+	auto p2 = max(a.p + a.d, b.p + b.d);
+
+	return {p1, p2 - p1};
+}
+
+} // namespace cpugl
@@ -34,17 +34,55 @@ void color_pos_shader::render(
 	context& ctx,
 	const r4::matrix4<real>& matrix,
 	const color_type& color,
-	const mesh<>& mesh
+	const mesh_view<>& mesh
 )
 {
-	pipeline::render<false>( // false = no depth test
+	pipeline::render<true>( // depth test is done if context has depth buffer
 		ctx,
+		matrix,
 		[&matrix](const r4::vector3<real>& pos) {
 			return std::make_tuple(matrix * pos);
 		},
-		[&color]() {
-			return color;
-		},
+		constant_color_fragment_program{color},
 		mesh
 	);
 }
+
+void color_pos_shader::render_stream(
+	context& ctx,
+	const r4::matrix4<real>& matrix,
+	const color_type& color,
+	const mesh_chunk_producer<>& produce
+)
+{
+	std::array<mesh<>, 2> chunks;
+
+	pipeline::render_stream<true>( // depth test is done if context has depth buffer
+		ctx,
+		matrix,
+		[&matrix](const r4::vector3<real>& pos) {
+			return std::make_tuple(matrix * pos);
+		},
+		constant_color_fragment_program{color},
+		produce,
+		chunks
+	);
+}
+
+void color_pos_shader::render_instanced( //
+	context& ctx,
+	const mesh_view<>& mesh,
+	utki::span<const instance> instances
+)
+{
+	pipeline::render_instanced<true>( // depth test is done if context has depth buffer
+		ctx,
+		[](const instance& inst, const r4::vector3<real>& pos) {
+			return std::make_tuple(inst.matrix * pos, inst.color);
+		},
+		// instance color is same for all vertices
+		flat_color_fragment_program{},
+		mesh,
+		instances
+	);
+}
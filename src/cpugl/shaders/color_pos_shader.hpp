@@ -27,6 +27,7 @@ SOFTWARE.
 #pragma once
 
 #include "../context.hpp"
+#include "../instance.hpp"
 #include "../mesh.hpp"
 
 namespace cpugl {
@@ -38,7 +39,22 @@ public:
 		context& ctx,
 		const r4::matrix4<real>& matrix,
 		const color_type& color,
-		const mesh<>& mesh
+		const mesh_view<>& mesh
+	);
+
+	// Render mesh which is produced chunk by chunk, see pipeline::render_stream().
+	void render_stream( //
+		context& ctx,
+		const r4::matrix4<real>& matrix,
+		const color_type& color,
+		const mesh_chunk_producer<>& produce
+	);
+
+	// each instance is drawn with instance's color
+	void render_instanced( //
+		context& ctx,
+		const mesh_view<>& mesh,
+		utki::span<const instance> instances
 	);
 };
 
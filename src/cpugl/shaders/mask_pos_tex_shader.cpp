@@ -0,0 +1,123 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "mask_pos_tex_shader.hpp"
+
+#include <algorithm>
+
+#include "../pipeline.hpp"
+#include "../texture.hpp"
+
+using namespace cpugl;
+
+namespace {
+struct mask_fragment_program {
+	constexpr static bool blended = true;
+
+	color_type color;
+	texture<mask_pos_tex_shader::mask_image_type> tex;
+
+	color_type operator()(const tex_coord_type& tex_coord) const
+	{
+		constexpr real max_coverage = std::numeric_limits<uint8_t>::max();
+
+		auto coverage = real(this->tex.get(tex_coord)[0]) / max_coverage;
+		return {this->color.x(), this->color.y(), this->color.z(), this->color.w() * coverage};
+	}
+};
+} // namespace
+
+void mask_pos_tex_shader::render( //
+	context& ctx,
+	const r4::matrix4<real>& matrix,
+	const color_type& color,
+	const mask_image_type& mask,
+	const mesh_view<tex_coord_type>& mesh
+)
+{
+	pipeline::render<true>( // depth test is done if context has depth buffer
+		ctx,
+		matrix,
+		[&matrix](const r4::vector3<real>& pos, const tex_coord_type& tex_coord) {
+			return std::make_tuple(matrix * pos, tex_coord);
+		},
+		mask_fragment_program{.color = color, .tex = make_texture(mask)},
+		mesh
+	);
+}
+
+void mask_pos_tex_shader::blit( //
+	context& ctx,
+	const color_type& color,
+	const mask_image_type& mask,
+	utki::span<const blit_rect> rects
+)
+{
+	CPUGL_TRACE_SCOPE(ctx.get_tracer(), "blit");
+
+	const auto& render_area = ctx.get_render_area();
+	if (is_empty(render_area)) {
+		return;
+	}
+
+	auto area_begin = render_area.p.to<int32_t>();
+	auto area_end = (render_area.p + render_area.d).to<int32_t>();
+
+	auto pixel_color = rasterimage::to<context::fb_span_type::pixel_type::value_type>(color);
+
+	const auto& framebuffer = ctx.get_framebuffer();
+	const auto& kernels = ctx.get_kernels();
+
+	for (const auto& r : rects) {
+		ASSERT(r.src.p.x() + r.src.d.x() <= mask.dims().x())
+		ASSERT(r.src.p.y() + r.src.d.y() <= mask.dims().y())
+
+		// clip destination to the render area in signed integers, the rectangle can be partially off-screen
+		auto begin = max(r.dst, area_begin);
+		auto end = min(r.dst + r.src.d.to<int32_t>(), area_end);
+		if (begin.x() >= end.x() || begin.y() >= end.y()) {
+			continue;
+		}
+
+		auto src_pos = r.src.p + (begin - r.dst).to<uint32_t>();
+		auto dims = (end - begin).to<uint32_t>();
+
+		for (uint32_t y = 0; y != dims.y(); ++y) {
+			auto mask_row = mask[src_pos.y() + y];
+			auto framebuffer_row = framebuffer[uint32_t(begin.y()) + y];
+			kernels.blend_mask(
+				// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+				reinterpret_cast<uint8_t*>(std::next(framebuffer_row.data(), begin.x())),
+				// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+				reinterpret_cast<const uint8_t*>(std::next(mask_row.data(), src_pos.x())),
+				dims.x(),
+				pixel_color.data()
+			);
+		}
+
+		ctx.add_damage({begin.to<uint32_t>(), dims});
+	}
+}
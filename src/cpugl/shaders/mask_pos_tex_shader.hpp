@@ -0,0 +1,79 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <rasterimage/image.hpp>
+
+#include "../context.hpp"
+#include "../mesh.hpp"
+#include "../rectangle.hpp"
+
+namespace cpugl {
+
+// Renders solid color with alpha modulated by one channel coverage texture, e.g. glyphs of a glyph atlas.
+// The result is blended into the framebuffer, see blend().
+class mask_pos_tex_shader
+{
+public:
+	using mask_image_type = rasterimage::image<uint8_t, 1>;
+
+	static void render( //
+		context& ctx,
+		const r4::matrix4<real>& matrix,
+		const color_type& color,
+		const mask_image_type& mask,
+		const mesh_view<tex_coord_type>& mesh
+	);
+
+	// area of the mask to copy to the framebuffer position unscaled
+	struct blit_rect {
+		rectangle src;
+		r4::vector2<int32_t> dst;
+	};
+
+	// Blend mask areas to the framebuffer positions without scaling, bypassing triangle rasterization.
+	// Pixel positions are used as is, i.e. there is no transformation matrix.
+	// Only pixels within the render area are touched, stencil and depth tests are not done.
+	static void blit( //
+		context& ctx,
+		const color_type& color,
+		const mask_image_type& mask,
+		utki::span<const blit_rect> rects
+	);
+
+	static void blit( //
+		context& ctx,
+		const color_type& color,
+		const mask_image_type& mask,
+		const blit_rect& rect
+	)
+	{
+		blit(ctx, color, mask, utki::make_span(&rect, 1));
+	}
+};
+
+} // namespace cpugl
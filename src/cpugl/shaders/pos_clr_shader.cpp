@@ -30,16 +30,32 @@ SOFTWARE.
 
 using namespace cpugl;
 
-void pos_clr_shader::render(context& ctx, const r4::matrix4<real>& matrix, const mesh<color_type>& mesh)
+void pos_clr_shader::render(context& ctx, const r4::matrix4<real>& matrix, const mesh_view<color_type>& mesh)
 {
-	pipeline::render<false>( // false = no depth test
+	pipeline::render<true>( // depth test is done if context has depth buffer
 		ctx,
+		matrix,
 		[&matrix](const r4::vector3<real>& pos, const r4::vector4<real>& clr) {
 			return std::make_tuple(matrix * pos, clr);
 		},
-		[](const auto& clr) {
-			return clr;
-		},
+		gouraud_fragment_program{},
 		mesh
 	);
 }
+
+void pos_clr_shader::render_instanced( //
+	context& ctx,
+	const mesh_view<color_type>& mesh,
+	utki::span<const instance> instances
+)
+{
+	pipeline::render_instanced<true>( // depth test is done if context has depth buffer
+		ctx,
+		[](const instance& inst, const r4::vector3<real>& pos, const r4::vector4<real>& clr) {
+			return std::make_tuple(inst.matrix * pos, clr.comp_mul(inst.color));
+		},
+		gouraud_fragment_program{},
+		mesh,
+		instances
+	);
+}
@@ -27,6 +27,7 @@ SOFTWARE.
 #pragma once
 
 #include "../context.hpp"
+#include "../instance.hpp"
 #include "../mesh.hpp"
 
 namespace cpugl {
@@ -37,7 +38,14 @@ public:
 	void render( //
 		context& ctx,
 		const r4::matrix4<real>& matrix,
-		const mesh<color_type>& mesh
+		const mesh_view<color_type>& mesh
+	);
+
+	// vertex colors are modulated by instance's color
+	void render_instanced( //
+		context& ctx,
+		const mesh_view<color_type>& mesh,
+		utki::span<const instance> instances
 	);
 };
 
@@ -31,28 +31,68 @@ SOFTWARE.
 
 using namespace cpugl;
 
+namespace {
+template <typename image_type>
+void render_texture(
+	context& ctx,
+	const r4::matrix4<real>& matrix,
+	const image_type& image,
+	const mesh_view<tex_coord_type>& mesh
+)
+{
+	auto tex = make_texture(image);
+
+	pipeline::render<true>( // depth test is done if context has depth buffer
+		ctx,
+		matrix,
+		[&matrix](const r4::vector3<real>& pos, const r4::vector2<real> tex_coord) {
+			return std::make_tuple(matrix * pos, tex_coord);
+		},
+		[&tex](const r4::vector2<real>& tex_coord) {
+			return rasterimage::get_rgba(tex.get(tex_coord));
+		},
+		mesh
+	);
+}
+
+template <typename image_type>
+void render_texture_instanced(
+	context& ctx,
+	const image_type& image,
+	const mesh_view<tex_coord_type>& mesh,
+	utki::span<const instance> instances
+)
+{
+	auto tex = make_texture(image);
+
+	pipeline::render_instanced<true>( // depth test is done if context has depth buffer
+		ctx,
+		[](const instance& inst, const r4::vector3<real>& pos, const r4::vector2<real> tex_coord) {
+			return std::make_tuple(inst.matrix * pos, tex_coord + inst.tex_coord_offset);
+		},
+		[&tex](const r4::vector2<real>& tex_coord) {
+			// shifted texture coordinates can go out of the texture, those are clamped to its edges
+			using std::min;
+			using std::max;
+			return rasterimage::get_rgba(tex.get(min(max(tex_coord, r4::vector2<real>(0)), r4::vector2<real>(1))));
+		},
+		mesh,
+		instances
+	);
+}
+} // namespace
+
 void texture_pos_tex_shader::render( //
 	context& ctx,
 	const r4::matrix4<real>& matrix,
 	const rasterimage::image_variant& tex,
-	const mesh<tex_coord_type>& mesh
+	const mesh_view<tex_coord_type>& mesh
 )
 {
 	std::visit(
 		[&ctx, &matrix, &mesh](const auto& image) {
 			if constexpr (std::is_same_v<uint8_t, typename std::remove_reference_t<decltype(image)>::pixel_type::value_type>) {
-				auto tex = make_texture(image);
-
-				pipeline::render<false>(
-					ctx,
-					[&matrix](const r4::vector3<real>& pos, const r4::vector2<real> tex_coord) {
-						return std::make_tuple(matrix * pos, tex_coord);
-					},
-					[&tex](const r4::vector2<real>& tex_coord) {
-						return rasterimage::get_rgba(tex.get(tex_coord));
-					},
-					mesh
-				);
+				render_texture(ctx, matrix, image, mesh);
 			} else {
 				std::cout << "texture_pos_tex_shader::render(): non-uint8_t textures are not supported" << std::endl;
 			}
@@ -60,3 +100,73 @@ void texture_pos_tex_shader::render( //
 		tex.variant
 	);
 }
+
+void texture_pos_tex_shader::render( //
+	context& ctx,
+	const r4::matrix4<real>& matrix,
+	const texture_image_view& tex,
+	const mesh_view<tex_coord_type>& mesh
+)
+{
+	render_texture(ctx, matrix, tex, mesh);
+}
+
+void texture_pos_tex_shader::render( //
+	context& ctx,
+	const r4::matrix4<real>& matrix,
+	const compressed_image_variant& tex,
+	const mesh_view<tex_coord_type>& mesh
+)
+{
+	std::visit(
+		[&ctx, &matrix, &mesh](const auto& image) {
+			render_texture(ctx, matrix, image, mesh);
+		},
+		tex
+	);
+}
+
+void texture_pos_tex_shader::render_instanced( //
+	context& ctx,
+	const rasterimage::image_variant& tex,
+	const mesh_view<tex_coord_type>& mesh,
+	utki::span<const instance> instances
+)
+{
+	std::visit(
+		[&ctx, &mesh, &instances](const auto& image) {
+			if constexpr (std::is_same_v<uint8_t, typename std::remove_reference_t<decltype(image)>::pixel_type::value_type>) {
+				render_texture_instanced(ctx, image, mesh, instances);
+			} else {
+				std::cout << "texture_pos_tex_shader::render_instanced(): non-uint8_t textures are not supported"
+						  << std::endl;
+			}
+		},
+		tex.variant
+	);
+}
+
+void texture_pos_tex_shader::render_instanced( //
+	context& ctx,
+	const texture_image_view& tex,
+	const mesh_view<tex_coord_type>& mesh,
+	utki::span<const instance> instances
+)
+{
+	render_texture_instanced(ctx, tex, mesh, instances);
+}
+
+void texture_pos_tex_shader::render_instanced( //
+	context& ctx,
+	const compressed_image_variant& tex,
+	const mesh_view<tex_coord_type>& mesh,
+	utki::span<const instance> instances
+)
+{
+	std::visit(
+		[&ctx, &mesh, &instances](const auto& image) {
+			render_texture_instanced(ctx, image, mesh, instances);
+		},
+		tex
+	);
+}
@@ -28,7 +28,9 @@ SOFTWARE.
 
 #include <rasterimage/image_variant.hpp>
 
+#include "../compressed_image.hpp"
 #include "../context.hpp"
+#include "../instance.hpp"
 #include "../mesh.hpp"
 #include "../texture.hpp"
 
@@ -41,7 +43,47 @@ public:
 		context& ctx,
 		const r4::matrix4<real>& matrix,
 		const rasterimage::image_variant& tex,
-		const mesh<tex_coord_type>& mesh
+		const mesh_view<tex_coord_type>& mesh
+	);
+
+	// renders with already decoded texture, e.g. a mip level of mapped_texture
+	static void render( //
+		context& ctx,
+		const r4::matrix4<real>& matrix,
+		const texture_image_view& tex,
+		const mesh_view<tex_coord_type>& mesh
+	);
+
+	// texture stays compressed, only the sampled blocks are decoded
+	static void render( //
+		context& ctx,
+		const r4::matrix4<real>& matrix,
+		const compressed_image_variant& tex,
+		const mesh_view<tex_coord_type>& mesh
+	);
+
+	// texture coordinates are shifted by instance's texture coordinates offset,
+	// shifted coordinates outside of [0, 1] are clamped to the texture edges,
+	// instance's color is not used
+	static void render_instanced( //
+		context& ctx,
+		const rasterimage::image_variant& tex,
+		const mesh_view<tex_coord_type>& mesh,
+		utki::span<const instance> instances
+	);
+
+	static void render_instanced( //
+		context& ctx,
+		const texture_image_view& tex,
+		const mesh_view<tex_coord_type>& mesh,
+		utki::span<const instance> instances
+	);
+
+	static void render_instanced( //
+		context& ctx,
+		const compressed_image_variant& tex,
+		const mesh_view<tex_coord_type>& mesh,
+		utki::span<const instance> instances
 	);
 };
 
@@ -0,0 +1,157 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+namespace cpugl {
+
+// stencil test passes if (reference & mask) <comparison> (stencil_value & mask)
+enum class stencil_function {
+	never,
+	less,
+	less_or_equal,
+	greater,
+	greater_or_equal,
+	equal,
+	not_equal,
+	always
+};
+
+enum class stencil_operation {
+	keep,
+	zero,
+	replace, // replace with reference value
+	increment, // clamps to maximum value
+	decrement, // clamps to zero
+	increment_wrap,
+	decrement_wrap,
+	invert
+};
+
+struct stencil_state {
+	bool enabled = false;
+
+	stencil_function function = stencil_function::always;
+
+	uint8_t reference = 0;
+
+	// mask applied to reference and stencil values before comparison
+	uint8_t mask = std::numeric_limits<uint8_t>::max();
+
+	// only these bits of the stencil value are modified by the operations
+	uint8_t write_mask = std::numeric_limits<uint8_t>::max();
+
+	// operation to perform on the stencil value when stencil test fails
+	stencil_operation fail = stencil_operation::keep;
+
+	// operation to perform on the stencil value when stencil test passes, and depth test passes or is not done
+	stencil_operation pass = stencil_operation::keep;
+
+	// operation to perform on the stencil value when stencil test passes, but depth test fails
+	stencil_operation depth_fail = stencil_operation::keep;
+
+	bool test(uint8_t value) const noexcept
+	{
+		auto ref = uint8_t(this->reference & this->mask);
+		value &= this->mask;
+
+		switch (this->function) {
+			case stencil_function::never:
+				return false;
+			case stencil_function::less:
+				return ref < value;
+			case stencil_function::less_or_equal:
+				return ref <= value;
+			case stencil_function::greater:
+				return ref > value;
+			case stencil_function::greater_or_equal:
+				return ref >= value;
+			case stencil_function::equal:
+				return ref == value;
+			case stencil_function::not_equal:
+				return ref != value;
+			case stencil_function::always:
+				break;
+		}
+		return true;
+	}
+
+	uint8_t apply(stencil_operation op, uint8_t value) const noexcept
+	{
+		uint8_t res = value;
+
+		switch (op) {
+			case stencil_operation::keep:
+				return value;
+			case stencil_operation::zero:
+				res = 0;
+				break;
+			case stencil_operation::replace:
+				res = this->reference;
+				break;
+			case stencil_operation::increment:
+				if (value != std::numeric_limits<uint8_t>::max()) {
+					res = uint8_t(value + 1);
+				}
+				break;
+			case stencil_operation::decrement:
+				if (value != 0) {
+					res = uint8_t(value - 1);
+				}
+				break;
+			case stencil_operation::increment_wrap:
+				res = uint8_t(value + 1);
+				break;
+			case stencil_operation::decrement_wrap:
+				res = uint8_t(value - 1);
+				break;
+			case stencil_operation::invert:
+				res = uint8_t(~value);
+				break;
+		}
+
+		return uint8_t((value & ~this->write_mask) | (res & this->write_mask));
+	}
+
+	// Perform stencil test and update the stencil value according to the test result
+	// and to the result of the depth test, which is only relevant if the stencil test passes.
+	// Returns true if the fragment passed the stencil test.
+	bool test_and_update(uint8_t& value, bool depth_passed = true) const noexcept
+	{
+		bool passed = this->test(value);
+		if (!passed) {
+			value = this->apply(this->fail, value);
+		} else {
+			value = this->apply(depth_passed ? this->pass : this->depth_fail, value);
+		}
+		return passed;
+	}
+};
+
+} // namespace cpugl
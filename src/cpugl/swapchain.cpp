@@ -0,0 +1,99 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "swapchain.hpp"
+
+using namespace cpugl;
+
+swapchain::swapchain(presenter& p, unsigned num_buffers) :
+	presenter_v(p),
+	stale_areas(num_buffers, rectangle{{0, 0}, {0, 0}})
+{
+	ASSERT(num_buffers > 0)
+}
+
+swapchain::~swapchain()
+{
+	for (unsigned i = 0; i != this->get_num_buffers(); ++i) {
+		this->presenter_v.wait(i);
+	}
+}
+
+void swapchain::resize(r4::vector2<uint32_t> dims)
+{
+	if (this->dims == dims) {
+		return;
+	}
+
+	for (unsigned i = 0; i != this->get_num_buffers(); ++i) {
+		this->presenter_v.wait(i);
+	}
+
+	this->presenter_v.resize(dims, this->get_num_buffers());
+	this->dims = dims;
+	this->current = 0;
+
+	this->invalidate();
+}
+
+void swapchain::invalidate()
+{
+	for (auto& a : this->stale_areas) {
+		a = {{0, 0}, this->dims};
+	}
+}
+
+swapchain::frame swapchain::acquire()
+{
+	{
+		CPUGL_TRACE_SCOPE(this->traces, "acquire");
+		this->presenter_v.wait(this->current);
+	}
+
+	return {
+		.framebuffer = this->presenter_v.get_buffer(this->current),
+		.stale_area = this->stale_areas[this->current]
+	};
+}
+
+void swapchain::present(const rectangle& area)
+{
+	CPUGL_TRACE_SCOPE(this->traces, "present");
+
+	auto a = intersect(area, {{0, 0}, this->dims});
+
+	this->presenter_v.present(this->current, a);
+
+	for (auto& s : this->stale_areas) {
+		s = unite(s, a);
+	}
+	this->stale_areas[this->current] = a;
+
+	++this->current;
+	if (this->current == this->get_num_buffers()) {
+		this->current = 0;
+	}
+}
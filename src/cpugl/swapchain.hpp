@@ -0,0 +1,134 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <vector>
+
+#include "context.hpp"
+
+namespace cpugl {
+
+// Presenter owns memory of the swapchain framebuffers and displays them.
+class presenter
+{
+public:
+	using fb_span_type = context::fb_span_type;
+
+	presenter() = default;
+
+	presenter(const presenter&) = delete;
+	presenter& operator=(const presenter&) = delete;
+
+	presenter(presenter&&) = delete;
+	presenter& operator=(presenter&&) = delete;
+
+	virtual ~presenter() = default;
+
+	// (Re)allocate framebuffers. No buffer is being presented when this is called.
+	virtual void resize(r4::vector2<uint32_t> dims, unsigned num_buffers) = 0;
+
+	virtual fb_span_type get_buffer(unsigned index) = 0;
+
+	// Start presenting the buffer.
+	// Only the given area of the buffer differs from the previously presented buffer.
+	// Presentation can complete asynchronously, the buffer is not modified until wait() for it returns.
+	virtual void present(unsigned index, const rectangle& area) = 0;
+
+	// Block until presentation of the buffer is complete.
+	virtual void wait(unsigned index) = 0;
+};
+
+// Set of framebuffers which are rendered to and presented in turns,
+// so that rendering of the next frame overlaps with presenting of the previous one.
+// The framebuffers are reused from frame to frame and only reallocated on resize.
+class swapchain
+{
+	presenter& presenter_v;
+
+	std::vector<rectangle> stale_areas;
+
+	r4::vector2<uint32_t> dims{0, 0};
+
+	unsigned current = 0;
+
+	tracer* traces = nullptr;
+
+public:
+	constexpr static unsigned default_num_buffers = 2;
+
+	swapchain(presenter& p, unsigned num_buffers = default_num_buffers);
+
+	swapchain(const swapchain&) = delete;
+	swapchain& operator=(const swapchain&) = delete;
+
+	swapchain(swapchain&&) = delete;
+	swapchain& operator=(swapchain&&) = delete;
+
+	~swapchain();
+
+	unsigned get_num_buffers() const noexcept
+	{
+		return unsigned(this->stale_areas.size());
+	}
+
+	const r4::vector2<uint32_t>& get_dims() const noexcept
+	{
+		return this->dims;
+	}
+
+	// Record waiting for and presenting the framebuffers to the tracer, e.g. the context's one.
+	// nullptr disables recording.
+	void set_tracer(tracer* t) noexcept
+	{
+		this->traces = t;
+	}
+
+	// Reallocate framebuffers if dimensions differ from current ones.
+	void resize(r4::vector2<uint32_t> dims);
+
+	// Mark contents of all framebuffers as stale, e.g. when window contents were lost.
+	void invalidate();
+
+	struct frame {
+		context::fb_span_type framebuffer;
+
+		// Area of the framebuffer which has to be redrawn.
+		// The framebuffer holds the frame presented from it last time,
+		// the stale area is the union of areas presented since then, including that presentation.
+		// The whole framebuffer is stale after resize() or invalidate().
+		rectangle stale_area;
+	};
+
+	// Wait until next framebuffer is not presented anymore and return it for rendering.
+	frame acquire();
+
+	// Present the framebuffer returned by last acquire().
+	// Only the given area is sent to the presenter, normally it is the context's damage.
+	void present(const rectangle& area);
+};
+
+} // namespace cpugl
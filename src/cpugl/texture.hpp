@@ -27,11 +27,63 @@ SOFTWARE.
 #pragma once
 
 #include <rasterimage/image.hpp>
+#include <utki/span.hpp>
 
 #include "config.hpp"
 
 namespace cpugl {
 
+// Read-only view of RGBA texels stored elsewhere, e.g. in a memory-mapped texture file.
+// Can be used as texture image.
+class texture_image_view
+{
+	r4::vector2<uint32_t> dimensions{0, 0};
+	const r4::vector4<uint8_t>* texels = nullptr;
+
+public:
+	using pixel_type = r4::vector4<uint8_t>;
+
+	texture_image_view() = default;
+
+	texture_image_view(r4::vector2<uint32_t> dims, const pixel_type* texels) :
+		dimensions(dims),
+		texels(texels)
+	{}
+
+	const r4::vector2<uint32_t>& dims() const noexcept
+	{
+		return this->dimensions;
+	}
+
+	utki::span<const pixel_type> operator[](uint32_t y) const noexcept
+	{
+		ASSERT(y < this->dimensions.y())
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		return {this->texels + size_t(y) * this->dimensions.x(), this->dimensions.x()};
+	}
+};
+
+// Texel position for the texture coordinates, which are in [0, 1] range.
+// Coordinate 1 maps to the last texel.
+inline r4::vector2<uint32_t> calc_texel_position(
+	const r4::vector2<real>& dims,
+	const r4::vector2<uint32_t>& image_dims,
+	const r4::vector2<real>& tex_coords
+)
+{
+	ASSERT(tex_coords.is_positive_or_zero())
+	auto tc = dims.comp_mul(tex_coords).to<uint32_t>();
+	if (tc.x() == image_dims.x()) {
+		--tc.x();
+	}
+	if (tc.y() == image_dims.y()) {
+		--tc.y();
+	}
+	ASSERT(tc.x() < image_dims.x())
+	ASSERT(tc.y() < image_dims.y())
+	return tc;
+}
+
 template <typename image_type>
 class texture
 {
@@ -52,16 +104,7 @@ public:
 
 	const image_type::pixel_type& get(const r4::vector2<real>& tex_coords) const
 	{
-		ASSERT(tex_coords.is_positive_or_zero())
-		auto tc = this->dims.comp_mul(tex_coords).template to<unsigned>();
-		if (tc.x() == this->image.dims().x()) {
-			--tc.x();
-		}
-		if (tc.y() == this->image.dims().y()) {
-			--tc.y();
-		}
-		ASSERT(tc.x() < this->image.dims().x())
-		ASSERT(tc.y() < this->image.dims().y())
+		auto tc = calc_texel_position(this->dims, this->image.dims(), tex_coords);
 		return this->image[tc.y()][tc.x()];
 	}
 };
@@ -0,0 +1,204 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "texture_file.hpp"
+
+#if M_OS != M_OS_WINDOWS
+
+#	include <algorithm>
+#	include <cstring>
+#	include <fstream>
+#	include <stdexcept>
+#	include <string>
+
+using namespace cpugl;
+
+std::vector<rasterimage::image<uint8_t, 4>> cpugl::make_mip_chain(rasterimage::image<uint8_t, 4> image)
+{
+	std::vector<rasterimage::image<uint8_t, 4>> ret;
+	ret.push_back(std::move(image));
+
+	for (;;) {
+		const auto& src = ret.back();
+		auto src_dims = src.dims();
+		if (src_dims.x() <= 1 && src_dims.y() <= 1) {
+			break;
+		}
+
+		using std::max;
+		r4::vector2<uint32_t> dims{max(src_dims.x() / 2, 1u), max(src_dims.y() / 2, 1u)};
+
+		rasterimage::image<uint8_t, 4> level(dims);
+
+		for (uint32_t y = 0; y != dims.y(); ++y) {
+			// odd sized levels lose the last row or column, 1 pixel wide levels reuse it
+			uint32_t y0 = y * 2;
+			uint32_t y1 = std::min(y0 + 1, src_dims.y() - 1);
+			for (uint32_t x = 0; x != dims.x(); ++x) {
+				uint32_t x0 = x * 2;
+				uint32_t x1 = std::min(x0 + 1, src_dims.x() - 1);
+
+				auto sum = src[y0][x0].to<uint32_t>() + src[y0][x1].to<uint32_t>() +
+					src[y1][x0].to<uint32_t>() + src[y1][x1].to<uint32_t>();
+
+				constexpr auto rounding = 2;
+				level[y][x] = ((sum + r4::vector4<uint32_t>(rounding)) / 4).to<uint8_t>();
+			}
+		}
+
+		// push_back() invalidates src reference, but it is not used after this point
+		ret.push_back(std::move(level));
+	}
+
+	return ret;
+}
+
+namespace {
+rasterimage::image<uint8_t, 4> to_rgba(const rasterimage::image_variant& image)
+{
+	return std::visit(
+		[](const auto& im) -> rasterimage::image<uint8_t, 4> {
+			using image_type = std::remove_cvref_t<decltype(im)>;
+			if constexpr (std::is_same_v<uint8_t, typename image_type::pixel_type::value_type>) {
+				rasterimage::image<uint8_t, 4> ret(im.dims());
+				for (uint32_t y = 0; y != im.dims().y(); ++y) {
+					std::transform(im[y].begin(), im[y].end(), ret[y].begin(), [](const auto& px) {
+						return rasterimage::get_rgba(px);
+					});
+				}
+				return ret;
+			} else {
+				throw std::invalid_argument("write_texture_file(): only 8 bits per channel images are supported");
+			}
+		},
+		image.variant
+	);
+}
+} // namespace
+
+void cpugl::write_texture_file(std::string_view path, const rasterimage::image_variant& image)
+{
+	auto levels = make_mip_chain(to_rgba(image));
+
+	if (levels.size() > texture_file_header::max_levels) {
+		throw std::invalid_argument("write_texture_file(): image is too big");
+	}
+
+	texture_file_header header{};
+	header.magic = texture_file_header::file_magic;
+	header.version = texture_file_header::file_version;
+	header.endianness = texture_file_header::endianness_tag;
+	header.num_levels = uint32_t(levels.size());
+
+	uint64_t offset = sizeof(header);
+	for (size_t i = 0; i != levels.size(); ++i) {
+		offset = (offset + texture_file_header::level_alignment - 1) / texture_file_header::level_alignment *
+			texture_file_header::level_alignment;
+
+		auto& l = header.levels[i];
+		l.width = levels[i].dims().x();
+		l.height = levels[i].dims().y();
+		l.offset = offset;
+
+		offset += uint64_t(l.width) * l.height * sizeof(texture_image_view::pixel_type);
+	}
+
+	std::ofstream stream(std::string(path), std::ios::binary | std::ios::trunc);
+	if (!stream) {
+		throw std::runtime_error("write_texture_file(): could not open file for writing");
+	}
+
+	auto write = [&stream](const void* data, size_t size) {
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		stream.write(reinterpret_cast<const char*>(data), std::streamsize(size));
+	};
+
+	write(&header, sizeof(header));
+
+	for (size_t i = 0; i != levels.size(); ++i) {
+		constexpr std::array<char, texture_file_header::level_alignment> padding{};
+		write(padding.data(), size_t(header.levels[i].offset - uint64_t(stream.tellp())));
+
+		auto pixels = levels[i].pixels();
+		write(pixels.data(), pixels.size_bytes());
+	}
+
+	if (!stream) {
+		throw std::runtime_error("write_texture_file(): could not write file");
+	}
+}
+
+mapped_texture::mapped_texture(std::string_view path) :
+	file(path)
+{
+	auto data = this->file.data();
+
+	texture_file_header header{};
+	if (data.size() < sizeof(header)) {
+		throw std::runtime_error("mapped_texture: file is too small");
+	}
+	std::memcpy(&header, data.data(), sizeof(header));
+
+	if (header.magic != texture_file_header::file_magic || header.version != texture_file_header::file_version ||
+		header.endianness != texture_file_header::endianness_tag || header.num_levels == 0 ||
+		header.num_levels > texture_file_header::max_levels)
+	{
+		throw std::runtime_error("mapped_texture: unsupported file format");
+	}
+
+	for (uint32_t i = 0; i != header.num_levels; ++i) {
+		const auto& l = header.levels[i];
+
+		if (l.width == 0 || l.height == 0) {
+			throw std::invalid_argument("mapped_texture: level has zero size");
+		}
+
+		if (i != 0) {
+			using std::max;
+			const auto& prev = header.levels[i - 1];
+			if (l.width != max(prev.width / 2, 1u) || l.height != max(prev.height / 2, 1u) ||
+				(prev.width == 1 && prev.height == 1))
+			{
+				throw std::invalid_argument("mapped_texture: level is not half the size of the previous one");
+			}
+		}
+
+		uint64_t size = uint64_t(l.width) * l.height * sizeof(texture_image_view::pixel_type);
+		if (l.offset % alignof(texture_image_view::pixel_type) != 0 || l.offset > data.size() ||
+			size > data.size() - l.offset)
+		{
+			throw std::runtime_error("mapped_texture: level is out of file bounds");
+		}
+
+		this->levels.emplace_back(
+			r4::vector2<uint32_t>{l.width, l.height},
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+			reinterpret_cast<const texture_image_view::pixel_type*>(data.data() + l.offset)
+		);
+	}
+}
+
+#endif
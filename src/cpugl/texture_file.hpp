@@ -0,0 +1,110 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <array>
+#include <string_view>
+#include <vector>
+
+#include <rasterimage/image_variant.hpp>
+
+#include "mapped_file.hpp"
+#include "texture.hpp"
+
+#if M_OS != M_OS_WINDOWS
+
+namespace cpugl {
+
+// Binary texture file format.
+// The file holds already decoded texels of all mip levels in the layout used for sampling,
+// i.e. RGBA with 8 bits per channel, rows go without padding.
+// Level 0 is the original image, each next level is half the size of the previous one,
+// down to 1x1.
+struct texture_file_header {
+	constexpr static std::array<char, 8> file_magic = {'C', 'P', 'U', 'G', 'L', 'T', 'E', 'X'};
+	constexpr static uint32_t file_version = 1;
+	constexpr static uint32_t endianness_tag = 0x01020304;
+
+	// enough for 2^31 x 2^31 textures
+	constexpr static size_t max_levels = 32;
+
+	// levels start at this alignment
+	constexpr static size_t level_alignment = 64;
+
+	struct level {
+		uint32_t width;
+		uint32_t height;
+		uint64_t offset;
+	};
+
+	std::array<char, 8> magic;
+	uint32_t version;
+	uint32_t endianness;
+	uint32_t num_levels;
+	uint32_t reserved;
+	std::array<level, max_levels> levels;
+};
+
+// Generate the mip chain from the image, the first element is the image itself.
+// Each level is a 2x2 box filtered previous level.
+std::vector<rasterimage::image<uint8_t, 4>> make_mip_chain(rasterimage::image<uint8_t, 4> image);
+
+// Convert the image to the texture file format and write it to the file.
+// Throws std::invalid_argument if the image does not have 8 bits per channel.
+// Throws std::runtime_error if the file could not be written.
+void write_texture_file(std::string_view path, const rasterimage::image_variant& image);
+
+// Texture memory-mapped from a file written with write_texture_file().
+// The texels are not read on loading, pages are brought in by the OS as they are sampled and
+// are shared between processes which map the same file.
+class mapped_texture
+{
+	mapped_file file;
+
+	std::vector<texture_image_view> levels;
+
+public:
+	// throws std::system_error if the file could not be mapped,
+	// throws std::runtime_error if the file is not a valid texture file,
+	// throws std::invalid_argument if sizes of the mip levels are zero or do not form a mip chain
+	explicit mapped_texture(std::string_view path);
+
+	size_t num_levels() const noexcept
+	{
+		return this->levels.size();
+	}
+
+	const texture_image_view& get_level(size_t index) const noexcept
+	{
+		ASSERT(index < this->levels.size())
+		return this->levels[index];
+	}
+};
+
+} // namespace cpugl
+
+#endif
@@ -0,0 +1,157 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+#include <utki/debug.hpp>
+
+using namespace cpugl;
+
+thread_pool::thread_pool(unsigned num_threads)
+{
+	this->threads.reserve(num_threads);
+	for (unsigned i = 0; i != num_threads; ++i) {
+		this->threads.emplace_back([this]() {
+			this->run();
+		});
+	}
+}
+
+thread_pool::~thread_pool()
+{
+	{
+		std::lock_guard lock(this->mutex);
+		this->quit = true;
+	}
+	this->job_cond_var.notify_all();
+
+	for (auto& t : this->threads) {
+		t.join();
+	}
+}
+
+void thread_pool::job::run()
+{
+	for (;;) {
+		size_t begin = this->next.fetch_add(this->chunk_size, std::memory_order_relaxed);
+		if (begin >= this->size) {
+			return;
+		}
+
+		try {
+			(*this->func)(begin, std::min(begin + this->chunk_size, this->size));
+		} catch (...) {
+			{
+				std::lock_guard lock(this->exception_mutex);
+				if (!this->exception) {
+					this->exception = std::current_exception();
+				}
+			}
+			// skip remaining chunks
+			this->next.store(this->size, std::memory_order_relaxed);
+			return;
+		}
+	}
+}
+
+void thread_pool::run()
+{
+	unsigned generation = 0;
+
+	for (;;) {
+		{
+			std::unique_lock lock(this->mutex);
+			this->job_cond_var.wait(lock, [this, &generation]() {
+				return this->quit || this->job_generation != generation;
+			});
+			if (this->quit) {
+				return;
+			}
+			generation = this->job_generation;
+		}
+
+		this->cur_job.run();
+
+		{
+			std::lock_guard lock(this->mutex);
+			ASSERT(this->num_busy_threads != 0)
+			--this->num_busy_threads;
+			if (this->num_busy_threads != 0) {
+				continue;
+			}
+		}
+		this->done_cond_var.notify_one();
+	}
+}
+
+void thread_pool::parallel_for(
+	size_t size,
+	size_t chunk_size,
+	const std::function<void(size_t begin, size_t end)>& func
+)
+{
+	ASSERT(chunk_size != 0)
+
+	if (size == 0) {
+		return;
+	}
+
+	if (this->threads.empty() || size <= chunk_size) {
+		func(0, size);
+		return;
+	}
+
+	std::lock_guard job_lock(this->job_mutex);
+
+	// the threads are idle at this point, so the job can be set up without locking
+	this->cur_job.func = &func;
+	this->cur_job.size = size;
+	this->cur_job.chunk_size = chunk_size;
+	this->cur_job.next.store(0, std::memory_order_relaxed);
+	this->cur_job.exception = nullptr;
+
+	{
+		std::lock_guard lock(this->mutex);
+		this->num_busy_threads = unsigned(this->threads.size());
+		++this->job_generation;
+	}
+	this->job_cond_var.notify_all();
+
+	this->cur_job.run();
+
+	{
+		std::unique_lock lock(this->mutex);
+		this->done_cond_var.wait(lock, [this]() {
+			return this->num_busy_threads == 0;
+		});
+	}
+
+	if (this->cur_job.exception) {
+		std::rethrow_exception(this->cur_job.exception);
+	}
+}
@@ -0,0 +1,101 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cpugl {
+
+// Fixed set of threads for data parallel work.
+// The thread which calls parallel_for() takes part in the work as well.
+class thread_pool
+{
+	std::vector<std::thread> threads;
+
+	// serializes parallel_for() calls from different threads
+	std::mutex job_mutex;
+
+	std::mutex mutex;
+	std::condition_variable job_cond_var;
+	std::condition_variable done_cond_var;
+
+	// incremented for each job, threads wait for it to change
+	unsigned job_generation = 0;
+	unsigned num_busy_threads = 0;
+	bool quit = false;
+
+	struct job {
+		const std::function<void(size_t begin, size_t end)>* func = nullptr;
+		size_t size = 0;
+		size_t chunk_size = 1;
+		std::atomic<size_t> next{0};
+
+		std::mutex exception_mutex;
+		std::exception_ptr exception;
+
+		void run();
+	} cur_job;
+
+	void run();
+
+public:
+	// one thread less than the hardware concurrency, because the calling thread also does the work
+	static unsigned get_default_num_threads() noexcept
+	{
+		return std::max(std::thread::hardware_concurrency(), 1u) - 1;
+	}
+
+	explicit thread_pool(unsigned num_threads = get_default_num_threads());
+
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	thread_pool(thread_pool&&) = delete;
+	thread_pool& operator=(thread_pool&&) = delete;
+
+	~thread_pool();
+
+	// number of threads doing the work, including the calling one
+	size_t get_concurrency() const noexcept
+	{
+		return this->threads.size() + 1;
+	}
+
+	// Split [0, size) range into chunks of chunk_size and call func(begin, end) for each chunk,
+	// chunks are processed concurrently. Returns when all chunks are done.
+	// If func throws, the remaining chunks are skipped and the exception is rethrown.
+	void parallel_for(size_t size, size_t chunk_size, const std::function<void(size_t begin, size_t end)>& func);
+};
+
+} // namespace cpugl
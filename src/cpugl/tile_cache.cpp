@@ -0,0 +1,204 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "tile_cache.hpp"
+
+#include <algorithm>
+
+#include <utki/util.hpp>
+
+using namespace cpugl;
+
+void tile_cache::add(uint64_t hash, const rectangle& bounds, std::function<void(context&)> draw)
+{
+	this->commands.push_back({.hash = hash, .bounds = bounds, .draw = std::move(draw)});
+}
+
+rectangle tile_cache::get_tile_area(uint32_t x, uint32_t y, uint32_t num_tiles) const noexcept
+{
+	return intersect(
+		{r4::vector2<uint32_t>{x, y} * tile_size, {num_tiles * tile_size, tile_size}},
+		{{0, 0}, this->dims}
+	);
+}
+
+std::vector<uint64_t> tile_cache::calc_tile_hashes(const rectangle& render_area, shading_rate rate) const
+{
+	std::vector<uint64_t> ret;
+	ret.reserve(size_t(this->tile_dims.x()) * this->tile_dims.y());
+
+	// pixels of the tile which are rendered, and how, depend on the context state
+	for (uint32_t y = 0; y != this->tile_dims.y(); ++y) {
+		for (uint32_t x = 0; x != this->tile_dims.x(); ++x) {
+			auto area = intersect(this->get_tile_area(x, y, 1), render_area);
+			if (is_empty(area)) {
+				// all empty areas are the same
+				area = {{0, 0}, {0, 0}};
+			}
+			ret.push_back(hash_values(initial_hash, area, rate));
+		}
+	}
+
+	for (const auto& c : this->commands) {
+		auto bounds = intersect(c.bounds, {{0, 0}, this->dims});
+		if (is_empty(bounds)) {
+			continue;
+		}
+
+		auto first = bounds.p / tile_size;
+		auto last = (bounds.p + bounds.d - r4::vector2<uint32_t>(1)) / tile_size;
+
+		for (auto y = first.y(); y <= last.y(); ++y) {
+			for (auto x = first.x(); x <= last.x(); ++x) {
+				auto& h = ret[size_t(y) * this->tile_dims.x() + x];
+				h = hash_values(h, c.hash, c.bounds);
+			}
+		}
+	}
+
+	return ret;
+}
+
+std::vector<uint64_t>* tile_cache::find_framebuffer_hashes(const void* data)
+{
+	auto i = std::find_if(this->framebuffers.begin(), this->framebuffers.end(), [data](const auto& fb) {
+		return fb.data == data;
+	});
+	if (i == this->framebuffers.end()) {
+		return nullptr;
+	}
+
+	// move to the end as most recently used
+	std::rotate(i, std::next(i), this->framebuffers.end());
+	return &this->framebuffers.back().hashes;
+}
+
+void tile_cache::render(context& ctx)
+{
+	CPUGL_TRACE_SCOPE(ctx.get_tracer(), "tile cache");
+
+	const auto& framebuffer = ctx.get_framebuffer();
+
+	this->num_rendered_tiles = 0;
+
+	if (framebuffer.dims() != this->dims) {
+		this->invalidate();
+		this->dims = framebuffer.dims();
+		this->tile_dims = (this->dims + r4::vector2<uint32_t>(tile_size - 1)) / tile_size;
+	}
+
+	if (is_empty({{0, 0}, this->dims})) {
+		this->commands.clear();
+		return;
+	}
+
+	// the user's scissor and redraw region
+	auto render_area = ctx.get_render_area();
+
+	auto hashes = this->calc_tile_hashes(render_area, ctx.get_shading_rate());
+
+	const void* fb_data = framebuffer.data();
+	auto fb_hashes = this->find_framebuffer_hashes(fb_data);
+
+	auto user_scissor = ctx.get_scissor();
+
+	// commands are rendered with scissor set to the tiles, the user's one is restored afterwards
+	utki::scope_exit scissor_scope_exit([&ctx, &user_scissor]() {
+		if (user_scissor.has_value()) {
+			ctx.set_scissor(user_scissor.value());
+		} else {
+			ctx.reset_scissor();
+		}
+	});
+
+	// render runs of adjacent tiles in a row at once, so that commands overlapping them are executed once per run
+	for (uint32_t y = 0; y != this->tile_dims.y(); ++y) {
+		auto row_begin = size_t(y) * this->tile_dims.x();
+
+		// tiles outside of the render area are not touched by rendering
+		auto needs_rendering = [&](uint32_t x) {
+			return (!fb_hashes || (*fb_hashes)[row_begin + x] != hashes[row_begin + x]) &&
+				!is_empty(intersect(this->get_tile_area(x, y, 1), render_area));
+		};
+
+		for (uint32_t x = 0; x != this->tile_dims.x();) {
+			if (!needs_rendering(x)) {
+				++x;
+				continue;
+			}
+
+			auto run_end = x + 1;
+			while (run_end != this->tile_dims.x() && needs_rendering(run_end)) {
+				++run_end;
+			}
+
+			auto area = this->get_tile_area(x, y, run_end - x);
+			this->num_rendered_tiles += run_end - x;
+
+			ctx.set_scissor(user_scissor.has_value() ? intersect(area, user_scissor.value()) : area);
+			for (const auto& c : this->commands) {
+				if (!is_empty(intersect(c.bounds, area))) {
+					c.draw(ctx);
+				}
+			}
+
+			x = run_end;
+		}
+	}
+
+	// presentation needs the area which differs from the previous frame,
+	// which can be more than what was rendered, when the framebuffer already held this frame's content
+	for (uint32_t y = 0; y != this->tile_dims.y(); ++y) {
+		for (uint32_t x = 0; x != this->tile_dims.x(); ++x) {
+			auto i = size_t(y) * this->tile_dims.x() + x;
+			if (this->frame_hashes.empty() || this->frame_hashes[i] != hashes[i]) {
+				auto area = intersect(this->get_tile_area(x, y, 1), render_area);
+				if (!is_empty(area)) {
+					ctx.add_damage(area);
+				}
+			}
+		}
+	}
+
+	if (fb_hashes) {
+		*fb_hashes = hashes;
+	} else {
+		if (this->framebuffers.size() == max_framebuffers) {
+			this->framebuffers.erase(this->framebuffers.begin());
+		}
+		this->framebuffers.push_back({.data = fb_data, .hashes = hashes});
+	}
+
+	this->frame_hashes = std::move(hashes);
+
+	this->commands.clear();
+}
+
+void tile_cache::invalidate()
+{
+	this->framebuffers.clear();
+	this->frame_hashes.clear();
+}
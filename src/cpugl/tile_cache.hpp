@@ -0,0 +1,146 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+#include "context.hpp"
+#include "rectangle.hpp"
+
+namespace cpugl {
+
+// seed for the first hash_values() call
+constexpr uint64_t initial_hash = 0xcbf29ce484222325;
+
+// FNV-1a hash of the values' bytes, for building draw command hashes for tile_cache.
+// Floating point values which compare equal can have different hashes, e.g. 0 and -0,
+// which only leads to extra re-rendering.
+template <typename... value_type>
+uint64_t hash_values(uint64_t seed, const value_type&... values) noexcept
+{
+	static_assert(
+		(std::is_trivially_copyable_v<value_type> && ...),
+		"hashed values must be trivially copyable"
+	);
+
+	constexpr uint64_t prime = 0x100000001b3;
+
+	auto hash_bytes = [&seed](const void* data, size_t size) {
+		auto bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i != size; ++i) {
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+			seed = (seed ^ bytes[i]) * prime;
+		}
+	};
+
+	(hash_bytes(&values, sizeof(values)), ...);
+
+	return seed;
+}
+
+// Reuses pixels of framebuffer tiles whose content does not change from frame to frame.
+// Draws of a frame are recorded as commands, each with a hash of all its inputs and its framebuffer bounds.
+// Each tile gets a hash of the commands overlapping it, and only the tiles whose hash differs from the
+// one of the content the framebuffer already holds are re-rendered, with the scissor set to them.
+// Tile hashes also cover the context state the commands are rendered with, i.e. the part of the tile within
+// the render area, which is limited by the user's scissor and redraw region, and the shading rate.
+// Framebuffers are told apart by their memory, so swapchain framebuffers, which hold different frames,
+// are tracked separately. The tile cache replaces redraw of the swapchain's stale area, so redraw region
+// of the context is normally not set.
+class tile_cache
+{
+public:
+	constexpr static uint32_t tile_size = 64;
+
+	// at most this number of framebuffers is tracked, enough for any swapchain
+	constexpr static size_t max_framebuffers = 4;
+
+private:
+	struct command {
+		uint64_t hash;
+		rectangle bounds;
+		std::function<void(context&)> draw;
+	};
+
+	std::vector<command> commands;
+
+	// framebuffer dimensions the hashes are for
+	r4::vector2<uint32_t> dims{0, 0};
+
+	// dimensions in tiles
+	r4::vector2<uint32_t> tile_dims{0, 0};
+
+	// tile hashes of the last rendered frame
+	std::vector<uint64_t> frame_hashes;
+
+	struct framebuffer_tiles {
+		const void* data;
+
+		// hashes of the frames the tiles hold
+		std::vector<uint64_t> hashes;
+	};
+
+	// most recently used go last
+	std::vector<framebuffer_tiles> framebuffers;
+
+	size_t num_rendered_tiles = 0;
+
+	rectangle get_tile_area(uint32_t x, uint32_t y, uint32_t num_tiles) const noexcept;
+
+	std::vector<uint64_t> calc_tile_hashes(const rectangle& render_area, shading_rate rate) const;
+
+	std::vector<uint64_t>* find_framebuffer_hashes(const void* data);
+
+public:
+	// Record draw command of the frame.
+	// The hash must cover everything which affects the pixels the command produces,
+	// e.g. mesh and texture versions, matrices, colors, context state set by the command, see hash_values().
+	// The bounds must contain all pixels the command can touch, the command is only executed for tiles
+	// it overlaps, so too small bounds result in stale pixels.
+	// Clearing the framebuffer is a command as well, usually the first one.
+	void add(uint64_t hash, const rectangle& bounds, std::function<void(context&)> draw);
+
+	// Render recorded commands of the frame to the context's framebuffer, only in the tiles which differ
+	// from what the framebuffer holds. Parts of the tiles within the render area which differ from the previous frame
+	// are added to the context's damage.
+	// The recorded commands are discarded afterwards.
+	void render(context& ctx);
+
+	// Forget contents of all framebuffers, e.g. when the swapchain is resized or invalidated.
+	void invalidate();
+
+	// number of tiles rendered by last render()
+	size_t get_num_rendered_tiles() const noexcept
+	{
+		return this->num_rendered_tiles;
+	}
+};
+
+} // namespace cpugl
@@ -0,0 +1,184 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "trace.hpp"
+
+#include <algorithm>
+#include <array>
+
+using namespace cpugl;
+
+namespace {
+std::atomic<uint64_t> next_tracer_id{1};
+
+// a thread can record to several tracers, e.g. of different contexts
+constexpr size_t max_thread_rings = 4;
+
+struct thread_rings {
+	struct entry {
+		uint64_t tracer_id = 0;
+		void* ring = nullptr;
+	};
+
+	std::array<entry, max_thread_rings> entries;
+	size_t next_replaced = 0;
+};
+
+thread_local thread_rings cur_thread_rings;
+
+void write_json_string(std::ostream& out, const char* str)
+{
+	out << '"';
+	for (; *str != '\0'; std::advance(str, 1)) {
+		if (*str == '"' || *str == '\\') {
+			out << '\\';
+		}
+		out << *str;
+	}
+	out << '"';
+}
+
+// Chrome trace timestamps are in microseconds
+void write_microseconds(std::ostream& out, uint64_t ns)
+{
+	constexpr uint64_t ns_per_us = 1000;
+	constexpr int fraction_digits = 3;
+
+	auto fraction = std::to_string(ns % ns_per_us);
+	out << ns / ns_per_us << '.' << std::string(fraction_digits - fraction.size(), '0') << fraction;
+}
+} // namespace
+
+tracer::tracer(size_t ring_capacity) :
+	ring_capacity(ring_capacity),
+	id(next_tracer_id.fetch_add(1, std::memory_order_relaxed))
+{}
+
+tracer::ring& tracer::get_thread_ring()
+{
+	auto& tr = cur_thread_rings;
+	for (const auto& e : tr.entries) {
+		if (e.tracer_id == this->id) {
+			return *static_cast<ring*>(e.ring);
+		}
+	}
+
+	ring* r = nullptr;
+	{
+		std::lock_guard lock(this->mutex);
+
+		auto thread_id = std::this_thread::get_id();
+		auto i = std::find_if(this->rings.begin(), this->rings.end(), [&thread_id](const auto& r) {
+			return r->thread_id == thread_id;
+		});
+		if (i != this->rings.end()) {
+			r = i->get();
+		} else {
+			this->rings.push_back(std::make_unique<ring>());
+			r = this->rings.back().get();
+			r->thread_id = thread_id;
+			r->thread_number = unsigned(this->rings.size() - 1);
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays)
+			r->spans = std::make_unique_for_overwrite<span[]>(this->ring_capacity);
+		}
+	}
+
+	// in case the thread records to too many tracers, its ring is looked up again when it comes back to this one
+	tr.entries[tr.next_replaced] = {.tracer_id = this->id, .ring = r};
+	tr.next_replaced = (tr.next_replaced + 1) % tr.entries.size();
+
+	return *r;
+}
+
+void tracer::record(const char* name, uint64_t begin, uint64_t end)
+{
+	auto& r = this->get_thread_ring();
+
+	// only this thread writes to the ring
+	auto n = r.num_written.load(std::memory_order_relaxed);
+	r.spans[n % this->ring_capacity] = {.name = name, .begin = begin, .end = end};
+	r.num_written.store(n + 1, std::memory_order_release);
+}
+
+std::vector<std::pair<unsigned, tracer::span>> tracer::get_spans() const
+{
+	std::lock_guard lock(this->mutex);
+
+	std::vector<std::pair<unsigned, span>> ret;
+	for (const auto& r : this->rings) {
+		auto n = r->num_written.load(std::memory_order_acquire);
+		for (auto i = n - std::min(n, uint64_t(this->ring_capacity)); i != n; ++i) {
+			ret.emplace_back(r->thread_number, r->spans[i % this->ring_capacity]);
+		}
+	}
+
+	std::stable_sort(ret.begin(), ret.end(), [](const auto& a, const auto& b) {
+		return a.second.begin < b.second.begin;
+	});
+
+	return ret;
+}
+
+void tracer::write_chrome_trace(std::ostream& out) const
+{
+	auto spans = this->get_spans();
+
+	out << R"({"displayTimeUnit":"ns","traceEvents":[)";
+
+	const char* separator = "\n";
+
+	unsigned num_threads = 0;
+	{
+		std::lock_guard lock(this->mutex);
+		num_threads = unsigned(this->rings.size());
+	}
+	for (unsigned i = 0; i != num_threads; ++i) {
+		out << separator << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << i
+			<< R"(,"args":{"name":"cpugl thread )" << i << R"("}})";
+		separator = ",\n";
+	}
+
+	for (const auto& [thread, s] : spans) {
+		out << separator << R"({"name":)";
+		write_json_string(out, s.name);
+		out << R"(,"cat":"cpugl","ph":"X","pid":1,"tid":)" << thread << R"(,"ts":)";
+		write_microseconds(out, s.begin);
+		out << R"(,"dur":)";
+		write_microseconds(out, s.end - s.begin);
+		out << '}';
+		separator = ",\n";
+	}
+
+	out << "\n]}\n";
+}
+
+void tracer::clear()
+{
+	std::lock_guard lock(this->mutex);
+	for (auto& r : this->rings) {
+		r->num_written.store(0, std::memory_order_relaxed);
+	}
+}
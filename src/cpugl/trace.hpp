@@ -0,0 +1,172 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+namespace cpugl {
+
+// Timeline of rendering stages for finding load imbalance between threads and stalls.
+// Each thread records spans into its own ring buffer without locking, except when the ring is not
+// in the thread's small cache of recently used rings, e.g. when the thread records to the tracer for the first time. When a ring buffer is full, the oldest spans are overwritten.
+// The recorded spans can be written in Chrome trace event format, which is also understood by Perfetto.
+// Spans are recorded by the CPUGL_TRACE_SCOPE() macro, which compiles to nothing unless CPUGL_TRACE is defined.
+class tracer
+{
+public:
+	constexpr static size_t default_ring_capacity = size_t(1) << 14;
+
+	struct span {
+		// must be a string literal or other string which outlives the tracer
+		const char* name;
+
+		// nanoseconds since the tracer creation
+		uint64_t begin;
+		uint64_t end;
+	};
+
+private:
+	struct ring {
+		std::thread::id thread_id;
+
+		// number of the thread in the order of the first recording
+		unsigned thread_number;
+
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays)
+		std::unique_ptr<span[]> spans;
+
+		// total number of spans ever written, the last ones are in spans[num_written % capacity]
+		std::atomic<uint64_t> num_written{0};
+	};
+
+	const size_t ring_capacity;
+
+	const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+	// unique among all tracers, identifies the tracer in threads' ring caches
+	const uint64_t id;
+
+	// protects the list of rings, the rings themselves are written without locking
+	mutable std::mutex mutex;
+	std::vector<std::unique_ptr<ring>> rings;
+
+	ring& get_thread_ring();
+
+public:
+	explicit tracer(size_t ring_capacity = default_ring_capacity);
+
+	tracer(const tracer&) = delete;
+	tracer& operator=(const tracer&) = delete;
+
+	tracer(tracer&&) = delete;
+	tracer& operator=(tracer&&) = delete;
+
+	~tracer() = default;
+
+	// nanoseconds since the tracer creation
+	uint64_t now() const noexcept
+	{
+		return uint64_t(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - this->origin)
+				.count()
+		);
+	}
+
+	// thread safe
+	void record(const char* name, uint64_t begin, uint64_t end);
+
+	// Get spans recorded by all threads, as pairs of thread number and span.
+	// Must not be called while other threads record.
+	std::vector<std::pair<unsigned, span>> get_spans() const;
+
+	// Write spans in Chrome trace event JSON format.
+	// Must not be called while other threads record.
+	void write_chrome_trace(std::ostream& out) const;
+
+	// Discard recorded spans.
+	// Must not be called while other threads record.
+	void clear();
+};
+
+// Records span from construction till destruction.
+class trace_scope
+{
+	tracer* t;
+	const char* name;
+	uint64_t begin = 0;
+
+public:
+	trace_scope(tracer& t, const char* name) :
+		trace_scope(&t, name)
+	{}
+
+	// nothing is recorded if the tracer is nullptr
+	trace_scope(tracer* t, const char* name) :
+		t(t),
+		name(name)
+	{
+		if (this->t) {
+			this->begin = this->t->now();
+		}
+	}
+
+	trace_scope(const trace_scope&) = delete;
+	trace_scope& operator=(const trace_scope&) = delete;
+
+	trace_scope(trace_scope&&) = delete;
+	trace_scope& operator=(trace_scope&&) = delete;
+
+	~trace_scope()
+	{
+		if (this->t) {
+			this->t->record(this->name, this->begin, this->t->now());
+		}
+	}
+};
+
+} // namespace cpugl
+
+#ifdef CPUGL_TRACE
+#	define CPUGL_TRACE_CONCAT_IMPL(a, b) a##b
+#	define CPUGL_TRACE_CONCAT(a, b) CPUGL_TRACE_CONCAT_IMPL(a, b)
+
+// Record span from this point till the end of the enclosing scope to the tracer,
+// which is given by reference or by pointer, nullptr disables recording.
+#	define CPUGL_TRACE_SCOPE(tracer, name) \
+		const cpugl::trace_scope CPUGL_TRACE_CONCAT(cpugl_trace_scope_, __LINE__)((tracer), (name))
+#else
+#	define CPUGL_TRACE_SCOPE(tracer, name) \
+		do { \
+		} while (false)
+#endif
@@ -0,0 +1,96 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "visibility_buffer.hpp"
+
+using namespace cpugl;
+
+void visibility_buffer::resize(r4::vector2<uint32_t> dims)
+{
+	this->dims = dims;
+	this->ids.assign(size_t(dims.x()) * dims.y(), fragment_id{});
+	this->draws.clear();
+	this->written_area = {{0, 0}, {0, 0}};
+}
+
+uint32_t visibility_buffer::add_draw(owned_draw d)
+{
+	ASSERT(d)
+	ASSERT(this->draws.size() < fragment_id::invalid_draw)
+	this->draws.push_back(std::move(d));
+	return uint32_t(this->draws.size() - 1);
+}
+
+void visibility_buffer::resolve(context& ctx)
+{
+	CPUGL_TRACE_SCOPE(ctx.get_tracer(), "resolve");
+
+	const auto& framebuffer = ctx.get_framebuffer();
+	ASSERT(framebuffer.dims() == this->dims)
+
+	auto area = intersect(this->written_area, {{0, 0}, framebuffer.dims()});
+
+	for (auto y = area.p.y(); y != area.p.y() + area.d.y(); ++y) {
+		auto id_line = (*this)[y];
+		auto framebuffer_line = framebuffer[y];
+
+		auto x = area.p.x();
+		auto end = area.p.x() + area.d.x();
+		while (x != end) {
+			auto draw_index = id_line[x].draw;
+
+			// find run of pixels of the same draw
+			auto run_end = x + 1;
+			while (run_end != end && id_line[run_end].draw == draw_index) {
+				++run_end;
+			}
+
+			if (draw_index != fragment_id::invalid_draw) {
+				ASSERT(draw_index < this->draws.size())
+				this->draws[draw_index]->shade(
+					framebuffer_line.subspan(x, run_end - x),
+					id_line.subspan(x, run_end - x),
+					{x, y}
+				);
+			}
+
+			x = run_end;
+		}
+	}
+
+	this->clear();
+}
+
+void visibility_buffer::clear()
+{
+	for (auto y = this->written_area.p.y(); y != this->written_area.p.y() + this->written_area.d.y(); ++y) {
+		auto line = (*this)[y].subspan(this->written_area.p.x(), this->written_area.d.x());
+		std::fill(line.begin(), line.end(), fragment_id{});
+	}
+
+	this->draws.clear();
+	this->written_area = {{0, 0}, {0, 0}};
+}
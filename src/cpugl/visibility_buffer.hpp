@@ -0,0 +1,136 @@
+/*
+MIT License
+
+Copyright (c) 2023 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include <utki/span.hpp>
+
+#include "context.hpp"
+#include "rectangle.hpp"
+
+namespace cpugl {
+
+// Visibility buffer for deferred shading.
+// Triangles are first rasterized with pipeline::render_visibility(), which only does depth test and stores
+// the visible triangle of each pixel. Then resolve() runs the fragment programs exactly once per covered pixel,
+// so the shading cost does not depend on the overdraw.
+class visibility_buffer
+{
+public:
+	struct fragment_id {
+		constexpr static uint32_t invalid_draw = std::numeric_limits<uint32_t>::max();
+
+		uint32_t draw = invalid_draw;
+		uint32_t triangle = 0;
+	};
+
+	// Deferred draw call, holds the triangles and the fragment program to shade them.
+	class draw
+	{
+	public:
+		draw() = default;
+
+		draw(const draw&) = delete;
+		draw& operator=(const draw&) = delete;
+
+		draw(draw&&) = delete;
+		draw& operator=(draw&&) = delete;
+
+		virtual ~draw() = default;
+
+		// Shade run of pixels of a framebuffer row which all belong to this draw.
+		// The pos is the position of the first pixel of the run.
+		virtual void shade(
+			utki::span<context::fb_span_type::pixel_type> pixels,
+			utki::span<const fragment_id> ids,
+			r4::vector2<uint32_t> pos
+		) const = 0;
+	};
+
+	// Draws allocated in the context's frame arena are only destroyed, others are deleted.
+	struct draw_destroyer {
+		bool in_arena = true;
+
+		void operator()(draw* d) const noexcept
+		{
+			if (this->in_arena) {
+				std::destroy_at(d);
+			} else {
+				// NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+				delete d;
+			}
+		}
+	};
+
+	using owned_draw = std::unique_ptr<draw, draw_destroyer>;
+
+private:
+	r4::vector2<uint32_t> dims{0, 0};
+
+	std::vector<fragment_id> ids;
+
+	std::vector<owned_draw> draws;
+
+	// area which has valid fragment ids
+	rectangle written_area{{0, 0}, {0, 0}};
+
+public:
+	// must have same dimensions as the context's framebuffer
+	void resize(r4::vector2<uint32_t> dims);
+
+	const r4::vector2<uint32_t>& get_dims() const noexcept
+	{
+		return this->dims;
+	}
+
+	utki::span<fragment_id> operator[](uint32_t y) noexcept
+	{
+		ASSERT(y < this->dims.y())
+		return {std::next(this->ids.data(), ptrdiff_t(size_t(y) * this->dims.x())), this->dims.x()};
+	}
+
+	// Takes ownership of the draw object. If the draw is allocated in the context's frame arena,
+	// its memory must stay valid until resolve() or clear(), otherwise it is allocated with new.
+	// Returns index of the added draw.
+	uint32_t add_draw(owned_draw d);
+
+	void add_written_area(const rectangle& area)
+	{
+		this->written_area = unite(this->written_area, area);
+	}
+
+	// Shade all covered pixels into the context's framebuffer and clear the visibility buffer.
+	void resolve(context& ctx);
+
+	// discard all fragment ids and draws
+	void clear();
+};
+
+} // namespace cpugl
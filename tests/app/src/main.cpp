@@ -7,12 +7,14 @@
 #include <papki/fs_file.hpp>
 
 #include <cpugl/shaders/pos_clr_shader.hpp>
+#include <cpugl/presenters/file_presenter.hpp>
+#include <cpugl/presenters/x11_shm_presenter.hpp>
 
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 
-#if M_OS == M_OS_LINUX
+#if M_OS == M_OS_LINUX && !defined(CPUGL_NO_X11)
 #	include <X11/Xlib.h>
 #	include <X11/Xutil.h>
 #endif
@@ -27,10 +29,65 @@ int main(int argc, char **argv){
 	// auto loadStart = utki::get_ticks_ms();
 #endif
 	
-#if M_OS == M_OS_LINUX
 	constexpr auto width = 800;
 	constexpr auto height = 600;
 
+	cpugl::context glc;
+
+	auto render_frame = [&glc](cpugl::swapchain& swapchain, r4::vector2<unsigned> dims){
+		swapchain.resize(dims);
+
+		auto frame = swapchain.acquire();
+
+		glc.set_framebuffer(frame.framebuffer);
+		glc.reset_damage();
+		glc.begin_frame();
+
+		constexpr auto bg_color = cpugl::context::fb_span_type::pixel_type{0, 0, 0, 0xff};
+		glc.clear(bg_color);
+
+		constexpr auto l = 1;
+		constexpr auto t = 1;
+		constexpr auto r = 799;
+		constexpr auto b = 599;
+
+		const std::vector<r4::vector3<cpugl::real>> vertices = {
+			{l, t, 0},
+			{l, b, 0},
+			{r, b, 0},
+			{r, t, 0}
+		};
+
+		const std::vector<r4::vector4<cpugl::real>> colors = {
+			{1, 0, 0, 1},
+			{0, 1, 0, 1},
+			{0, 0, 1, 1},
+			{0, 1, 1, 1},
+		};
+
+		auto vao = cpugl::make_mesh(
+			{},
+			utki::make_span(vertices),
+			utki::make_span(colors)
+		);
+		vao.quads = {
+			{0, 1, 2, 3}
+		};
+
+		cpugl::pos_clr_shader shader;
+
+		shader.render(
+			glc,
+			r4::matrix4<cpugl::real>().set_identity(),
+			vao
+		);
+
+		swapchain.present(glc.get_damage());
+
+		glc.end_frame();
+	};
+
+#if M_OS == M_OS_LINUX && !defined(CPUGL_NO_X11)
 	Display *display = XOpenDisplay(nullptr);
 	
 	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast, cppcoreguidelines-pro-bounds-pointer-arithmetic)
@@ -47,7 +104,10 @@ int main(int argc, char **argv){
 	XSelectInput(display, window, ButtonPressMask|ExposureMask|KeyPressMask);
 	
 	XMapWindow(display, window);
-	
+
+	cpugl::x11_shm_presenter presenter(display, window);
+	cpugl::swapchain swapchain(presenter);
+
 	while(true){
 		XEvent ev;
 		XNextEvent(display, &ev);
@@ -73,64 +133,7 @@ int main(int argc, char **argv){
 						&dummy_unsigned
 					);
 					
-					cpugl::context glc;
-
-					cpugl::context::fb_image_type fb(win_dims);
-
-					glc.set_framebuffer(fb);
-
-					constexpr auto bg_color = decltype(fb)::pixel_type{0, 0, 0, 0xff};
-					glc.clear(bg_color);
-
-					constexpr auto l = 1;
-					constexpr auto t = 1;
-					constexpr auto r = 799;
-					constexpr auto b = 599;
-
-					const std::vector<r4::vector3<cpugl::real>> vertices = {
-						{l, t, 0},
-						{l, b, 0},
-						{r, b, 0},
-						{r, t, 0}
-					};
-
-					const std::vector<r4::vector4<cpugl::real>> colors = {
-						{1, 0, 0, 1},
-						{0, 1, 0, 1},
-						{0, 0, 1, 1},
-						{0, 1, 1, 1},
-					};
-
-					std::vector<std::array<unsigned, 3>> faces = {
-						{0, 1, 3},
-						{3, 1, 2}
-					};
-
-					auto vao = cpugl::make_mesh(
-						std::move(faces),
-						utki::make_span(vertices),
-						utki::make_span(colors)
-					);
-
-					cpugl::pos_clr_shader shader;
-
-					shader.render(
-						glc,
-						r4::matrix4<cpugl::real>().set_identity(),
-						vao
-					);
-
-					fb.span().swap_red_blue();
-
-					// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-					auto ximage = XCreateImage(display, visual, utki::byte_bits * 3, ZPixmap, 0, reinterpret_cast<char*>(fb.pixels().data()), fb.dims().x(), fb.dims().y(), utki::byte_bits, 0);
-					utki::scope_exit scope_exit([ximage](){
-						ximage->data = nullptr; // Xlib will try to deallocate data which is owned by 'img' variable.
-						XDestroyImage(ximage);
-					});
-					
-					// NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast, cppcoreguidelines-pro-bounds-pointer-arithmetic)
-					XPutImage(display, window, DefaultGC(display, 0), ximage, 0, 0, 0, 0, fb.dims().x(), fb.dims().y());
+					render_frame(swapchain, win_dims);
 				}
 				break;
 			case KeyPress:
@@ -139,5 +142,11 @@ int main(int argc, char **argv){
 				break;
 		}
 	}
+#else
+	// no window to show the frame in, it is written to a file
+	cpugl::file_presenter presenter("app.pam");
+	cpugl::swapchain swapchain(presenter);
+
+	render_frame(swapchain, {width, height});
 #endif
 }
@@ -11,12 +11,15 @@
 #include <cpugl/shaders/pos_clr_shader.hpp>
 #include <cpugl/shaders/color_pos_shader.hpp>
 #include <cpugl/shaders/texture_pos_tex_shader.hpp>
+#include <cpugl/presenters/file_presenter.hpp>
+#include <cpugl/presenters/x11_shm_presenter.hpp>
+#include <cpugl/texture_file.hpp>
 
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 
-#if M_OS == M_OS_LINUX
+#if M_OS == M_OS_LINUX && !defined(CPUGL_NO_X11)
 #	include <X11/Xlib.h>
 #	include <X11/Xutil.h>
 #endif
@@ -36,7 +39,13 @@ int main(int argc, char **argv){
 	constexpr auto b = 1;
 	constexpr auto d = 1;
 
-	auto tex = rasterimage::read_jpeg(papki::fs_file("texture.jpg"));
+	// the decoded texture is cached in a file which is memory-mapped on next runs,
+	// so the JPEG is decoded only once
+	constexpr auto texture_cache_file_name = "texture.cpugltex";
+	if (!papki::fs_file(texture_cache_file_name).exists()) {
+		cpugl::write_texture_file(texture_cache_file_name, rasterimage::read_jpeg(papki::fs_file("texture.jpg")));
+	}
+	cpugl::mapped_texture tex(texture_cache_file_name);
 
 	const std::vector<r4::vector3<cpugl::real>> vertices = {
 		// front
@@ -70,21 +79,12 @@ int main(int argc, char **argv){
 		{r, t, -d},
 	};
 
-	std::vector<std::array<unsigned, 3>> faces = {
-		{0, 1, 3},
-		{3, 1, 2},
-
-		{7, 5, 4},
-		{6, 5, 7},
-
-		{11, 9, 8},
-		{10, 9, 11},
-
-		{12, 13, 15},
-		{15, 13, 14},
-
-		{19, 17, 16},
-		{18, 17, 19},
+	std::vector<std::array<unsigned, 4>> quads = {
+		{0, 1, 2, 3},
+		{7, 6, 5, 4},
+		{11, 10, 9, 8},
+		{12, 13, 14, 15},
+		{19, 18, 17, 16},
 	};
 
 	const std::vector<r4::vector2<cpugl::real>> tex_coords = {
@@ -122,15 +122,68 @@ int main(int argc, char **argv){
 	};
 
 	auto vao = cpugl::make_mesh(
-		std::move(faces),
+		{},
 		utki::make_span(vertices)
 		, utki::make_span(tex_coords)
 		// ,utki::make_span(colors)
 	);
+	vao.quads = std::move(quads);
 
 	constexpr auto width = 800;
 	constexpr auto height = 600;
 
+	cpugl::context glc;
+
+	constexpr auto bg_color = cpugl::context::fb_span_type::pixel_type{0, 0, 0, 0xff};
+
+	auto render_frame = [&](cpugl::swapchain& swapchain, r4::vector2<unsigned> dims){
+		swapchain.resize(dims);
+
+		auto frame = swapchain.acquire();
+
+		glc.set_framebuffer(frame.framebuffer);
+		glc.reset_damage();
+		glc.begin_frame();
+
+		// the framebuffer holds one of the previous frames, clear only what was drawn since then
+		glc.set_redraw_region(frame.stale_area);
+		glc.clear(bg_color);
+		glc.reset_redraw_region();
+
+		r4::matrix4<cpugl::real> matrix;
+		matrix.set_identity();
+
+		matrix.scale(cpugl::real(width) / 2, cpugl::real(height) / 2);
+		matrix.translate(1, 1, 0);
+
+		// matrix.scale(1, -1);
+		// matrix.rotate(r4::quaternion<cpugl::real>({utki::pi, 0, 0}));
+		// matrix.frustum(-2, 2, -1.5, 1.5, 2, 100);
+		// matrix.translate(0, 0, 1); // move projection plane to (0, 0, 0)
+		// matrix.scale(1, -1);
+
+		matrix.scale(1, 4/3.0);
+		matrix.perspective();
+		
+		matrix.translate(0, 0, 4);
+
+		matrix.translate(position);
+		matrix.rotate(rotation);
+
+		cpugl::texture_pos_tex_shader::render(
+			glc,
+			matrix,
+			tex.get_level(0),
+			vao
+		);
+
+		// only pixels which were cleared or drawn have changed
+		swapchain.present(glc.get_damage());
+
+		glc.end_frame();
+	};
+
+#if M_OS == M_OS_LINUX && !defined(CPUGL_NO_X11)
 	Display *display = XOpenDisplay(nullptr);
 	
 	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast, cppcoreguidelines-pro-bounds-pointer-arithmetic)
@@ -147,16 +200,20 @@ int main(int argc, char **argv){
 	XSelectInput(display, window, ButtonPressMask|ExposureMask|KeyPressMask);
 	
 	XMapWindow(display, window);
-	
+
+	cpugl::x11_shm_presenter presenter(display, window);
+	cpugl::swapchain swapchain(presenter);
+
 	while(true){
 		XEvent ev;
 		XNextEvent(display, &ev);
 		switch(ev.type){
 			default:
 				break;
-			// case Expose:
-			// 	// std::cout << "Expose" << std::endl;
-			// 	break;
+			case Expose:
+				// window contents are lost, redraw everything
+				swapchain.invalidate();
+				break;
 			case KeyPress:
 				{
 					constexpr auto esc_key = 9;
@@ -252,53 +309,14 @@ int main(int argc, char **argv){
 				&dummy_unsigned
 			);
 			
-			cpugl::context glc;
-
-			cpugl::context::fb_image_type fb(win_dims);
-
-			glc.set_framebuffer(fb);
-
-			constexpr auto bg_color = decltype(fb)::pixel_type{0, 0, 0, 0xff};
-			glc.clear(bg_color);
-
-			r4::matrix4<cpugl::real> matrix;
-			matrix.set_identity();
-
-			matrix.scale(cpugl::real(width) / 2, cpugl::real(height) / 2);
-			matrix.translate(1, 1, 0);
-
-			// matrix.scale(1, -1);
-			// matrix.rotate(r4::quaternion<cpugl::real>({utki::pi, 0, 0}));
-			// matrix.frustum(-2, 2, -1.5, 1.5, 2, 100);
-			// matrix.translate(0, 0, 1); // move projection plane to (0, 0, 0)
-			// matrix.scale(1, -1);
-
-			matrix.scale(1, 4/3.0);
-			matrix.perspective();
-			
-			matrix.translate(0, 0, 4);
-
-			matrix.translate(position);
-			matrix.rotate(rotation);
-
-			cpugl::texture_pos_tex_shader::render(
-				glc,
-				matrix,
-				tex,
-				vao
-			);
-
-			fb.span().swap_red_blue();
-
-			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-			auto ximage = XCreateImage(display, visual, utki::byte_bits * 3, ZPixmap, 0, reinterpret_cast<char*>(fb.pixels().data()), fb.dims().x(), fb.dims().y(), utki::byte_bits, 0);
-			utki::scope_exit scope_exit([ximage](){
-				ximage->data = nullptr; // Xlib will try to deallocate data which is owned by 'img' variable.
-				XDestroyImage(ximage);
-			});
-			
-			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast, cppcoreguidelines-pro-bounds-pointer-arithmetic)
-			XPutImage(display, window, DefaultGC(display, 0), ximage, 0, 0, 0, 0, fb.dims().x(), fb.dims().y());
+			render_frame(swapchain, win_dims);
 		}
 	}
+#else
+	// no window to show the frame in, it is written to a file
+	cpugl::file_presenter presenter("cube.pam");
+	cpugl::swapchain swapchain(presenter);
+
+	render_frame(swapchain, {width, height});
+#endif
 }
@@ -0,0 +1,107 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <cpugl/pipeline.hpp>
+#include <cpugl/shaders/color_pos_shader.hpp>
+
+namespace{
+const std::vector<r4::vector3<cpugl::real>> vertices = {
+    {1, 2, 3},
+    {-1, 5, 0},
+    {4, -2, 1},
+};
+
+const tst::set set("bounding_volume", [](tst::suite& suite){
+    suite.add("make_mesh_computes_bounds", [](){
+        auto m = cpugl::make_mesh({{0, 1, 2}}, utki::make_span(vertices));
+
+        tst::check(!m.bounds.empty(), SL);
+        tst::check_eq(m.bounds.min, r4::vector3<cpugl::real>{-1, -2, 0}, SL);
+        tst::check_eq(m.bounds.max, r4::vector3<cpugl::real>{4, 5, 3}, SL);
+        tst::check_eq(m.bounds.center, r4::vector3<cpugl::real>{1.5, 1.5, 1.5}, SL);
+
+        for(const auto& v : vertices){
+            tst::check_le((v - m.bounds.center).norm(), m.bounds.radius, SL);
+        }
+    });
+
+    suite.add("empty_mesh_has_empty_bounds", [](){
+        auto m = cpugl::make_mesh({}, utki::span<const r4::vector3<cpugl::real>>());
+
+        tst::check(m.bounds.empty(), SL);
+    });
+
+    suite.add("test_visibility", [](){
+        cpugl::context::fb_image_type fb(r4::vector2<uint32_t>{100, 100});
+        cpugl::context ctx;
+        ctx.set_framebuffer(fb);
+
+        r4::matrix4<cpugl::real> matrix;
+        matrix.set_identity();
+
+        auto m = cpugl::make_mesh({{0, 1, 2}}, utki::make_span(vertices));
+
+        // partially left of and above the framebuffer
+        tst::check(cpugl::pipeline::test_visibility(ctx, matrix, m.bounds) == cpugl::pipeline::visibility::intersecting, SL);
+
+        matrix.translate(10, 10, 0);
+        tst::check(cpugl::pipeline::test_visibility(ctx, matrix, m.bounds) == cpugl::pipeline::visibility::inside, SL);
+
+        matrix.translate(200, 0, 0);
+        tst::check(cpugl::pipeline::test_visibility(ctx, matrix, m.bounds) == cpugl::pipeline::visibility::outside, SL);
+
+        matrix.set_identity();
+        matrix.translate(10, 10, -10);
+        tst::check(cpugl::pipeline::test_visibility(ctx, matrix, m.bounds) == cpugl::pipeline::visibility::outside, SL);
+    });
+
+    suite.add("mesh_with_unknown_bounds_is_not_culled", [](){
+        cpugl::context::fb_image_type fb(r4::vector2<uint32_t>{20, 20});
+        cpugl::context ctx;
+        ctx.set_framebuffer(fb);
+        ctx.clear({0, 0, 0, 0});
+
+        // filled by hand, bounds are not computed
+        cpugl::mesh<> m;
+        m.vertices = {
+            {r4::vector3<cpugl::real>{1, 1, 0}},
+            {r4::vector3<cpugl::real>{1, 10, 0}},
+            {r4::vector3<cpugl::real>{10, 10, 0}},
+        };
+        m.faces = {{0, 1, 2}};
+        tst::check(m.bounds.empty(), SL);
+
+        auto matrix = r4::matrix4<cpugl::real>().set_identity();
+
+        tst::check(cpugl::pipeline::test_visibility(ctx, matrix, m.bounds) == cpugl::pipeline::visibility::intersecting, SL);
+
+        cpugl::color_pos_shader().render(ctx, matrix, {1, 1, 1, 1}, m);
+
+        unsigned num_drawn = 0;
+        for(uint32_t y = 0; y != fb.dims().y(); ++y){
+            for(uint32_t x = 0; x != fb.dims().x(); ++x){
+                if(fb[y][x][3] != 0){
+                    ++num_drawn;
+                }
+            }
+        }
+
+        // same as with the bounds computed
+        m.update_bounds();
+        ctx.clear({0, 0, 0, 0});
+        cpugl::color_pos_shader().render(ctx, matrix, {1, 1, 1, 1}, m);
+
+        unsigned num_drawn_with_bounds = 0;
+        for(uint32_t y = 0; y != fb.dims().y(); ++y){
+            for(uint32_t x = 0; x != fb.dims().x(); ++x){
+                if(fb[y][x][3] != 0){
+                    ++num_drawn_with_bounds;
+                }
+            }
+        }
+
+        tst::check_ne(num_drawn, 0u, SL);
+        tst::check_eq(num_drawn, num_drawn_with_bounds, SL);
+    });
+});
+}
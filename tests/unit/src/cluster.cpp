@@ -0,0 +1,152 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <cpugl/pipeline.hpp>
+#include <cpugl/shaders/pos_clr_shader.hpp>
+
+namespace{
+// closed box made of grid_size x grid_size quads on each side
+cpugl::mesh<cpugl::color_type> make_box(unsigned grid_size){
+    std::vector<r4::vector3<cpugl::real>> vertices;
+    std::vector<cpugl::color_type> colors;
+    std::vector<std::array<unsigned, 3>> faces;
+
+    auto add_side = [&](r4::vector3<cpugl::real> origin, r4::vector3<cpugl::real> u, r4::vector3<cpugl::real> v){
+        auto first = unsigned(vertices.size());
+        for(unsigned j = 0; j <= grid_size; ++j){
+            for(unsigned i = 0; i <= grid_size; ++i){
+                vertices.push_back(origin + u * (cpugl::real(i) / grid_size) + v * (cpugl::real(j) / grid_size));
+                colors.push_back({cpugl::real(i) / grid_size, cpugl::real(j) / grid_size, 0, 1});
+            }
+        }
+        auto index = [&](unsigned i, unsigned j){
+            return first + j * (grid_size + 1) + i;
+        };
+        for(unsigned j = 0; j != grid_size; ++j){
+            for(unsigned i = 0; i != grid_size; ++i){
+                faces.push_back({index(i, j), index(i + 1, j), index(i, j + 1)});
+                faces.push_back({index(i + 1, j), index(i + 1, j + 1), index(i, j + 1)});
+            }
+        }
+    };
+
+    // sides are wound so that normals (v1 - v0) x (v2 - v0) point outside
+    add_side({-1, -1, -1}, {0, 2, 0}, {2, 0, 0});
+    add_side({-1, -1, 1}, {2, 0, 0}, {0, 2, 0});
+    add_side({-1, -1, -1}, {0, 0, 2}, {0, 2, 0});
+    add_side({1, -1, -1}, {0, 2, 0}, {0, 0, 2});
+    add_side({-1, -1, -1}, {2, 0, 0}, {0, 0, 2});
+    add_side({-1, 1, -1}, {0, 0, 2}, {2, 0, 0});
+
+    return cpugl::make_mesh(std::move(faces), utki::make_span(std::as_const(vertices)), utki::make_span(std::as_const(colors)));
+}
+
+const tst::set set("cluster", [](tst::suite& suite){
+    suite.add("make_clusters_covers_all_faces", [](){
+        auto m = make_box(10);
+
+        auto clusters = cpugl::make_clusters(m);
+
+        tst::check_gt(clusters.size(), size_t(1), SL);
+
+        auto face = m.faces.begin();
+        for(const auto& c : clusters){
+            tst::check_le(c.vertices.size(), cpugl::cluster::max_vertices, SL);
+            tst::check_le(c.faces.size(), cpugl::cluster::max_faces, SL);
+            tst::check(!c.bounds.empty(), SL);
+
+            for(const auto& f : c.faces){
+                tst::check(face != m.faces.end(), SL);
+                for(unsigned i = 0; i != f.size(); ++i){
+                    tst::check_eq(c.vertices[f[i]], (*face)[i], SL);
+                }
+                ++face;
+            }
+        }
+        tst::check(face == m.faces.end(), SL);
+    });
+
+    suite.add("flat_cluster_has_narrow_normal_cone", [](){
+        const std::vector<r4::vector3<cpugl::real>> vertices = {
+            {0, 0, 0},
+            {1, 0, 0},
+            {0, 1, 0},
+            {1, 1, 0},
+        };
+        auto m = cpugl::make_mesh({{0, 1, 2}, {1, 3, 2}}, utki::make_span(vertices));
+
+        auto clusters = cpugl::make_clusters(m);
+
+        tst::check_eq(clusters.size(), size_t(1), SL);
+        tst::check_eq(clusters.front().cone_axis, r4::vector3<cpugl::real>{0, 0, 1}, SL);
+        tst::check_lt(clusters.front().cone_cutoff, cpugl::real(0.001), SL);
+    });
+
+    suite.add("clustered_mesh_renders_same_as_non_clustered", [](){
+        auto m = make_box(10);
+
+        r4::matrix4<cpugl::real> matrix;
+        matrix.set_identity();
+        matrix.translate(50, 50, 50);
+        matrix.scale(30, 30, 30);
+        matrix.rotate(r4::quaternion<cpugl::real>(r4::vector3<cpugl::real>{0.3, 0.5, 0.1}));
+
+        std::array<cpugl::context::fb_image_type, 2> fbs = {
+            cpugl::context::fb_image_type(r4::vector2<uint32_t>{100, 100}),
+            cpugl::context::fb_image_type(r4::vector2<uint32_t>{100, 100})
+        };
+
+        for(auto& fb : fbs){
+            cpugl::context ctx;
+            ctx.set_framebuffer(fb);
+            ctx.clear({0, 0, 0, 0});
+
+            cpugl::pos_clr_shader().render(ctx, matrix, m);
+
+            m.clusters = cpugl::make_clusters(m);
+        }
+
+        tst::check(fbs[0].pixels().size() == fbs[1].pixels().size(), SL);
+        tst::check(std::equal(fbs[0].pixels().begin(), fbs[0].pixels().end(), fbs[1].pixels().begin()), SL);
+    });
+    suite.add("back_facing_clusters_skip_vertex_program", [](){
+        // with 7 x 7 quads each side has exactly cluster::max_vertices vertices, so each side becomes one cluster
+        auto m = make_box(7);
+
+        r4::matrix4<cpugl::real> matrix;
+        matrix.set_identity();
+        matrix.translate(50, 50, 0.5);
+        matrix.scale(30, 30, 0.25);
+        matrix.rotate(r4::quaternion<cpugl::real>(r4::vector3<cpugl::real>{0.3, 0.5, 0.1}));
+
+        std::array<unsigned, 2> num_vertex_invocations = {0, 0};
+
+        for(auto& n : num_vertex_invocations){
+            cpugl::context::fb_image_type fb(r4::vector2<uint32_t>{100, 100});
+            cpugl::context ctx;
+            ctx.set_framebuffer(fb);
+
+            cpugl::pipeline::render<false>(
+                ctx,
+                matrix,
+                [&n, &matrix](const r4::vector3<cpugl::real>& pos, const cpugl::color_type& color){
+                    ++n;
+                    return std::make_tuple(matrix * pos, color);
+                },
+                [](const cpugl::color_type& color){
+                    return color;
+                },
+                m.view()
+            );
+
+            m.clusters = cpugl::make_clusters(m);
+        }
+
+        tst::check_eq(m.clusters.size(), size_t(6), SL);
+
+        // the box is seen from one side, three sides facing away from the viewer are culled
+        tst::check_eq(num_vertex_invocations[0], unsigned(m.vertices.size()), SL);
+        tst::check_eq(num_vertex_invocations[1], unsigned(3 * cpugl::cluster::max_vertices), SL);
+    });
+});
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cpugl/pipeline.hpp>
+
+// helpers shared by the rendering tests
+namespace test_common{
+
+inline const auto identity = r4::matrix4<cpugl::real>().set_identity();
+
+// square covering [x1, x2) x [y1, y2) samples at depth z
+inline cpugl::mesh<> make_square(cpugl::real x1, cpugl::real y1, cpugl::real x2, cpugl::real y2, cpugl::real z){
+    const std::vector<r4::vector3<cpugl::real>> vertices = {
+        {x1, y1, z},
+        {x1, y2, z},
+        {x2, y2, z},
+        {x2, y1, z},
+    };
+    return cpugl::make_mesh({{0, 1, 2}, {0, 2, 3}}, utki::make_span(vertices));
+}
+
+// same as make_square(), with red, green, blue and white vertices
+inline cpugl::mesh<cpugl::color_type> make_color_square(cpugl::real x1, cpugl::real y1, cpugl::real x2, cpugl::real y2, cpugl::real z){
+    auto square = make_square(x1, y1, x2, y2, z);
+
+    std::vector<r4::vector3<cpugl::real>> vertices;
+    for(const auto& v : square.vertices){
+        vertices.push_back(std::get<0>(v));
+    }
+    const std::vector<cpugl::color_type> colors = {
+        {1, 0, 0, 1},
+        {0, 1, 0, 1},
+        {0, 0, 1, 1},
+        {1, 1, 1, 1},
+    };
+    return cpugl::make_mesh(std::move(square.faces), utki::make_span(vertices), utki::make_span(colors));
+}
+
+inline auto color_vertex_program = [](const r4::vector3<cpugl::real>& pos, const cpugl::color_type& color){
+    return std::make_tuple(identity * pos, color);
+};
+
+// framebuffer cleared to transparent black and, optionally, depth buffer cleared to 1
+struct fixture{
+    cpugl::context::fb_image_type fb;
+    cpugl::context::depth_image_type db;
+    cpugl::context ctx;
+
+    // fragment program invocations by render()
+    unsigned num_invocations = 0;
+
+    fixture(r4::vector2<uint32_t> dims, bool depth) :
+        fb(dims),
+        db(depth ? dims : r4::vector2<uint32_t>{0, 0})
+    {
+        ctx.set_framebuffer(fb);
+        ctx.clear({0, 0, 0, 0});
+        if(depth){
+            ctx.set_depth_buffer(db);
+            ctx.clear_depth(1);
+        }
+        ctx.reset_damage();
+    }
+
+    // render with depth test, the fragment program outputs the interpolated color
+    void render(const cpugl::mesh_view<cpugl::color_type>& m){
+        auto fragment_program = [this](const cpugl::color_type& color){
+            ++this->num_invocations;
+            return color;
+        };
+        cpugl::pipeline::render<true>(ctx, identity, color_vertex_program, fragment_program, m);
+    }
+};
+
+inline bool equal(const cpugl::context::fb_image_type& a, const cpugl::context::fb_image_type& b){
+    if(a.dims() != b.dims()){
+        return false;
+    }
+    for(uint32_t y = 0; y != a.dims().y(); ++y){
+        for(uint32_t x = 0; x != a.dims().x(); ++x){
+            if(a[y][x] != b[y][x]){
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// compares framebuffers and depth buffers
+inline bool equal(const fixture& a, const fixture& b){
+    if(!equal(a.fb, b.fb) || a.db.dims() != b.db.dims()){
+        return false;
+    }
+    for(uint32_t y = 0; y != a.db.dims().y(); ++y){
+        for(uint32_t x = 0; x != a.db.dims().x(); ++x){
+            if(a.db[y][x] != b.db[y][x]){
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,127 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <cpugl/compressed_image.hpp>
+
+namespace{
+using pixel_type = r4::vector4<uint8_t>;
+
+// dimensions are not multiple of the block size on purpose
+const r4::vector2<uint32_t> dims = {10, 7};
+
+// texel centers in texture coordinates
+r4::vector2<cpugl::real> texel_center(uint32_t x, uint32_t y){
+    return {
+        (cpugl::real(x) + cpugl::real(0.5)) / cpugl::real(dims.x()),
+        (cpugl::real(y) + cpugl::real(0.5)) / cpugl::real(dims.y())
+    };
+}
+
+// two colors representable exactly in RGB565, in a checkerboard pattern
+rasterimage::image<uint8_t, 4> make_two_color_image(uint8_t transparent_alpha){
+    rasterimage::image<uint8_t, 4> ret(dims);
+    for(uint32_t y = 0; y != dims.y(); ++y){
+        for(uint32_t x = 0; x != dims.x(); ++x){
+            ret[y][x] = (x + y) % 2 == 0 ? pixel_type{0xff, 0, 0xff, 0xff} : pixel_type{0, 0xff, 0, transparent_alpha};
+        }
+    }
+    return ret;
+}
+
+uint32_t max_difference(const pixel_type& a, const pixel_type& b){
+    uint32_t ret = 0;
+    for(unsigned i = 0; i != a.size(); ++i){
+        ret = std::max(ret, uint32_t(std::abs(int(a[i]) - int(b[i]))));
+    }
+    return ret;
+}
+}
+
+namespace{
+const tst::set set("compressed_image", [](tst::suite& suite){
+    suite.add("bc1_keeps_exactly_representable_colors", [](){
+        auto image = make_two_color_image(0xff);
+        auto compressed = cpugl::compress_bc1(image);
+
+        // 3x2 blocks of 8 bytes
+        tst::check_eq(compressed.get_data().size(), size_t(3 * 2 * 8), SL);
+
+        auto tex = cpugl::make_texture(compressed);
+        for(uint32_t y = 0; y != dims.y(); ++y){
+            for(uint32_t x = 0; x != dims.x(); ++x){
+                tst::check(tex.get(texel_center(x, y)) == image[y][x], [&](auto& o){o << "x = " << x << ", y = " << y;}, SL);
+            }
+        }
+    });
+
+    suite.add("bc1_encodes_transparent_texels", [](){
+        auto image = make_two_color_image(0);
+        auto tex_image = cpugl::compress_bc1(image);
+        auto tex = cpugl::make_texture(tex_image);
+        for(uint32_t y = 0; y != dims.y(); ++y){
+            for(uint32_t x = 0; x != dims.x(); ++x){
+                auto expected = image[y][x].w() == 0 ? pixel_type{0, 0, 0, 0} : image[y][x];
+                tst::check(tex.get(texel_center(x, y)) == expected, [&](auto& o){o << "x = " << x << ", y = " << y;}, SL);
+            }
+        }
+    });
+
+    suite.add("bc3_approximates_gradients", [](){
+        // colors of each block lie on a line in color space, as the endpoints interpolation assumes
+        rasterimage::image<uint8_t, 4> image(dims);
+        for(uint32_t y = 0; y != dims.y(); ++y){
+            for(uint32_t x = 0; x != dims.x(); ++x){
+                auto t = x + y;
+                image[y][x] = {uint8_t(t * 8), uint8_t(t * 12), 0x80, uint8_t(0xff - t * 10)};
+            }
+        }
+
+        auto compressed = cpugl::compress_bc3(image);
+        tst::check_eq(compressed.get_data().size(), size_t(3 * 2 * 16), SL);
+
+        auto tex = cpugl::make_texture(compressed);
+
+        // sample in scattered order, so that blocks are evicted from the cache and decoded again
+        for(uint32_t i = 0; i != dims.x() * dims.y(); ++i){
+            auto x = (i * 7) % dims.x();
+            auto y = (i * 3) % dims.y();
+            auto d = max_difference(tex.get(texel_center(x, y)), image[y][x]);
+            tst::check_le(d, 20u, [&](auto& o){o << "x = " << x << ", y = " << y << ", d = " << d;}, SL);
+        }
+    });
+
+    suite.add("palette_image_is_lossless", [](){
+        rasterimage::image<uint8_t, 4> image(dims);
+        for(uint32_t y = 0; y != dims.y(); ++y){
+            for(uint32_t x = 0; x != dims.x(); ++x){
+                image[y][x] = {uint8_t(x * 25), uint8_t(y * 36), uint8_t(x ^ y), uint8_t(x + y)};
+            }
+        }
+
+        auto palettized = cpugl::make_palette_image(image);
+        auto tex = cpugl::make_texture(palettized);
+        for(uint32_t y = 0; y != dims.y(); ++y){
+            for(uint32_t x = 0; x != dims.x(); ++x){
+                tst::check(tex.get(texel_center(x, y)) == image[y][x], [&](auto& o){o << "x = " << x << ", y = " << y;}, SL);
+            }
+        }
+    });
+
+    suite.add("palette_image_throws_on_too_many_colors", [](){
+        rasterimage::image<uint8_t, 4> image(r4::vector2<uint32_t>{32, 32});
+        for(uint32_t y = 0; y != 32; ++y){
+            for(uint32_t x = 0; x != 32; ++x){
+                image[y][x] = {uint8_t(x), uint8_t(y), 0, 0xff};
+            }
+        }
+
+        bool thrown = false;
+        try{
+            cpugl::make_palette_image(image);
+        }catch(std::invalid_argument&){
+            thrown = true;
+        }
+        tst::check(thrown, SL);
+    });
+});
+}
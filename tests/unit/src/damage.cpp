@@ -0,0 +1,73 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <cpugl/shaders/color_pos_shader.hpp>
+
+namespace{
+const std::vector<r4::vector3<cpugl::real>> vertices = {
+    {10, 10, 0},
+    {10, 30, 0},
+    {30, 30, 0},
+};
+
+const tst::set set("damage", [](tst::suite& suite){
+    suite.add("rendering_accumulates_damage", [](){
+        cpugl::context::fb_image_type fb(r4::vector2<uint32_t>{100, 100});
+        cpugl::context ctx;
+        ctx.set_framebuffer(fb);
+
+        tst::check(cpugl::is_empty(ctx.get_damage()), SL);
+
+        auto m = cpugl::make_mesh({{0, 1, 2}}, utki::make_span(vertices));
+
+        r4::matrix4<cpugl::real> matrix;
+        matrix.set_identity();
+
+        cpugl::color_pos_shader shader;
+        shader.render(ctx, matrix, {1, 1, 1, 1}, m);
+
+        const auto& damage = ctx.get_damage();
+        tst::check(!cpugl::is_empty(damage), SL);
+        tst::check_le(damage.p.x(), uint32_t(10), SL);
+        tst::check_le(damage.p.y(), uint32_t(10), SL);
+        tst::check_ge(damage.p.x() + damage.d.x(), uint32_t(30), SL);
+        tst::check_ge(damage.p.y() + damage.d.y(), uint32_t(30), SL);
+        tst::check_le(damage.p.x() + damage.d.x(), uint32_t(31), SL);
+        tst::check_le(damage.p.y() + damage.d.y(), uint32_t(31), SL);
+
+        ctx.reset_damage();
+        tst::check(cpugl::is_empty(ctx.get_damage()), SL);
+    });
+
+    suite.add("redraw_region_limits_rendering", [](){
+        cpugl::context::fb_image_type fb(r4::vector2<uint32_t>{100, 100});
+        cpugl::context ctx;
+        ctx.set_framebuffer(fb);
+
+        constexpr auto bg_color = cpugl::context::fb_image_type::pixel_type{0, 0, 0, 0xff};
+        ctx.clear(bg_color);
+        ctx.reset_damage();
+
+        ctx.set_redraw_region({{0, 0}, {20, 100}});
+
+        auto m = cpugl::make_mesh({{0, 1, 2}}, utki::make_span(vertices));
+
+        r4::matrix4<cpugl::real> matrix;
+        matrix.set_identity();
+
+        cpugl::color_pos_shader shader;
+        shader.render(ctx, matrix, {1, 1, 1, 1}, m);
+
+        tst::check_le(ctx.get_damage().p.x() + ctx.get_damage().d.x(), uint32_t(20), SL);
+
+        for(uint32_t y = 0; y != fb.dims().y(); ++y){
+            for(uint32_t x = 20; x != fb.dims().x(); ++x){
+                tst::check(fb[y][x] == bg_color, [&](auto& o){o << "x = " << x << ", y = " << y;}, SL);
+            }
+        }
+
+        // something was drawn inside of the redraw region
+        tst::check(fb[25][15] != bg_color, SL);
+    });
+});
+}
@@ -0,0 +1,207 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <cpugl/pipeline.hpp>
+#include <cpugl/shaders/color_pos_shader.hpp>
+
+#include "common.hpp"
+
+namespace{
+using test_common::make_square;
+using test_common::identity;
+
+constexpr auto red = r4::vector4<uint8_t>{0xff, 0, 0, 0xff};
+constexpr auto green = r4::vector4<uint8_t>{0, 0xff, 0, 0xff};
+
+struct fixture : test_common::fixture{
+    fixture() :
+        test_common::fixture({32, 32}, true)
+    {}
+};
+}
+
+namespace{
+const tst::set set("depth", [](tst::suite& suite){
+    suite.add("nearer_triangles_win_regardless_of_order", [](){
+        for(bool near_first : {true, false}){
+            fixture f;
+
+            auto near_square = make_square(0, 0, 32, 32, 0.25);
+            auto far_square = make_square(0, 0, 32, 32, 0.5);
+
+            if(near_first){
+                cpugl::color_pos_shader().render(f.ctx, identity, {1, 0, 0, 1}, near_square);
+                cpugl::color_pos_shader().render(f.ctx, identity, {0, 1, 0, 1}, far_square);
+            }else{
+                cpugl::color_pos_shader().render(f.ctx, identity, {0, 1, 0, 1}, far_square);
+                cpugl::color_pos_shader().render(f.ctx, identity, {1, 0, 0, 1}, near_square);
+            }
+
+            tst::check(f.fb[10][20] == red, SL);
+            tst::check_eq(f.db[10][20][0], 0.25f, SL);
+        }
+    });
+
+    suite.add("occluded_triangles_are_rejected_before_rasterization", [](){
+        fixture f;
+
+        cpugl::color_pos_shader().render(f.ctx, identity, {1, 0, 0, 1}, make_square(0, 0, 32, 32, 0.25));
+
+        f.ctx.reset_damage();
+
+        // make the bounds cross the z = 0 plane, so that the mesh is not culled as a whole by the occlusion query
+        auto square = make_square(3, 5, 20, 17, 0.5);
+        square.bounds.min.z() = -1;
+
+        cpugl::color_pos_shader().render(f.ctx, identity, {0, 1, 0, 1}, square);
+
+        tst::check(cpugl::is_empty(f.ctx.get_damage()), SL);
+        tst::check(f.fb[10][10] == red, SL);
+    });
+
+    suite.add("partially_visible_triangle_is_drawn_only_where_nearer", [](){
+        fixture f;
+
+        // near square covers left half
+        cpugl::color_pos_shader().render(f.ctx, identity, {1, 0, 0, 1}, make_square(0, 0, 16, 32, 0.25));
+        cpugl::color_pos_shader().render(f.ctx, identity, {0, 1, 0, 1}, make_square(0, 0, 32, 32, 0.5));
+
+        for(uint32_t y = 0; y != 32; ++y){
+            for(uint32_t x = 0; x != 32; ++x){
+                tst::check(f.fb[y][x] == (x < 16 ? red : green), [&](auto& o){o << "x = " << x << ", y = " << y;}, SL);
+            }
+        }
+    });
+
+    suite.add("hi_z_tiles_are_updated_by_rasterization", [](){
+        fixture f;
+
+        cpugl::color_pos_shader().render(f.ctx, identity, {1, 0, 0, 1}, make_square(0, 0, 32, 32, 0.25));
+
+        const auto& hi_z = f.ctx.get_hi_z();
+        for(uint32_t y = 0; y != hi_z.get_dims().y(); ++y){
+            for(uint32_t x = 0; x != hi_z.get_dims().x(); ++x){
+                tst::check_eq(hi_z.get({x, y}).max_depth, 0.25f, SL);
+            }
+        }
+    });
+
+    suite.add("bounding_volume_occlusion_query", [](){
+        fixture f;
+
+        cpugl::color_pos_shader().render(f.ctx, identity, {1, 0, 0, 1}, make_square(0, 0, 16, 32, 0.25));
+
+        auto behind = make_square(2, 2, 10, 10, 0.5);
+        auto in_front = make_square(2, 2, 10, 10, 0.1);
+        auto not_covered = make_square(12, 2, 20, 10, 0.5);
+
+        tst::check(cpugl::pipeline::is_occluded(f.ctx, identity, behind.bounds), SL);
+        tst::check(!cpugl::pipeline::is_occluded(f.ctx, identity, in_front.bounds), SL);
+        tst::check(!cpugl::pipeline::is_occluded(f.ctx, identity, not_covered.bounds), SL);
+    });
+    // Hidden fragments do not pass the depth test, but still update the stencil with the depth fail operation,
+    // so hierarchical depth rejection must not skip them.
+    suite.add("hidden_fragments_update_stencil", [](){
+        for(bool quad : {false, true}){
+            fixture f;
+
+            cpugl::context::stencil_image_type sb(r4::vector2<uint32_t>{32, 32});
+            f.ctx.set_stencil_buffer(sb);
+            f.ctx.clear_stencil(0);
+
+            cpugl::color_pos_shader().render(f.ctx, identity, {1, 0, 0, 1}, make_square(0, 0, 32, 32, 0.25));
+
+            f.ctx.set_stencil_state({
+                .enabled = true,
+                .pass = cpugl::stencil_operation::zero,
+                .depth_fail = cpugl::stencil_operation::increment
+            });
+
+            auto hidden = make_square(0, 0, 32, 32, 0.5);
+            if(quad){
+                hidden.faces.clear();
+                hidden.quads = {{0, 1, 2, 3}};
+            }
+
+            cpugl::color_pos_shader().render(f.ctx, identity, {0, 1, 0, 1}, hidden);
+
+            for(uint32_t y = 0; y != 32; ++y){
+                for(uint32_t x = 0; x != 32; ++x){
+                    tst::check_eq(sb[y][x][0], uint8_t(1), [&](auto& o){o << "x = " << x << ", y = " << y;}, SL);
+                    tst::check(f.fb[y][x] == red, SL);
+                    tst::check_eq(f.db[y][x][0], 0.25f, SL);
+                }
+            }
+        }
+    });
+
+    // fragments which pass the depth test apply the pass operation, others apply the depth fail operation
+    suite.add("stencil_operation_depends_on_depth_test", [](){
+        for(bool quad : {false, true}){
+            fixture f;
+
+            cpugl::context::stencil_image_type sb(r4::vector2<uint32_t>{32, 32});
+            f.ctx.set_stencil_buffer(sb);
+            f.ctx.clear_stencil(0);
+
+            // left half is near, right half is far
+            cpugl::color_pos_shader().render(f.ctx, identity, {1, 0, 0, 1}, make_square(0, 0, 16, 32, 0.25));
+            cpugl::color_pos_shader().render(f.ctx, identity, {1, 0, 0, 1}, make_square(16, 0, 32, 32, 0.75));
+
+            f.ctx.set_stencil_state({
+                .enabled = true,
+                .pass = cpugl::stencil_operation::increment
+            });
+
+            auto make_covering_square = [quad](cpugl::real z){
+                auto square = make_square(0, 0, 32, 32, z);
+                if(quad){
+                    square.faces.clear();
+                    square.quads = {{0, 1, 2, 3}};
+                }
+                return square;
+            };
+
+            // depth fail operation is keep by default
+            cpugl::color_pos_shader().render(f.ctx, identity, {0, 1, 0, 1}, make_covering_square(0.5));
+            tst::check_eq(sb[0][0][0], uint8_t(0), SL);
+            tst::check_eq(sb[0][16][0], uint8_t(1), SL);
+
+            f.ctx.set_stencil_state({
+                .enabled = true,
+                .reference = 7,
+                .pass = cpugl::stencil_operation::increment,
+                .depth_fail = cpugl::stencil_operation::replace
+            });
+
+            cpugl::color_pos_shader().render(f.ctx, identity, {0, 1, 0, 1}, make_covering_square(0.4));
+
+            for(uint32_t y = 0; y != 32; ++y){
+                for(uint32_t x = 0; x != 32; ++x){
+                    tst::check_eq(sb[y][x][0], uint8_t(x < 16 ? 7 : 2), [&](auto& o){o << "x = " << x << ", y = " << y;}, SL);
+                    tst::check(f.fb[y][x] == (x < 16 ? red : green), SL);
+                }
+            }
+        }
+    });
+
+    suite.add("lines_and_points_of_occluded_mesh_are_drawn", [](){
+        fixture f;
+
+        cpugl::color_pos_shader().render(f.ctx, identity, {1, 0, 0, 1}, make_square(0, 0, 32, 32, 0.25));
+
+        auto hidden = make_square(2, 2, 30, 30, 0.5);
+        hidden.lines = {{0, 3}};
+        hidden.points = {2};
+
+        tst::check(cpugl::pipeline::is_occluded(f.ctx, identity, hidden.bounds), SL);
+
+        cpugl::color_pos_shader().render(f.ctx, identity, {0, 1, 0, 1}, hidden);
+
+        // the line goes from (2, 2) to (30, 2), the point is at (30, 30)
+        tst::check(f.fb[2][10] == green, SL);
+        tst::check(f.fb[30][30] == green, SL);
+        tst::check(f.fb[10][10] == red, SL);
+    });
+});
+}
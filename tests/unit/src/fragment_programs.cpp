@@ -0,0 +1,183 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <cpugl/pipeline.hpp>
+#include <cpugl/shaders/pos_clr_shader.hpp>
+#include <cpugl/shaders/color_pos_shader.hpp>
+
+#include "common.hpp"
+
+namespace{
+const std::vector<r4::vector3<cpugl::real>> vertices = {
+    {3.3, 2.7, 0},
+    {5.1, 91.4, 0},
+    {97.8, 60.2, 0},
+    {80.5, 4.9, 0},
+};
+
+// flat color fragment program which counts its invocations
+struct counting_flat_color_fragment_program{
+    constexpr static bool constant_output = true;
+
+    unsigned& num_invocations;
+
+    const cpugl::color_type& operator()(const cpugl::color_type& color) const noexcept{
+        ++this->num_invocations;
+        return color;
+    }
+};
+}
+
+namespace{
+const tst::set set("fragment_programs", [](tst::suite& suite){
+    suite.add("traits", [](){
+        tst::check(cpugl::fragment_program_traits<cpugl::constant_color_fragment_program>::constant_output, SL);
+        tst::check(!cpugl::fragment_program_traits<cpugl::constant_color_fragment_program>::uses_attributes, SL);
+
+        tst::check(cpugl::fragment_program_traits<cpugl::flat_color_fragment_program>::constant_output, SL);
+        tst::check(cpugl::fragment_program_traits<cpugl::flat_color_fragment_program>::uses_attributes, SL);
+
+        auto lambda = [](const cpugl::color_type& c){return c;};
+        tst::check(!cpugl::fragment_program_traits<decltype(lambda)>::constant_output, SL);
+        tst::check(cpugl::fragment_program_traits<decltype(lambda)>::uses_attributes, SL);
+    });
+
+    suite.add("constant_output_path_matches_generic_path", [](){
+        auto m = cpugl::make_mesh({{0, 1, 3}, {3, 1, 2}}, utki::make_span(vertices));
+
+        r4::matrix4<cpugl::real> matrix;
+        matrix.set_identity();
+
+        constexpr auto bg_color = cpugl::context::fb_span_type::pixel_type{0, 0, 0, 0};
+        const cpugl::color_type color{0.2, 0.4, 0.6, 1};
+
+        cpugl::context::fb_image_type fast_fb(r4::vector2<uint32_t>{100, 100}, bg_color);
+        cpugl::context::fb_image_type generic_fb(r4::vector2<uint32_t>{100, 100}, bg_color);
+
+        cpugl::context ctx;
+
+        ctx.set_framebuffer(fast_fb);
+        cpugl::color_pos_shader().render(ctx, matrix, color, m);
+
+        ctx.set_framebuffer(generic_fb);
+        cpugl::pipeline::render<false>(
+            ctx,
+            matrix,
+            [&matrix](const r4::vector3<cpugl::real>& pos) {
+                return std::make_tuple(matrix * pos);
+            },
+            [&color]() {
+                return color;
+            },
+            m
+        );
+
+        for(uint32_t y = 0; y != fast_fb.dims().y(); ++y){
+            for(uint32_t x = 0; x != fast_fb.dims().x(); ++x){
+                tst::check(fast_fb[y][x] == generic_fb[y][x], [&](auto& o){o << "x = " << x << ", y = " << y;}, SL);
+            }
+        }
+    });
+
+    // the first vertex's color is used for all pixels of a primitive, whichever rasterization path draws it
+    suite.add("constant_output_is_same_in_all_paths", [](){
+        constexpr uint32_t size = 32;
+
+        // both triangles start with the red vertex
+        auto triangles = test_common::make_color_square(2, 2, 30, 30, 0.5);
+        auto quad = triangles;
+        quad.faces.clear();
+        quad.quads = {{0, 1, 2, 3}};
+
+        auto render = [&](const cpugl::mesh<cpugl::color_type>& m, bool depth, unsigned num_primitives){
+            test_common::fixture f({size, size}, depth);
+            unsigned num_invocations = 0;
+            counting_flat_color_fragment_program fragment_program{num_invocations};
+            if(depth){
+                cpugl::pipeline::render<true>(f.ctx, test_common::identity, test_common::color_vertex_program, fragment_program, m);
+            }else{
+                cpugl::pipeline::render<false>(f.ctx, test_common::identity, test_common::color_vertex_program, fragment_program, m);
+            }
+            tst::check_eq(num_invocations, num_primitives, SL);
+            return std::move(f.fb);
+        };
+
+        cpugl::context::fb_image_type expected(r4::vector2<uint32_t>{size, size}, {0, 0, 0, 0});
+        for(uint32_t y = 2; y != 30; ++y){
+            for(uint32_t x = 2; x != 30; ++x){
+                expected[y][x] = {0xff, 0, 0, 0xff};
+            }
+        }
+
+        tst::check(test_common::equal(render(triangles, false, 2), expected), SL);
+        tst::check(test_common::equal(render(triangles, true, 2), expected), SL);
+        tst::check(test_common::equal(render(quad, false, 1), expected), SL);
+        tst::check(test_common::equal(render(quad, true, 1), expected), SL);
+
+        {
+            test_common::fixture f({size, size}, true);
+            cpugl::visibility_buffer vb;
+            vb.resize(f.fb.dims());
+
+            unsigned num_invocations = 0;
+            counting_flat_color_fragment_program fragment_program{num_invocations};
+            cpugl::pipeline::render_visibility(f.ctx, vb, test_common::identity, test_common::color_vertex_program, fragment_program, triangles);
+            vb.resolve(f.ctx);
+
+            tst::check_eq(num_invocations, 2u, SL);
+            tst::check(test_common::equal(f.fb, expected), SL);
+        }
+    });
+
+    suite.add("gouraud_fixed_point_path_matches_generic_path", [](){
+        const std::vector<cpugl::color_type> colors = {
+            {1, 0, 0, 1},
+            {0, 1, 0, 0.5},
+            {0, 0, 1, 0},
+            {0.3, 0.6, 0.9, 1},
+        };
+
+        auto m = cpugl::make_mesh({{0, 1, 3}, {3, 1, 2}}, utki::make_span(vertices), utki::make_span(colors));
+
+        r4::matrix4<cpugl::real> matrix;
+        matrix.set_identity();
+
+        constexpr auto bg_color = cpugl::context::fb_span_type::pixel_type{0, 0, 0, 0};
+
+        cpugl::context::fb_image_type fast_fb(r4::vector2<uint32_t>{100, 100}, bg_color);
+        cpugl::context::fb_image_type generic_fb(r4::vector2<uint32_t>{100, 100}, bg_color);
+
+        cpugl::context ctx;
+
+        ctx.set_framebuffer(fast_fb);
+        cpugl::pos_clr_shader().render(ctx, matrix, m);
+
+        ctx.set_framebuffer(generic_fb);
+        cpugl::pipeline::render<false>(
+            ctx,
+            matrix,
+            [&matrix](const r4::vector3<cpugl::real>& pos, const cpugl::color_type& clr) {
+                return std::make_tuple(matrix * pos, clr);
+            },
+            [](const cpugl::color_type& clr) {
+                return clr;
+            },
+            m
+        );
+
+        for(uint32_t y = 0; y != fast_fb.dims().y(); ++y){
+            for(uint32_t x = 0; x != fast_fb.dims().x(); ++x){
+                auto f = fast_fb[y][x].to<int>();
+                auto g = generic_fb[y][x].to<int>();
+
+                // same coverage
+                tst::check_eq(f == bg_color.to<int>(), g == bg_color.to<int>(), SL);
+
+                for(unsigned i = 0; i != 4; ++i){
+                    tst::check_le(std::abs(f[i] - g[i]), 1, [&](auto& o){o << "x = " << x << ", y = " << y;}, SL);
+                }
+            }
+        }
+    });
+});
+}
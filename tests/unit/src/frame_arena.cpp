@@ -0,0 +1,158 @@
+#include <thread>
+
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <cpugl/frame_arena.hpp>
+#include <cpugl/pipeline.hpp>
+#include <cpugl/shaders/pos_clr_shader.hpp>
+
+namespace{
+const tst::set set("frame_arena", [](tst::suite& suite){
+    suite.add("allocations_are_aligned_and_do_not_overlap", [](){
+        cpugl::frame_arena arena(256);
+
+        std::vector<std::pair<uintptr_t, size_t>> blocks;
+        for(size_t i = 0; i != 100; ++i){
+            size_t size = (i * 7) % 50 + 1;
+            size_t alignment = size_t(1) << (i % 7);
+            auto p = reinterpret_cast<uintptr_t>(arena.allocate(size, alignment));
+            tst::check_eq(p % alignment, uintptr_t(0), SL);
+            blocks.emplace_back(p, size);
+        }
+
+        // bigger than chunk size
+        auto big = reinterpret_cast<uintptr_t>(arena.allocate(1000, 8));
+        blocks.emplace_back(big, 1000);
+
+        std::sort(blocks.begin(), blocks.end());
+        for(size_t i = 1; i < blocks.size(); ++i){
+            tst::check_le(blocks[i - 1].first + blocks[i - 1].second, blocks[i].first, SL);
+        }
+    });
+
+    suite.add("reset_reuses_chunks", [](){
+        cpugl::frame_arena arena(1024);
+
+        auto frame = [&arena](){
+            for(size_t i = 0; i != 10; ++i){
+                cpugl::frame_arena::vector<int> v(arena);
+                v.resize(100);
+            }
+            arena.reset();
+        };
+
+        frame();
+        auto capacity = arena.get_capacity();
+        tst::check_ne(capacity, size_t(0), SL);
+
+        for(unsigned i = 0; i != 10; ++i){
+            frame();
+        }
+        tst::check_eq(arena.get_capacity(), capacity, SL);
+    });
+
+    suite.add("threads_allocate_from_own_chunks", [](){
+        cpugl::frame_arena arena(4096);
+
+        constexpr size_t num_threads = 4;
+        constexpr size_t num_allocations = 1000;
+        std::vector<std::vector<uint32_t*>> pointers(num_threads);
+
+        std::vector<std::thread> threads;
+        for(size_t t = 0; t != num_threads; ++t){
+            threads.emplace_back([&arena, &p = pointers[t], t](){
+                for(size_t i = 0; i != num_allocations; ++i){
+                    auto ptr = static_cast<uint32_t*>(arena.allocate(sizeof(uint32_t), alignof(uint32_t)));
+                    *ptr = uint32_t(t * num_allocations + i);
+                    p.push_back(ptr);
+                }
+            });
+        }
+        for(auto& th : threads){
+            th.join();
+        }
+
+        for(size_t t = 0; t != num_threads; ++t){
+            for(size_t i = 0; i != num_allocations; ++i){
+                tst::check_eq(*pointers[t][i], uint32_t(t * num_allocations + i), SL);
+            }
+        }
+    });
+
+    suite.add("steady_state_rendering_does_not_grow_arena", [](){
+        const std::vector<r4::vector3<cpugl::real>> pos = {
+            {-10, 5, 0.5},
+            {10, 30, -0.5},
+            {30, 5, 0.5},
+        };
+        const std::vector<cpugl::color_type> colors = {
+            {1, 0, 0, 1},
+            {0, 1, 0, 1},
+            {0, 0, 1, 1},
+        };
+        auto m = cpugl::make_mesh({{0, 1, 2}}, utki::make_span(pos), utki::make_span(colors));
+
+        cpugl::context::fb_image_type fb(r4::vector2<uint32_t>{20, 20});
+        cpugl::context ctx;
+        ctx.set_framebuffer(fb);
+
+        auto frame = [&](){
+            ctx.begin_frame();
+            ctx.clear({0, 0, 0, 0});
+            cpugl::pos_clr_shader().render(ctx, r4::matrix4<cpugl::real>().set_identity(), m);
+            ctx.end_frame();
+        };
+
+        frame();
+        auto capacity = ctx.get_frame_arena().get_capacity();
+
+        for(unsigned i = 0; i != 10; ++i){
+            frame();
+        }
+        tst::check_eq(ctx.get_frame_arena().get_capacity(), capacity, SL);
+    });
+
+    // without begin_frame() transient memory of draw calls is released by the draw calls
+    suite.add("rendering_outside_of_frame_does_not_use_arena", [](){
+        const std::vector<r4::vector3<cpugl::real>> pos = {
+            {-10, 5, 0.5},
+            {10, 30, 0.5},
+            {30, 5, 0.5},
+        };
+        const std::vector<cpugl::color_type> colors = {
+            {1, 0, 0, 1},
+            {0, 1, 0, 1},
+            {0, 0, 1, 1},
+        };
+        auto m = cpugl::make_mesh({{0, 1, 2}}, utki::make_span(pos), utki::make_span(colors));
+
+        cpugl::context::fb_image_type fb(r4::vector2<uint32_t>{20, 20});
+        cpugl::context::depth_image_type db(r4::vector2<uint32_t>{20, 20});
+        cpugl::context ctx;
+        ctx.set_framebuffer(fb);
+        ctx.set_depth_buffer(db);
+        ctx.clear_depth(1);
+
+        tst::check(!ctx.is_in_frame(), SL);
+
+        auto vertex_program = [](const r4::vector3<cpugl::real>& p, const cpugl::color_type& c){
+            return std::make_tuple(r4::matrix4<cpugl::real>().set_identity() * p, c);
+        };
+        auto fragment_program = [](const cpugl::color_type& c){
+            return c;
+        };
+
+        cpugl::visibility_buffer vb;
+        vb.resize(fb.dims());
+
+        for(unsigned i = 0; i != 10; ++i){
+            cpugl::pos_clr_shader().render(ctx, r4::matrix4<cpugl::real>().set_identity(), m);
+            cpugl::pipeline::render_visibility(ctx, vb, r4::matrix4<cpugl::real>().set_identity(), vertex_program, fragment_program, m);
+        }
+        vb.resolve(ctx);
+
+        tst::check_eq(ctx.get_frame_arena().get_capacity(), size_t(0), SL);
+    });
+});
+}
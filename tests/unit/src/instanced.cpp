@@ -0,0 +1,129 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <cpugl/pipeline.hpp>
+#include <cpugl/shaders/color_pos_shader.hpp>
+#include <cpugl/shaders/texture_pos_tex_shader.hpp>
+
+#include "common.hpp"
+
+namespace{
+using test_common::make_square;
+using test_common::identity;
+
+cpugl::instance make_instance(cpugl::real x, cpugl::real y, cpugl::real z, const cpugl::color_type& color){
+    cpugl::instance inst;
+    inst.matrix.set_identity();
+    inst.matrix.translate(x, y, z);
+    inst.color = color;
+    return inst;
+}
+}
+
+namespace{
+const tst::set set("instanced", [](tst::suite& suite){
+    suite.add("instances_match_separate_renders", [](){
+        auto square = make_square(0, 0, 10, 10, 0.5);
+
+        // the last instance overlaps the first one and is nearer
+        const std::vector<cpugl::instance> instances = {
+            make_instance(2, 2, 0, {1, 0, 0, 1}),
+            make_instance(20, 4, 0, {0, 1, 0, 1}),
+            make_instance(7, 9, -0.25, {0, 0, 1, 1}),
+        };
+
+        test_common::fixture instanced({32, 32}, true);
+        cpugl::color_pos_shader().render_instanced(instanced.ctx, square, utki::make_span(instances));
+
+        test_common::fixture separate({32, 32}, true);
+        for(const auto& inst : instances){
+            cpugl::color_pos_shader().render(separate.ctx, inst.matrix, inst.color, square);
+        }
+
+        tst::check(test_common::equal(instanced, separate), SL);
+        tst::check(instanced.ctx.get_damage() == separate.ctx.get_damage(), SL);
+    });
+
+    suite.add("shifted_tex_coords_are_clamped_to_texture_edges", [](){
+        constexpr auto red = r4::vector4<uint8_t>{0xff, 0, 0, 0xff};
+        constexpr auto green = r4::vector4<uint8_t>{0, 0xff, 0, 0xff};
+
+        // left texel is red, right texel is green
+        rasterimage::image<uint8_t, 4> image(r4::vector2<uint32_t>{2, 1});
+        image[0][0] = red;
+        image[0][1] = green;
+        rasterimage::image_variant tex;
+        tex.variant = image;
+
+        // texture coordinates go from 0 to 1 across the square
+        const std::vector<r4::vector3<cpugl::real>> vertices = {{0, 0, 0}, {0, 8, 0}, {8, 8, 0}, {8, 0, 0}};
+        const std::vector<cpugl::tex_coord_type> tex_coords = {{0, 0}, {0, 1}, {1, 1}, {1, 0}};
+        auto square = cpugl::make_mesh({{0, 1, 2}, {0, 2, 3}}, utki::make_span(vertices), utki::make_span(tex_coords));
+
+        auto render = [&](const cpugl::tex_coord_type& offset){
+            auto inst = make_instance(0, 0, 0, {1, 1, 1, 1});
+            inst.tex_coord_offset = offset;
+
+            test_common::fixture f({8, 8}, false);
+            cpugl::texture_pos_tex_shader().render_instanced(f.ctx, tex, square, utki::make_span(&inst, 1));
+            return std::move(f.fb);
+        };
+
+        auto not_shifted = render({0, 0});
+        tst::check(not_shifted[4][1] == red, SL);
+        tst::check(not_shifted[4][6] == green, SL);
+
+        // right half of the square samples beyond the texture's right edge
+        auto shifted_right = render({0.5, 0});
+        for(uint32_t x = 0; x != 8; ++x){
+            tst::check(shifted_right[4][x] == green, [&](auto& o){o << "x = " << x;}, SL);
+        }
+
+        auto shifted_left = render({-1, -1});
+        for(uint32_t x = 0; x != 8; ++x){
+            tst::check(shifted_left[4][x] == red, [&](auto& o){o << "x = " << x;}, SL);
+        }
+    });
+
+    suite.add("occluded_instances_are_skipped", [](){
+        auto occluder = make_square(0, 0, 16, 32, 0.25);
+        auto square = make_square(0, 0, 8, 8, 0.5);
+
+        // the first instance is behind the occluder
+        const std::vector<cpugl::instance> instances = {
+            make_instance(2, 2, 0, {1, 0, 0, 1}),
+            make_instance(20, 2, 0, {0, 1, 0, 1}),
+        };
+
+        unsigned num_vertex_invocations = 0;
+        auto vertex_program = [&num_vertex_invocations](const cpugl::instance& inst, const r4::vector3<cpugl::real>& pos){
+            ++num_vertex_invocations;
+            return std::make_tuple(inst.matrix * pos, inst.color);
+        };
+        auto fragment_program = [](const cpugl::color_type& color){
+            return color;
+        };
+
+        test_common::fixture instanced({32, 32}, true);
+        cpugl::color_pos_shader().render(instanced.ctx, identity, {1, 1, 1, 1}, occluder);
+        cpugl::pipeline::render_instanced<true>(
+            instanced.ctx,
+            vertex_program,
+            fragment_program,
+            square.view(),
+            utki::make_span(instances)
+        );
+
+        // vertices of the occluded instance are not processed
+        tst::check_eq(num_vertex_invocations, unsigned(square.vertices.size()), SL);
+
+        test_common::fixture separate({32, 32}, true);
+        cpugl::color_pos_shader().render(separate.ctx, identity, {1, 1, 1, 1}, occluder);
+        for(const auto& inst : instances){
+            cpugl::color_pos_shader().render(separate.ctx, inst.matrix, inst.color, square);
+        }
+
+        tst::check(test_common::equal(instanced, separate), SL);
+    });
+});
+}
@@ -0,0 +1,105 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <cpugl/blend.hpp>
+#include <cpugl/context.hpp>
+
+namespace{
+std::vector<cpugl::isa> get_supported_isas(){
+    std::vector<cpugl::isa> ret;
+    for(size_t i = 0; i != size_t(cpugl::isa::enum_size); ++i){
+        if(cpugl::is_supported(cpugl::isa(i))){
+            ret.push_back(cpugl::isa(i));
+        }
+    }
+    return ret;
+}
+
+const tst::set set("kernels", [](tst::suite& suite){
+    suite.add("generic_is_always_supported", [](){
+        tst::check(cpugl::is_supported(cpugl::isa::generic), SL);
+        tst::check(cpugl::is_supported(cpugl::get_default_isa()), SL);
+    });
+
+    suite.add<cpugl::isa>(
+        "fill_and_swap_red_blue",
+        get_supported_isas(),
+        [](const auto& isa){
+            const auto& ks = cpugl::get_kernel_set(isa);
+            tst::check(ks.instruction_set == isa, SL);
+
+            // odd number of pixels to test loop remainders of vectorized code
+            constexpr auto num_pixels = 67;
+            constexpr auto offset = 3;
+
+            std::vector<uint8_t> pixels((num_pixels + offset * 2) * 4, 0);
+
+            const std::array<uint8_t, 4> value = {1, 2, 3, 4};
+
+            ks.fill(pixels.data() + offset * 4, num_pixels, value.data());
+            ks.swap_red_blue(pixels.data() + offset * 4, num_pixels);
+
+            for(size_t i = 0; i != num_pixels + offset * 2; ++i){
+                bool inside = i >= offset && i < num_pixels + offset;
+                auto p = pixels.data() + i * 4;
+                tst::check_eq(p[0], uint8_t(inside ? 3 : 0), SL);
+                tst::check_eq(p[1], uint8_t(inside ? 2 : 0), SL);
+                tst::check_eq(p[2], uint8_t(inside ? 1 : 0), SL);
+                tst::check_eq(p[3], uint8_t(inside ? 4 : 0), SL);
+            }
+        }
+    );
+
+    suite.add<cpugl::isa>(
+        "blend_mask",
+        get_supported_isas(),
+        [](const auto& isa){
+            const auto& ks = cpugl::get_kernel_set(isa);
+
+            constexpr auto num_pixels = 67;
+
+            std::vector<r4::vector4<uint8_t>> pixels(num_pixels);
+            std::vector<uint8_t> mask(num_pixels);
+            for(size_t i = 0; i != num_pixels; ++i){
+                pixels[i] = {uint8_t(i * 3), uint8_t(255 - i), uint8_t(i * 7), uint8_t(i * 11)};
+                mask[i] = uint8_t(i * 29);
+            }
+            mask.front() = 0;
+            mask.back() = 0xff;
+
+            const r4::vector4<uint8_t> color = {200, 100, 50, 180};
+
+            auto expected = pixels;
+            for(size_t i = 0; i != num_pixels; ++i){
+                auto alpha = uint8_t(cpugl::div_255(uint32_t(mask[i]) * color.w()));
+                expected[i] = cpugl::blend(pixels[i], {color.x(), color.y(), color.z(), alpha});
+            }
+
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            ks.blend_mask(reinterpret_cast<uint8_t*>(pixels.data()), mask.data(), num_pixels, color.data());
+
+            for(size_t i = 0; i != num_pixels; ++i){
+                tst::check(pixels[i] == expected[i], [&](auto& o){o << "i = " << i;}, SL);
+            }
+        }
+    );
+
+    suite.add<cpugl::isa>(
+        "context_clear",
+        get_supported_isas(),
+        [](const auto& isa){
+            cpugl::context::fb_image_type fb(r4::vector2<uint32_t>{13, 7});
+            cpugl::context ctx;
+            ctx.set_isa(isa);
+            ctx.set_framebuffer(fb);
+
+            constexpr auto color = cpugl::context::fb_span_type::pixel_type{10, 20, 30, 40};
+            ctx.clear(color);
+
+            for(const auto& p : fb.pixels()){
+                tst::check(p == color, SL);
+            }
+        }
+    );
+});
+}
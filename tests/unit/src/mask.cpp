@@ -0,0 +1,113 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <cpugl/blend.hpp>
+#include <cpugl/shaders/mask_pos_tex_shader.hpp>
+
+namespace{
+constexpr uint32_t size = 16;
+
+constexpr auto bg_color = cpugl::context::fb_span_type::pixel_type{10, 200, 30, 0xff};
+const cpugl::color_type glyph_color = {1, 0.5, 0, 0.75};
+
+cpugl::mask_pos_tex_shader::mask_image_type make_mask(){
+    cpugl::mask_pos_tex_shader::mask_image_type ret(r4::vector2<uint32_t>{5, 4});
+    for(uint32_t y = 0; y != ret.dims().y(); ++y){
+        for(uint32_t x = 0; x != ret.dims().x(); ++x){
+            ret[y][x] = {uint8_t((x * 4 + y) * 13)};
+        }
+    }
+    return ret;
+}
+
+struct fixture{
+    cpugl::context::fb_image_type fb{r4::vector2<uint32_t>{size, size}};
+    cpugl::context ctx;
+
+    fixture(){
+        ctx.set_framebuffer(fb);
+        ctx.clear(bg_color);
+        ctx.reset_damage();
+    }
+};
+}
+
+namespace{
+const tst::set set("mask", [](tst::suite& suite){
+    suite.add("blit_is_same_as_rendering_unscaled_quad", [](){
+        auto mask = make_mask();
+        r4::vector2<int32_t> pos{3, 2};
+
+        fixture blitted;
+        cpugl::mask_pos_tex_shader::blit(blitted.ctx, glyph_color, mask, {.src = {{0, 0}, mask.dims()}, .dst = pos});
+
+        fixture rendered;
+        {
+            auto p = pos.to<cpugl::real>();
+            auto d = mask.dims().to<cpugl::real>();
+
+            // texture coordinates are shifted by half texel, so that samples hit texel centers
+            auto half_texel = cpugl::tex_coord_type{0.5, 0.5}.comp_div(d);
+            const std::vector<r4::vector3<cpugl::real>> vertices = {
+                {p.x(), p.y(), 0},
+                {p.x(), p.y() + d.y(), 0},
+                {p.x() + d.x(), p.y() + d.y(), 0},
+                {p.x() + d.x(), p.y(), 0},
+            };
+            const std::vector<cpugl::tex_coord_type> tex_coords = {
+                cpugl::tex_coord_type{0, 0} + half_texel,
+                cpugl::tex_coord_type{0, 1} + half_texel,
+                cpugl::tex_coord_type{1, 1} + half_texel,
+                cpugl::tex_coord_type{1, 0} + half_texel,
+            };
+            auto quad = cpugl::make_mesh({{0, 1, 2}, {0, 2, 3}}, utki::make_span(vertices), utki::make_span(tex_coords));
+
+            cpugl::mask_pos_tex_shader::render(rendered.ctx, r4::matrix4<cpugl::real>().set_identity(), glyph_color, mask, quad);
+        }
+
+        tst::check(blitted.ctx.get_damage() == cpugl::rectangle{pos.to<uint32_t>(), mask.dims()}, SL);
+
+        bool blended = false;
+        for(uint32_t y = 0; y != size; ++y){
+            for(uint32_t x = 0; x != size; ++x){
+                const auto& b = blitted.fb[y][x];
+                const auto& r = rendered.fb[y][x];
+                for(unsigned i = 0; i != b.size(); ++i){
+                    // float and integer arithmetic can round differently
+                    tst::check_le(std::abs(int(b[i]) - int(r[i])), 1, [&](auto& o){o << "x = " << x << ", y = " << y;}, SL);
+                }
+                if(b != bg_color){
+                    blended = true;
+                }
+            }
+        }
+        tst::check(blended, SL);
+    });
+
+    suite.add("blit_is_clipped_by_render_area", [](){
+        auto mask = make_mask();
+
+        fixture f;
+        f.ctx.set_scissor({{2, 0}, {size - 2, size}});
+
+        // partially above the framebuffer and left of the scissor
+        cpugl::mask_pos_tex_shader::blit(f.ctx, {1, 1, 1, 1}, mask, {.src = {{1, 1}, {4, 3}}, .dst = {0, -1}});
+
+        tst::check(f.ctx.get_damage() == cpugl::rectangle{{2, 0}, {2, 2}}, SL);
+
+        for(uint32_t y = 0; y != size; ++y){
+            for(uint32_t x = 0; x != size; ++x){
+                bool inside = x >= 2 && x < 4 && y < 2;
+                if(!inside){
+                    tst::check(f.fb[y][x] == bg_color, [&](auto& o){o << "x = " << x << ", y = " << y;}, SL);
+                    continue;
+                }
+                // texel (x + 1, y + 2) of the mask
+                auto coverage = uint32_t(mask[y + 2][x + 1][0]);
+                auto expected = cpugl::blend(bg_color, {0xff, 0xff, 0xff, uint8_t(cpugl::div_255(0xff * coverage))});
+                tst::check(f.fb[y][x] == expected, [&](auto& o){o << "x = " << x << ", y = " << y;}, SL);
+            }
+        }
+    });
+});
+}
@@ -0,0 +1,112 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <cpugl/mesh_file.hpp>
+#include <cpugl/shaders/pos_clr_shader.hpp>
+
+namespace{
+cpugl::mesh<cpugl::color_type> make_test_mesh(){
+    const std::vector<r4::vector3<cpugl::real>> pos = {
+        {1, 1, 0},
+        {1, 18, 0},
+        {18, 18, 0},
+        {18, 1, 0},
+    };
+    const std::vector<cpugl::color_type> colors = {
+        {1, 0, 0, 1},
+        {0, 1, 0, 1},
+        {0, 0, 1, 1},
+        {1, 1, 1, 1},
+    };
+
+    auto m = cpugl::make_mesh({{0, 1, 2}, {0, 2, 3}}, utki::make_span(pos), utki::make_span(colors));
+    m.quads = {{0, 1, 2, 3}};
+    m.lines = {{0, 2}};
+    m.points = {3};
+    return m;
+}
+
+std::string make_temp_path(std::string_view name){
+    return std::string("/tmp/cpugl_test_") + std::string(name);
+}
+}
+
+namespace{
+const tst::set set("mesh_file", [](tst::suite& suite){
+    suite.add("written_mesh_maps_to_same_data", [](){
+        auto m = make_test_mesh();
+        auto path = make_temp_path("mesh.bin");
+
+        cpugl::write_mesh_file(path, m);
+
+        cpugl::mapped_mesh<cpugl::color_type> mm(path, cpugl::mesh_file_trust::untrusted);
+        const auto& v = mm.view();
+
+        tst::check_eq(v.vertices.size(), m.vertices.size(), SL);
+        tst::check(std::equal(v.vertices.begin(), v.vertices.end(), m.vertices.begin()), SL);
+        tst::check(std::equal(v.faces.begin(), v.faces.end(), m.faces.begin(), m.faces.end()), SL);
+        tst::check(std::equal(v.quads.begin(), v.quads.end(), m.quads.begin(), m.quads.end()), SL);
+        tst::check(std::equal(v.lines.begin(), v.lines.end(), m.lines.begin(), m.lines.end()), SL);
+        tst::check(std::equal(v.points.begin(), v.points.end(), m.points.begin(), m.points.end()), SL);
+        tst::check(v.bounds.center == m.bounds.center, SL);
+        tst::check_eq(v.bounds.radius, m.bounds.radius, SL);
+    });
+
+    suite.add("mapped_mesh_renders_same_as_mesh", [](){
+        auto m = make_test_mesh();
+        auto path = make_temp_path("render.bin");
+        cpugl::write_mesh_file(path, m);
+        cpugl::mapped_mesh<cpugl::color_type> mm(path, cpugl::mesh_file_trust::trusted);
+
+        auto render = [](const cpugl::mesh_view<cpugl::color_type>& mesh){
+            cpugl::context::fb_image_type fb(r4::vector2<uint32_t>{20, 20});
+            cpugl::context ctx;
+            ctx.set_framebuffer(fb);
+            ctx.clear({0, 0, 0, 0});
+            cpugl::pos_clr_shader().render(ctx, r4::matrix4<cpugl::real>().set_identity(), mesh);
+            return fb;
+        };
+
+        auto expected = render(m);
+        auto actual = render(mm.view());
+
+        for(uint32_t y = 0; y != expected.dims().y(); ++y){
+            for(uint32_t x = 0; x != expected.dims().x(); ++x){
+                tst::check(expected.span()[y][x] == actual.span()[y][x], [&](auto& o){o << "x = " << x << ", y = " << y;}, SL);
+            }
+        }
+    });
+
+    suite.add("mapping_with_different_vertex_type_throws", [](){
+        auto path = make_temp_path("mismatch.bin");
+        cpugl::write_mesh_file(path, make_test_mesh());
+
+        bool thrown = false;
+        try{
+            cpugl::mapped_mesh<cpugl::tex_coord_type> mm(path, cpugl::mesh_file_trust::trusted);
+        }catch(std::runtime_error&){
+            thrown = true;
+        }
+        tst::check(thrown, SL);
+    });
+    suite.add("out_of_range_index_throws_only_for_untrusted_file", [](){
+        auto m = make_test_mesh();
+        m.faces.push_back({0, 1, unsigned(m.vertices.size())});
+
+        auto path = make_temp_path("corrupt.bin");
+        cpugl::write_mesh_file(path, m);
+
+        bool thrown = false;
+        try{
+            cpugl::mapped_mesh<cpugl::color_type> mm(path, cpugl::mesh_file_trust::untrusted);
+        }catch(std::runtime_error&){
+            thrown = true;
+        }
+        tst::check(thrown, SL);
+
+        // indices of trusted file are not read on loading
+        cpugl::mapped_mesh<cpugl::color_type> mm(path, cpugl::mesh_file_trust::trusted);
+        tst::check_eq(mm.view().faces.size(), m.faces.size(), SL);
+    });
+});
+}
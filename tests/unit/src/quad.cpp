@@ -0,0 +1,156 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <cpugl/pipeline.hpp>
+#include <cpugl/shaders/color_pos_shader.hpp>
+
+#include "common.hpp"
+
+namespace{
+using quad_vertices = std::array<r4::vector3<cpugl::real>, 4>;
+
+// quad as quad primitive or as faces (0, 1, 2) and (0, 2, 3)
+cpugl::mesh<cpugl::color_type> make_quad(const quad_vertices& v, bool as_triangles){
+    const std::vector<cpugl::color_type> colors = {
+        {1, 0, 0, 1},
+        {0, 1, 0, 1},
+        {0, 0, 1, 1},
+        {1, 1, 0, 1},
+    };
+    auto m = cpugl::make_mesh({}, utki::make_span(v), utki::make_span(colors));
+    if(as_triangles){
+        m.faces = {{0, 1, 2}, {0, 2, 3}};
+    }else{
+        m.quads = {{0, 1, 2, 3}};
+    }
+    return m;
+}
+
+using test_common::identity;
+using test_common::equal;
+
+constexpr uint32_t size = 32;
+
+struct fixture : test_common::fixture{
+    explicit fixture(bool depth) :
+        test_common::fixture({size, size}, depth)
+    {}
+
+    // quad rendered over a square, so that depth test passes for some pixels and fails for others
+    void render_scene(const quad_vertices& v, bool as_triangles){
+        this->render(test_common::make_color_square(0, 0, size, size, 0.4));
+        this->render(make_quad(v, as_triangles));
+    }
+};
+
+const std::vector<quad_vertices> quads = {
+    // pixel aligned square
+    {{{2, 2, 0.3}, {2, 20, 0.3}, {20, 20, 0.3}, {20, 2, 0.3}}},
+    // convex, not aligned to pixels, varying depth
+    {{{3.3, 1.7, 0.2}, {1.2, 22.6, 0.5}, {26.8, 29.1, 0.6}, {29.4, 4.2, 0.3}}},
+    // concave
+    {{{2.5, 2.5, 0.3}, {4.1, 28.3, 0.3}, {12.6, 12.2, 0.3}, {28.7, 4.4, 0.3}}},
+    // back facing
+    {{{29.4, 4.2, 0.3}, {26.8, 29.1, 0.6}, {1.2, 22.6, 0.5}, {3.3, 1.7, 0.2}}},
+    // crossing the near plane
+    {{{3.3, 1.7, 0.2}, {1.2, 22.6, -0.5}, {26.8, 29.1, 0.6}, {29.4, 4.2, 0.3}}},
+};
+}
+
+namespace{
+const tst::set set("quad", [](tst::suite& suite){
+    suite.add<quad_vertices>(
+        "quad_renders_same_as_two_triangles",
+        quads,
+        [](const auto& v){
+            for(bool depth : {false, true}){
+                fixture triangles(depth);
+                triangles.render_scene(v, true);
+
+                fixture quad(depth);
+                quad.render_scene(v, false);
+
+                tst::check(equal(triangles, quad), SL);
+
+                // no pixel is shaded twice
+                tst::check_eq(quad.num_invocations, triangles.num_invocations, SL);
+            }
+        }
+    );
+
+    suite.add<quad_vertices>(
+        "constant_color_quad_renders_same_as_two_triangles",
+        quads,
+        [](const auto& v){
+            auto render = [&v](fixture& f, bool as_triangles){
+                auto m = make_quad(v, as_triangles);
+                cpugl::mesh<> positions;
+                for(const auto& vertex : m.vertices){
+                    positions.vertices.emplace_back(std::get<0>(vertex));
+                }
+                positions.faces = m.faces;
+                positions.quads = m.quads;
+                positions.update_bounds();
+                cpugl::color_pos_shader().render(f.ctx, identity, {0, 1, 0, 1}, positions);
+            };
+
+            fixture triangles(false);
+            render(triangles, true);
+
+            fixture quad(false);
+            render(quad, false);
+
+            tst::check(equal(triangles, quad), SL);
+        }
+    );
+
+    suite.add<quad_vertices>(
+        "quad_damage_is_same_as_of_two_triangles",
+        quads,
+        [](const auto& v){
+            fixture triangles(false);
+            triangles.ctx.reset_damage();
+            triangles.render(make_quad(v, true));
+
+            fixture quad(false);
+            quad.ctx.reset_damage();
+            quad.render(make_quad(v, false));
+
+            tst::check(quad.ctx.get_damage() == triangles.ctx.get_damage(), SL);
+        }
+    );
+    // Fragments of the quad are shaded in a single traversal of its bounding box, so hierarchical depth buffer
+    // tile rows of the shaded pixels never go back, unlike when the triangles are rasterized one after another.
+    suite.add("convex_quad_is_rasterized_in_one_pass", [](){
+        const auto& v = quads[1];
+
+        for(bool depth : {false, true}){
+            for(bool as_triangles : {false, true}){
+                fixture f(depth);
+
+                // vertex color holds the vertex position, so that fragment program gets the pixel position
+                std::vector<cpugl::color_type> positions;
+                for(const auto& p : v){
+                    positions.push_back({p.x(), p.y(), 0, 1});
+                }
+                auto m = cpugl::make_mesh({}, utki::make_span(v), utki::make_span(std::as_const(positions)));
+                if(as_triangles){
+                    m.faces = {{0, 1, 2}, {0, 2, 3}};
+                }else{
+                    m.quads = {{0, 1, 2, 3}};
+                }
+
+                std::vector<uint32_t> tile_rows;
+                auto fragment_program = [&tile_rows](const cpugl::color_type& pos){
+                    tile_rows.push_back(uint32_t(std::round(pos.y())) / cpugl::hi_z_buffer::tile_size);
+                    return cpugl::color_type{1, 1, 1, 1};
+                };
+                cpugl::pipeline::render<true>(f.ctx, identity, test_common::color_vertex_program, fragment_program, m);
+
+                tst::check_gt(tile_rows.size(), size_t(0), SL);
+                tst::check_eq(std::is_sorted(tile_rows.begin(), tile_rows.end()), !as_triangles, SL);
+            }
+        }
+    });
+});
+}
@@ -0,0 +1,173 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <cpugl/shaders/color_pos_shader.hpp>
+
+namespace{
+// renders lines and points of the mesh, the framebuffer is cleared to transparent black before rendering
+void render_lines_and_points(cpugl::context::fb_image_type& fb, cpugl::mesh<>& m, cpugl::real line_width, cpugl::real point_size){
+    cpugl::context ctx;
+    ctx.set_framebuffer(fb);
+    ctx.clear({0, 0, 0, 0});
+    ctx.set_line_width(line_width);
+    ctx.set_point_size(point_size);
+
+    m.update_bounds();
+
+    cpugl::color_pos_shader().render(ctx, r4::matrix4<cpugl::real>().set_identity(), {1, 1, 1, 1}, m);
+}
+
+// tells whether exactly the pixels for which is_expected(x, y) returns true are drawn
+template <typename predicate_type>
+bool is_drawn_exactly(const cpugl::context::fb_image_type& fb, const predicate_type& is_expected){
+    for(uint32_t y = 0; y != fb.dims().y(); ++y){
+        for(uint32_t x = 0; x != fb.dims().x(); ++x){
+            bool drawn = fb[y][x] != r4::vector4<uint8_t>{0, 0, 0, 0};
+            if(drawn != is_expected(int(x), int(y))){
+                return false;
+            }
+        }
+    }
+    return true;
+}
+}
+
+namespace{
+const tst::set set("rasterize", [](tst::suite& suite){
+    suite.add("triangle_covering_no_sample_is_culled", [](){
+        cpugl::context::fb_image_type fb(r4::vector2<uint32_t>{10, 10});
+        cpugl::context ctx;
+        ctx.set_framebuffer(fb);
+
+        const std::vector<r4::vector3<cpugl::real>> vertices = {
+            {2.1, 2.1, 0},
+            {2.1, 2.9, 0},
+            {2.9, 2.9, 0},
+        };
+
+        auto m = cpugl::make_mesh({{0, 1, 2}}, utki::make_span(vertices));
+
+        cpugl::color_pos_shader().render(ctx, r4::matrix4<cpugl::real>().set_identity(), {1, 1, 1, 1}, m);
+
+        tst::check(cpugl::is_empty(ctx.get_damage()), SL);
+    });
+
+    // Every sample inside of a grid of small triangles must be covered exactly once,
+    // coverage count is accumulated in the stencil buffer.
+    suite.add("small_triangles_are_watertight", [](){
+        cpugl::context::fb_image_type fb(r4::vector2<uint32_t>{40, 40});
+        cpugl::context::stencil_image_type sb(r4::vector2<uint32_t>{40, 40});
+        cpugl::context ctx;
+        ctx.set_framebuffer(fb);
+        ctx.set_stencil_buffer(sb);
+        ctx.clear_stencil(0);
+        ctx.set_stencil_state({
+            .enabled = true,
+            .pass = cpugl::stencil_operation::increment
+        });
+
+        constexpr cpugl::real origin = 3.3;
+        constexpr unsigned n = 40;
+
+        for(cpugl::real cell_size : {0.7, 1.3}){
+            ctx.clear_stencil(0);
+
+            std::vector<r4::vector3<cpugl::real>> vertices;
+            std::vector<std::array<unsigned, 3>> faces;
+
+            for(unsigned y = 0; y <= n; ++y){
+                for(unsigned x = 0; x <= n; ++x){
+                    vertices.push_back({origin + cpugl::real(x) * cell_size, origin + cpugl::real(y) * cell_size, 0});
+                }
+            }
+            for(unsigned y = 0; y != n; ++y){
+                for(unsigned x = 0; x != n; ++x){
+                    unsigned i = y * (n + 1) + x;
+                    faces.push_back({i, i + n + 1, i + 1});
+                    faces.push_back({i + 1, i + n + 1, i + n + 2});
+                }
+            }
+
+            auto m = cpugl::make_mesh(std::move(faces), utki::make_span(std::as_const(vertices)));
+
+            cpugl::color_pos_shader().render(ctx, r4::matrix4<cpugl::real>().set_identity(), {1, 1, 1, 1}, m);
+
+            auto end = origin + cpugl::real(n) * cell_size;
+
+            for(uint32_t y = 0; y != sb.dims().y(); ++y){
+                for(uint32_t x = 0; x != sb.dims().x(); ++x){
+                    bool inside = cpugl::real(x) >= origin && cpugl::real(x) < end && cpugl::real(y) >= origin && cpugl::real(y) < end;
+                    tst::check_eq(sb[y][x][0], uint8_t(inside ? 1 : 0), [&](auto& o){o << "x = " << x << ", y = " << y;}, SL);
+                }
+            }
+        }
+    });
+    suite.add("point_covers_square_of_point_size", [](){
+        cpugl::context::fb_image_type fb(r4::vector2<uint32_t>{10, 10});
+
+        const std::vector<r4::vector3<cpugl::real>> vertices = {{5.5, 5.5, 0}};
+        auto m = cpugl::make_mesh({}, utki::make_span(vertices));
+        m.points = {0};
+
+        render_lines_and_points(fb, m, 1, 3);
+
+        tst::check(is_drawn_exactly(fb, [](int x, int y){return x >= 4 && x < 7 && y >= 4 && y < 7;}), SL);
+    });
+
+    suite.add("line_includes_start_point_and_excludes_end_point", [](){
+        cpugl::context::fb_image_type fb(r4::vector2<uint32_t>{10, 10});
+
+        for(bool reversed : {false, true}){
+            const std::vector<r4::vector3<cpugl::real>> vertices = {{2, 3, 0}, {8, 3, 0}};
+            auto m = cpugl::make_mesh({}, utki::make_span(vertices));
+            if(reversed){
+                m.lines = {{1, 0}};
+            }else{
+                m.lines = {{0, 1}};
+            }
+
+            render_lines_and_points(fb, m, 1, 1);
+
+            tst::check(is_drawn_exactly(fb, [](int x, int y){return x >= 2 && x < 8 && y == 3;}), SL);
+        }
+    });
+
+    suite.add("wide_line_covers_line_width_pixels", [](){
+        cpugl::context::fb_image_type fb(r4::vector2<uint32_t>{10, 10});
+
+        const std::vector<r4::vector3<cpugl::real>> vertices = {{3, 1, 0}, {3, 7, 0}};
+        auto m = cpugl::make_mesh({}, utki::make_span(vertices));
+        m.lines = {{0, 1}};
+
+        render_lines_and_points(fb, m, 3, 1);
+
+        tst::check(is_drawn_exactly(fb, [](int x, int y){return x >= 2 && x < 5 && y >= 1 && y < 7;}), SL);
+    });
+
+    // The vertex of the point is outside of the render area, but the point square is partially inside.
+    suite.add("large_point_outside_render_area_is_not_culled", [](){
+        cpugl::context::fb_image_type fb(r4::vector2<uint32_t>{20, 20});
+
+        const std::vector<r4::vector3<cpugl::real>> vertices = {{-2, 5, 0}};
+        auto m = cpugl::make_mesh({}, utki::make_span(vertices));
+        m.points = {0};
+
+        render_lines_and_points(fb, m, 1, 10);
+
+        tst::check(is_drawn_exactly(fb, [](int x, int y){return x < 3 && y < 10;}), SL);
+    });
+
+    // The line vertices are outside of the render area, but the wide line is partially inside.
+    suite.add("wide_line_outside_render_area_is_not_culled", [](){
+        cpugl::context::fb_image_type fb(r4::vector2<uint32_t>{20, 20});
+
+        const std::vector<r4::vector3<cpugl::real>> vertices = {{2, -1, 0}, {12, -1, 0}};
+        auto m = cpugl::make_mesh({}, utki::make_span(vertices));
+        m.lines = {{0, 1}};
+
+        render_lines_and_points(fb, m, 5, 1);
+
+        tst::check(is_drawn_exactly(fb, [](int x, int y){return x >= 2 && x < 12 && y < 2;}), SL);
+    });
+});
+}
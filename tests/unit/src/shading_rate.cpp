@@ -0,0 +1,105 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <cpugl/pipeline.hpp>
+
+#include "common.hpp"
+
+namespace{
+cpugl::mesh<cpugl::color_type> make_triangle(
+    const r4::vector2<cpugl::real>& a,
+    const r4::vector2<cpugl::real>& b,
+    const r4::vector2<cpugl::real>& c,
+    cpugl::real z
+){
+    const std::vector<r4::vector3<cpugl::real>> vertices = {
+        {a.x(), a.y(), z},
+        {b.x(), b.y(), z},
+        {c.x(), c.y(), z},
+    };
+    const std::vector<cpugl::color_type> colors = {
+        {1, 0, 0, 1},
+        {0, 1, 0, 1},
+        {0, 0, 1, 1},
+    };
+    return cpugl::make_mesh({{0, 1, 2}}, utki::make_span(vertices), utki::make_span(colors));
+}
+
+constexpr uint32_t size = 32;
+
+struct fixture : test_common::fixture{
+    fixture(cpugl::shading_rate rate, bool depth) :
+        test_common::fixture({size, size}, depth)
+    {
+        ctx.set_shading_rate(rate);
+    }
+
+    // a triangle partially covered by a nearer one, edges are not aligned to the shading blocks
+    void render_scene(){
+        this->render(make_triangle({1.3, 0.7}, {3.1, 30.6}, {29.8, 17.2}, 0.5));
+        this->render(make_triangle({12.4, 2.2}, {9.9, 25.3}, {31.5, 9.1}, 0.3));
+    }
+};
+
+const std::vector<cpugl::shading_rate> coarse_rates = {
+    cpugl::shading_rate::one_per_2x2,
+    cpugl::shading_rate::one_per_4x4,
+};
+}
+
+namespace{
+const tst::set set("shading_rate", [](tst::suite& suite){
+    suite.add<cpugl::shading_rate>(
+        "coverage_is_same_as_for_per_pixel_shading",
+        coarse_rates,
+        [](const auto& rate){
+            for(bool depth : {false, true}){
+                fixture expected(cpugl::shading_rate::one_per_pixel, depth);
+                expected.render_scene();
+
+                fixture actual(rate, depth);
+                actual.render_scene();
+
+                tst::check_lt(actual.num_invocations, expected.num_invocations, SL);
+
+                for(uint32_t y = 0; y != size; ++y){
+                    for(uint32_t x = 0; x != size; ++x){
+                        // alpha is 1 for all fragments
+                        tst::check_eq(
+                            actual.fb[y][x][3],
+                            expected.fb[y][x][3],
+                            [&](auto& o){o << "x = " << x << ", y = " << y << ", depth = " << depth;},
+                            SL
+                        );
+                        if(depth){
+                            tst::check_eq(actual.db[y][x][0], expected.db[y][x][0], SL);
+                        }
+                    }
+                }
+            }
+        }
+    );
+
+    suite.add<cpugl::shading_rate>(
+        "fragment_program_runs_once_per_block",
+        coarse_rates,
+        [](const auto& rate){
+            auto block_size = uint32_t(rate);
+
+            fixture f(rate, false);
+
+            // covers whole framebuffer with one triangle
+            f.render(make_triangle({-1, -1}, {-1, 2 * size}, {2 * size, -1}, 0.5));
+
+            tst::check_eq(f.num_invocations, (size / block_size) * (size / block_size), SL);
+
+            for(uint32_t y = 0; y != size; ++y){
+                for(uint32_t x = 0; x != size; ++x){
+                    auto block_origin = f.fb[y - y % block_size][x - x % block_size];
+                    tst::check(f.fb[y][x] == block_origin, [&](auto& o){o << "x = " << x << ", y = " << y;}, SL);
+                }
+            }
+        }
+    );
+});
+}
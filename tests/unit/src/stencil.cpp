@@ -0,0 +1,102 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <cpugl/shaders/color_pos_shader.hpp>
+
+namespace{
+constexpr auto bg_color = cpugl::context::fb_span_type::pixel_type{0, 0, 0, 0xff};
+constexpr auto white = cpugl::context::fb_span_type::pixel_type{0xff, 0xff, 0xff, 0xff};
+
+// covers whole 100x100 framebuffer
+cpugl::mesh<> make_quad(){
+    const std::vector<r4::vector3<cpugl::real>> vertices = {
+        {0, 0, 0},
+        {0, 100, 0},
+        {100, 100, 0},
+        {100, 0, 0},
+    };
+    return cpugl::make_mesh({{0, 1, 3}, {3, 1, 2}}, utki::make_span(vertices));
+}
+
+const tst::set set("stencil", [](tst::suite& suite){
+    suite.add("operations", [](){
+        cpugl::stencil_state s;
+        s.reference = 5;
+        s.function = cpugl::stencil_function::less;
+
+        tst::check(s.test(6), SL);
+        tst::check(!s.test(5), SL);
+
+        s.mask = 0x3;
+        // (5 & 3) < (4 & 3) is false
+        tst::check(!s.test(4), SL);
+
+        tst::check_eq(s.apply(cpugl::stencil_operation::increment, 0xff), uint8_t(0xff), SL);
+        tst::check_eq(s.apply(cpugl::stencil_operation::increment_wrap, 0xff), uint8_t(0), SL);
+        tst::check_eq(s.apply(cpugl::stencil_operation::decrement, 0), uint8_t(0), SL);
+        tst::check_eq(s.apply(cpugl::stencil_operation::replace, 0), uint8_t(5), SL);
+
+        s.write_mask = 0xf0;
+        tst::check_eq(s.apply(cpugl::stencil_operation::invert, 0x0f), uint8_t(0xff), SL);
+    });
+
+    suite.add("scissor_limits_rendering", [](){
+        cpugl::context::fb_image_type fb(r4::vector2<uint32_t>{100, 100});
+        cpugl::context ctx;
+        ctx.set_framebuffer(fb);
+        ctx.clear(bg_color);
+
+        ctx.set_scissor({{20, 30}, {10, 10}});
+
+        cpugl::color_pos_shader shader;
+        shader.render(ctx, r4::matrix4<cpugl::real>().set_identity(), {1, 1, 1, 1}, make_quad());
+
+        for(uint32_t y = 0; y != fb.dims().y(); ++y){
+            for(uint32_t x = 0; x != fb.dims().x(); ++x){
+                bool inside = x >= 20 && x < 30 && y >= 30 && y < 40;
+                tst::check(fb[y][x] == (inside ? white : bg_color), [&](auto& o){o << "x = " << x << ", y = " << y;}, SL);
+            }
+        }
+    });
+
+    suite.add("stencil_masks_rendering", [](){
+        cpugl::context::fb_image_type fb(r4::vector2<uint32_t>{100, 100});
+        cpugl::context::stencil_image_type sb(r4::vector2<uint32_t>{100, 100});
+        cpugl::context ctx;
+        ctx.set_framebuffer(fb);
+        ctx.set_stencil_buffer(sb);
+        ctx.clear(bg_color);
+        ctx.clear_stencil(0);
+
+        // write mask to stencil buffer
+        ctx.set_scissor({{10, 10}, {20, 20}});
+        ctx.set_stencil_state({
+            .enabled = true,
+            .function = cpugl::stencil_function::always,
+            .reference = 1,
+            .pass = cpugl::stencil_operation::replace
+        });
+
+        cpugl::color_pos_shader shader;
+        shader.render(ctx, r4::matrix4<cpugl::real>().set_identity(), {0, 0, 0, 1}, make_quad());
+
+        // draw through the mask
+        ctx.reset_scissor();
+        ctx.set_stencil_state({
+            .enabled = true,
+            .function = cpugl::stencil_function::equal,
+            .reference = 1
+        });
+
+        shader.render(ctx, r4::matrix4<cpugl::real>().set_identity(), {1, 1, 1, 1}, make_quad());
+
+        for(uint32_t y = 0; y != fb.dims().y(); ++y){
+            for(uint32_t x = 0; x != fb.dims().x(); ++x){
+                bool inside = x >= 10 && x < 30 && y >= 10 && y < 30;
+                tst::check(fb[y][x] == (inside ? white : bg_color), [&](auto& o){o << "x = " << x << ", y = " << y;}, SL);
+                tst::check_eq(sb[y][x][0], uint8_t(inside ? 1 : 0), SL);
+            }
+        }
+    });
+});
+}
@@ -0,0 +1,133 @@
+#include <set>
+#include <thread>
+
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <cpugl/pipeline.hpp>
+#include <cpugl/shaders/color_pos_shader.hpp>
+
+#include "common.hpp"
+
+namespace{
+using test_common::identity;
+using test_common::equal;
+
+const r4::vector2<uint32_t> fb_dims = {32, 32};
+
+constexpr unsigned num_chunks = 12;
+
+// overlapping vertical stripes at different depths
+void add_stripe(cpugl::mesh<>& m, unsigned index){
+    auto x1 = cpugl::real(index * 2);
+    auto x2 = x1 + 8;
+    auto y2 = cpugl::real(fb_dims.y());
+    auto z = cpugl::real(index % 3) / 4 + cpugl::real(0.1);
+
+    auto base = unsigned(m.vertices.size());
+    m.vertices.emplace_back(r4::vector3<cpugl::real>{x1, 0, z});
+    m.vertices.emplace_back(r4::vector3<cpugl::real>{x1, y2, z});
+    m.vertices.emplace_back(r4::vector3<cpugl::real>{x2, y2, z});
+    m.vertices.emplace_back(r4::vector3<cpugl::real>{x2, 0, z});
+    m.faces.push_back({base, base + 1, base + 2});
+    m.faces.push_back({base, base + 2, base + 3});
+}
+
+struct fixture : test_common::fixture{
+    fixture() :
+        test_common::fixture(fb_dims, true)
+    {}
+};
+}
+
+namespace{
+const tst::set set("stream", [](tst::suite& suite){
+    suite.add("stream_renders_same_as_whole_mesh", [](){
+        fixture whole;
+        {
+            cpugl::mesh<> m;
+            for(unsigned i = 0; i != num_chunks; ++i){
+                add_stripe(m, i);
+            }
+            m.update_bounds();
+            cpugl::color_pos_shader().render(whole.ctx, identity, {1, 0, 0, 1}, m);
+        }
+
+        fixture streamed;
+        unsigned num_calls = 0;
+        cpugl::color_pos_shader().render_stream(
+            streamed.ctx,
+            identity,
+            {1, 0, 0, 1},
+            [&num_calls](cpugl::mesh<>& chunk){
+                // the chunk is given empty
+                tst::check(chunk.vertices.empty(), SL);
+                tst::check(chunk.faces.empty(), SL);
+
+                if(num_calls == num_chunks){
+                    return false;
+                }
+                // faces index the chunk's vertices
+                add_stripe(chunk, num_calls);
+                ++num_calls;
+                return true;
+            }
+        );
+
+        tst::check_eq(num_calls, num_chunks, SL);
+        tst::check(equal(whole, streamed), SL);
+    });
+
+    suite.add("producer_exception_is_rethrown", [](){
+        fixture f;
+
+        unsigned num_calls = 0;
+        bool thrown = false;
+        try{
+            cpugl::color_pos_shader().render_stream(
+                f.ctx,
+                identity,
+                {1, 0, 0, 1},
+                [&num_calls](cpugl::mesh<>& chunk){
+                    if(num_calls == 1){
+                        throw std::runtime_error("producer failure");
+                    }
+                    ++num_calls;
+                    add_stripe(chunk, 0);
+                    return true;
+                }
+            );
+        }catch(std::runtime_error&){
+            thrown = true;
+        }
+        tst::check(thrown, SL);
+
+        // the chunk produced before the failure is rendered
+        tst::check(f.fb[0][0] == r4::vector4<uint8_t>{0xff, 0, 0, 0xff}, SL);
+        tst::check(f.fb[0][8] == r4::vector4<uint8_t>{0, 0, 0, 0}, SL);
+    });
+    suite.add("chunks_are_produced_on_one_thread", [](){
+        fixture f;
+
+        std::set<std::thread::id> threads;
+        unsigned num_calls = 0;
+        cpugl::color_pos_shader().render_stream(
+            f.ctx,
+            identity,
+            {1, 0, 0, 1},
+            [&](cpugl::mesh<>& chunk){
+                threads.insert(std::this_thread::get_id());
+                if(num_calls == num_chunks){
+                    return false;
+                }
+                add_stripe(chunk, num_calls);
+                ++num_calls;
+                return true;
+            }
+        );
+
+        tst::check_eq(threads.size(), size_t(1), SL);
+        tst::check(threads.count(std::this_thread::get_id()) == 0, SL);
+    });
+});
+}
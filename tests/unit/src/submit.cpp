@@ -0,0 +1,61 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <cpugl/shaders/color_pos_shader.hpp>
+
+namespace{
+const tst::set set("submit", [](tst::suite& suite){
+    suite.add("submitted_commands_render_to_framebuffer", [](){
+        cpugl::context::fb_image_type fb(r4::vector2<uint32_t>{10, 10});
+        cpugl::context ctx;
+        ctx.set_framebuffer(fb);
+
+        const std::vector<r4::vector3<cpugl::real>> vertices = {
+            {0, 0, 0},
+            {0, 10, 0},
+            {10, 10, 0},
+            {10, 0, 0},
+        };
+        auto m = cpugl::make_mesh({{0, 1, 2}, {0, 2, 3}}, utki::make_span(vertices));
+
+        auto cleared = ctx.submit([](cpugl::context& c){
+            c.clear({0, 0, 0, 0});
+        });
+
+        auto rendered = ctx.submit([&m](cpugl::context& c){
+            cpugl::color_pos_shader().render(c, r4::matrix4<cpugl::real>().set_identity(), {1, 0, 0, 1}, m);
+        });
+
+        rendered.get();
+
+        // commands are executed in submission order
+        tst::check(cleared.wait_for(std::chrono::seconds(0)) == std::future_status::ready, SL);
+
+        tst::check(fb[5][5] == r4::vector4<uint8_t>{0xff, 0, 0, 0xff}, SL);
+    });
+
+    suite.add("exception_is_delivered_through_future", [](){
+        cpugl::context ctx;
+
+        auto f = ctx.submit([](cpugl::context&){
+            throw std::runtime_error("test");
+        });
+
+        bool thrown = false;
+        try{
+            f.get();
+        }catch(std::runtime_error&){
+            thrown = true;
+        }
+        tst::check(thrown, SL);
+
+        // the worker keeps running after the exception
+        bool done = false;
+        ctx.submit([&done](cpugl::context&){
+            done = true;
+        });
+        ctx.finish();
+        tst::check(done, SL);
+    });
+});
+}
@@ -0,0 +1,87 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <cpugl/presenters/memory_presenter.hpp>
+
+namespace{
+const tst::set set("swapchain", [](tst::suite& suite){
+    suite.add("buffers_are_reused", [](){
+        cpugl::memory_presenter presenter;
+        cpugl::swapchain sc(presenter);
+
+        sc.resize({10, 10});
+
+        std::vector<const void*> buffers;
+
+        constexpr auto num_frames = 6;
+        for(unsigned i = 0; i != num_frames; ++i){
+            auto frame = sc.acquire();
+            buffers.push_back(frame.framebuffer[0].data());
+            sc.present({{0, 0}, sc.get_dims()});
+        }
+
+        tst::check_ne(buffers[0], buffers[1], SL);
+        for(unsigned i = 2; i != num_frames; ++i){
+            tst::check_eq(buffers[i], buffers[i % 2], SL);
+        }
+    });
+
+    suite.add("stale_area_accumulates_presented_areas", [](){
+        cpugl::memory_presenter presenter;
+        cpugl::swapchain sc(presenter);
+
+        sc.resize({100, 100});
+
+        // freshly allocated buffers are stale entirely
+        auto frame = sc.acquire();
+        tst::check(frame.stale_area == cpugl::rectangle{{0, 0}, {100, 100}}, SL);
+        sc.present({{0, 0}, {100, 100}});
+
+        frame = sc.acquire();
+        tst::check(frame.stale_area == cpugl::rectangle{{0, 0}, {100, 100}}, SL);
+        sc.present({{10, 10}, {10, 10}});
+
+        // first buffer has missed the second frame's area
+        frame = sc.acquire();
+        tst::check(frame.stale_area == cpugl::rectangle{{0, 0}, {100, 100}}, SL);
+        sc.present({{50, 50}, {10, 10}});
+
+        frame = sc.acquire();
+        tst::check(frame.stale_area == cpugl::rectangle{{10, 10}, {50, 50}}, SL);
+        sc.present({{50, 50}, {10, 10}});
+
+        frame = sc.acquire();
+        tst::check(frame.stale_area == cpugl::rectangle{{50, 50}, {10, 10}}, SL);
+
+        sc.invalidate();
+        frame = sc.acquire();
+        tst::check(frame.stale_area == cpugl::rectangle{{0, 0}, {100, 100}}, SL);
+    });
+
+    suite.add("memory_presenter_holds_presented_frame", [](){
+        cpugl::memory_presenter presenter;
+        cpugl::swapchain sc(presenter);
+
+        sc.resize({10, 10});
+
+        tst::check(presenter.get_presented().dims() == r4::vector2<uint32_t>{0, 0}, SL);
+
+        cpugl::context ctx;
+
+        constexpr auto color = cpugl::context::fb_span_type::pixel_type{1, 2, 3, 4};
+
+        auto frame = sc.acquire();
+        ctx.set_framebuffer(frame.framebuffer);
+        ctx.clear(color);
+        sc.present(ctx.get_damage());
+
+        // next frame is rendered to another buffer
+        frame = sc.acquire();
+        ctx.set_framebuffer(frame.framebuffer);
+        ctx.clear({0, 0, 0, 0});
+
+        tst::check(presenter.get_presented().dims() == r4::vector2<uint32_t>{10, 10}, SL);
+        tst::check(presenter.get_presented()[5][5] == color, SL);
+    });
+});
+}
@@ -0,0 +1,126 @@
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <cpugl/texture_file.hpp>
+
+namespace{
+// write a valid texture file, then overwrite its header with the modified one
+template <typename modify_type>
+void write_corrupt_texture_file(const char* path, const modify_type& modify){
+    rasterimage::image_variant image;
+    image.variant = rasterimage::image<uint8_t, 4>(r4::vector2<uint32_t>{8, 4}, {1, 2, 3, 4});
+    cpugl::write_texture_file(path, image);
+
+    std::vector<char> data;
+    {
+        std::ifstream in(path, std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    cpugl::texture_file_header header{};
+    std::memcpy(&header, data.data(), sizeof(header));
+    modify(header);
+    std::memcpy(data.data(), &header, sizeof(header));
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), std::streamsize(data.size()));
+}
+
+bool is_rejected(const char* path){
+    try{
+        cpugl::mapped_texture tex(path);
+    }catch(std::invalid_argument&){
+        return true;
+    }
+    return false;
+}
+}
+
+namespace{
+const tst::set set("texture_file", [](tst::suite& suite){
+    suite.add("mip_chain_goes_down_to_1x1", [](){
+        rasterimage::image<uint8_t, 4> image(r4::vector2<uint32_t>{5, 2}, {10, 20, 30, 255});
+
+        auto levels = cpugl::make_mip_chain(std::move(image));
+
+        tst::check_eq(levels.size(), size_t(3), SL);
+        tst::check(levels[1].dims() == r4::vector2<uint32_t>{2, 1}, SL);
+        tst::check(levels[2].dims() == r4::vector2<uint32_t>{1, 1}, SL);
+
+        // box filter of uniform image is the same uniform image
+        tst::check(levels[2][0][0] == r4::vector4<uint8_t>{10, 20, 30, 255}, SL);
+    });
+
+    suite.add("mip_level_is_average_of_2x2_block", [](){
+        rasterimage::image<uint8_t, 4> image(r4::vector2<uint32_t>{2, 2});
+        image[0][0] = {0, 0, 0, 0};
+        image[0][1] = {255, 0, 0, 0};
+        image[1][0] = {255, 255, 0, 0};
+        image[1][1] = {255, 255, 255, 0};
+
+        auto levels = cpugl::make_mip_chain(std::move(image));
+
+        tst::check_eq(levels.size(), size_t(2), SL);
+        tst::check(levels[1][0][0] == r4::vector4<uint8_t>{191, 128, 64, 0}, SL);
+    });
+
+    suite.add("written_texture_maps_to_same_texels", [](){
+        rasterimage::image<uint8_t, 3> rgb(r4::vector2<uint32_t>{7, 3});
+        for(uint32_t y = 0; y != rgb.dims().y(); ++y){
+            for(uint32_t x = 0; x != rgb.dims().x(); ++x){
+                rgb[y][x] = {uint8_t(x * 30), uint8_t(y * 80), 7};
+            }
+        }
+
+        rasterimage::image_variant image;
+        image.variant = rgb;
+
+        const auto path = "/tmp/cpugl_test_texture.cpugltex";
+        cpugl::write_texture_file(path, image);
+
+        cpugl::mapped_texture tex(path);
+
+        tst::check_eq(tex.num_levels(), size_t(3), SL);
+
+        const auto& level = tex.get_level(0);
+        tst::check(level.dims() == rgb.dims(), SL);
+        for(uint32_t y = 0; y != rgb.dims().y(); ++y){
+            for(uint32_t x = 0; x != rgb.dims().x(); ++x){
+                tst::check(level[y][x] == rasterimage::get_rgba(rgb[y][x]), [&](auto& o){o << "x = " << x << ", y = " << y;}, SL);
+            }
+        }
+
+        tst::check(tex.get_level(2).dims() == r4::vector2<uint32_t>{1, 1}, SL);
+    });
+
+    suite.add("corrupt_level_sizes_are_rejected", [](){
+        const auto path = "/tmp/cpugl_test_corrupt_texture.cpugltex";
+
+        // levels are 8x4, 4x2, 2x1 and 1x1, the sizes are changed without moving the texels,
+        // so that all levels stay within the file
+        write_corrupt_texture_file(path, [](cpugl::texture_file_header& h){h.levels[1].height = 0;});
+        tst::check(is_rejected(path), SL);
+
+        write_corrupt_texture_file(path, [](cpugl::texture_file_header& h){h.levels[0].width = 0;});
+        tst::check(is_rejected(path), SL);
+
+        write_corrupt_texture_file(path, [](cpugl::texture_file_header& h){h.levels[2].width = 1;});
+        tst::check(is_rejected(path), SL);
+
+        // a level after 1x1
+        write_corrupt_texture_file(path, [](cpugl::texture_file_header& h){
+            h.levels[4] = h.levels[3];
+            ++h.num_levels;
+        });
+        tst::check(is_rejected(path), SL);
+
+        // the unmodified file is fine
+        write_corrupt_texture_file(path, [](cpugl::texture_file_header&){});
+        tst::check(!is_rejected(path), SL);
+    });
+});
+}
@@ -0,0 +1,95 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <cpugl/thread_pool.hpp>
+#include <cpugl/shaders/pos_clr_shader.hpp>
+
+namespace{
+const tst::set set("thread_pool", [](tst::suite& suite){
+    suite.add("parallel_for_processes_every_index_once", [](){
+        cpugl::thread_pool pool(3);
+
+        for(size_t size : {0, 1, 10, 1000, 1001}){
+            std::vector<std::atomic<unsigned>> counts(size);
+
+            pool.parallel_for(size, 7, [&counts](size_t begin, size_t end){
+                for(size_t i = begin; i != end; ++i){
+                    ++counts[i];
+                }
+            });
+
+            for(size_t i = 0; i != size; ++i){
+                tst::check_eq(counts[i].load(), 1u, [&](auto& o){o << "size = " << size << ", i = " << i;}, SL);
+            }
+        }
+    });
+
+    suite.add("parallel_for_rethrows_exception", [](){
+        cpugl::thread_pool pool(2);
+
+        bool thrown = false;
+        try{
+            pool.parallel_for(100, 1, [](size_t begin, size_t end){
+                if(begin == 50){
+                    throw std::runtime_error("test");
+                }
+            });
+        }catch(std::runtime_error&){
+            thrown = true;
+        }
+        tst::check(thrown, SL);
+
+        // the pool is usable after the exception
+        std::atomic<size_t> sum = 0;
+        pool.parallel_for(100, 1, [&sum](size_t begin, size_t end){
+            sum += end - begin;
+        });
+        tst::check_eq(sum.load(), size_t(100), SL);
+    });
+
+    suite.add("parallel_vertex_stage_renders_same_as_serial", [](){
+        // grid of triangles with more vertices than in one vertex processing chunk
+        constexpr unsigned n = 100;
+        constexpr cpugl::real cell_size = 0.37;
+
+        std::vector<r4::vector3<cpugl::real>> vertices;
+        std::vector<cpugl::color_type> colors;
+        std::vector<std::array<unsigned, 3>> faces;
+        for(unsigned y = 0; y <= n; ++y){
+            for(unsigned x = 0; x <= n; ++x){
+                vertices.push_back({cpugl::real(x) * cell_size, cpugl::real(y) * cell_size, 0});
+                colors.push_back({cpugl::real(x) / n, cpugl::real(y) / n, 0, 1});
+            }
+        }
+        for(unsigned y = 0; y != n; ++y){
+            for(unsigned x = 0; x != n; ++x){
+                unsigned i = y * (n + 1) + x;
+                faces.push_back({i, i + n + 1, i + 1});
+                faces.push_back({i + 1, i + n + 1, i + n + 2});
+            }
+        }
+        auto m = cpugl::make_mesh(std::move(faces), utki::make_span(std::as_const(vertices)), utki::make_span(std::as_const(colors)));
+
+        auto render = [&m](cpugl::thread_pool* pool){
+            cpugl::context::fb_image_type fb(r4::vector2<uint32_t>{40, 40});
+            cpugl::context ctx;
+            ctx.set_framebuffer(fb);
+            ctx.set_thread_pool(pool);
+            ctx.clear({0, 0, 0, 0});
+            cpugl::pos_clr_shader().render(ctx, r4::matrix4<cpugl::real>().set_identity(), m);
+            return fb;
+        };
+
+        cpugl::thread_pool pool(3);
+
+        auto expected = render(nullptr);
+        auto actual = render(&pool);
+
+        for(uint32_t y = 0; y != expected.dims().y(); ++y){
+            for(uint32_t x = 0; x != expected.dims().x(); ++x){
+                tst::check(expected[y][x] == actual[y][x], [&](auto& o){o << "x = " << x << ", y = " << y;}, SL);
+            }
+        }
+    });
+});
+}
@@ -0,0 +1,172 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <cpugl/tile_cache.hpp>
+#include <cpugl/shaders/color_pos_shader.hpp>
+
+#include "common.hpp"
+
+namespace{
+// 4 x 2 tiles
+const r4::vector2<uint32_t> fb_dims = {cpugl::tile_cache::tile_size * 4, cpugl::tile_cache::tile_size * 2};
+
+constexpr auto bg_color = cpugl::context::fb_span_type::pixel_type{0, 0, 0, 0xff};
+const cpugl::color_type square_color = {1, 0, 0, 1};
+
+// record frame with a square at the position
+void record_frame(cpugl::tile_cache& cache, r4::vector2<uint32_t> pos){
+    cache.add(cpugl::hash_values(cpugl::initial_hash, bg_color), {{0, 0}, fb_dims}, [](cpugl::context& ctx){
+        ctx.clear(bg_color);
+    });
+
+    constexpr uint32_t square_size = 10;
+    cpugl::rectangle bounds{pos, {square_size, square_size}};
+    cache.add(cpugl::hash_values(cpugl::initial_hash, square_color, bounds), bounds, [bounds](cpugl::context& ctx){
+        auto p = bounds.p.to<cpugl::real>();
+        auto d = bounds.d.to<cpugl::real>();
+        const std::vector<r4::vector3<cpugl::real>> vertices = {
+            {p.x(), p.y(), 0},
+            {p.x(), p.y() + d.y(), 0},
+            {p.x() + d.x(), p.y() + d.y(), 0},
+            {p.x() + d.x(), p.y(), 0},
+        };
+        cpugl::color_pos_shader().render(
+            ctx,
+            r4::matrix4<cpugl::real>().set_identity(),
+            square_color,
+            cpugl::make_mesh({{0, 1, 2}, {0, 2, 3}}, utki::make_span(vertices))
+        );
+    });
+}
+
+// render frame without the cache
+cpugl::context::fb_image_type render_reference(r4::vector2<uint32_t> pos){
+    cpugl::context::fb_image_type fb(fb_dims);
+    cpugl::context ctx;
+    ctx.set_framebuffer(fb);
+    cpugl::tile_cache cache;
+    record_frame(cache, pos);
+    cache.render(ctx);
+    return fb;
+}
+
+using test_common::equal;
+}
+
+namespace{
+const tst::set set("tile_cache", [](tst::suite& suite){
+    suite.add("only_changed_tiles_are_rendered", [](){
+        cpugl::context::fb_image_type fb(fb_dims);
+        cpugl::context ctx;
+        ctx.set_framebuffer(fb);
+
+        cpugl::tile_cache cache;
+
+        record_frame(cache, {5, 5});
+        cache.render(ctx);
+        tst::check_eq(cache.get_num_rendered_tiles(), size_t(8), SL);
+        tst::check(ctx.get_damage() == cpugl::rectangle{{0, 0}, fb_dims}, SL);
+
+        // same frame
+        ctx.reset_damage();
+        record_frame(cache, {5, 5});
+        cache.render(ctx);
+        tst::check_eq(cache.get_num_rendered_tiles(), size_t(0), SL);
+        tst::check(cpugl::is_empty(ctx.get_damage()), SL);
+
+        // the square moves within the first tile
+        ctx.reset_damage();
+        record_frame(cache, {20, 30});
+        cache.render(ctx);
+        tst::check_eq(cache.get_num_rendered_tiles(), size_t(1), SL);
+        tst::check(ctx.get_damage() == cpugl::rectangle{{0, 0}, {cpugl::tile_cache::tile_size, cpugl::tile_cache::tile_size}}, SL);
+        tst::check(equal(fb, render_reference({20, 30})), SL);
+
+        // the square moves to the corner of four tiles
+        auto corner = cpugl::tile_cache::tile_size * 2 - 5;
+        record_frame(cache, {corner, cpugl::tile_cache::tile_size - 5});
+        cache.render(ctx);
+        // first tile and the four new tiles
+        tst::check_eq(cache.get_num_rendered_tiles(), size_t(5), SL);
+        tst::check(equal(fb, render_reference({corner, cpugl::tile_cache::tile_size - 5})), SL);
+    });
+
+    suite.add("context_state_is_part_of_tile_hash", [](){
+        cpugl::context::fb_image_type fb(fb_dims);
+        cpugl::context ctx;
+        ctx.set_framebuffer(fb);
+        ctx.clear({0, 0, 0, 0});
+
+        cpugl::tile_cache cache;
+
+        // the user's scissor leaves out all but the first tile
+        ctx.set_scissor({{0, 0}, {cpugl::tile_cache::tile_size, cpugl::tile_cache::tile_size}});
+        record_frame(cache, {100, 5});
+        cache.render(ctx);
+        tst::check_eq(cache.get_num_rendered_tiles(), size_t(1), SL);
+        tst::check(ctx.get_scissor().has_value(), SL);
+
+        // same frame without scissor, tiles left out before are rendered now
+        ctx.reset_scissor();
+        ctx.reset_damage();
+        record_frame(cache, {100, 5});
+        cache.render(ctx);
+        tst::check_eq(cache.get_num_rendered_tiles(), size_t(7), SL);
+        tst::check(equal(fb, render_reference({100, 5})), SL);
+
+        // same frame at other shading rate
+        ctx.set_shading_rate(cpugl::shading_rate::one_per_2x2);
+        record_frame(cache, {100, 5});
+        cache.render(ctx);
+        tst::check_eq(cache.get_num_rendered_tiles(), size_t(8), SL);
+
+        // redraw region limits the rendered tiles same way as scissor does
+        ctx.set_shading_rate(cpugl::shading_rate::one_per_pixel);
+        ctx.set_redraw_region({{0, 0}, {cpugl::tile_cache::tile_size, cpugl::tile_cache::tile_size}});
+        record_frame(cache, {100, 5});
+        cache.render(ctx);
+        tst::check_eq(cache.get_num_rendered_tiles(), size_t(1), SL);
+
+        ctx.reset_redraw_region();
+        record_frame(cache, {100, 5});
+        cache.render(ctx);
+        tst::check_eq(cache.get_num_rendered_tiles(), size_t(7), SL);
+        tst::check(equal(fb, render_reference({100, 5})), SL);
+    });
+
+    suite.add("framebuffers_are_tracked_separately", [](){
+        std::array<cpugl::context::fb_image_type, 2> fbs = {
+            cpugl::context::fb_image_type(fb_dims),
+            cpugl::context::fb_image_type(fb_dims)
+        };
+        cpugl::context ctx;
+        cpugl::tile_cache cache;
+
+        auto render_frame = [&](unsigned index, r4::vector2<uint32_t> pos){
+            ctx.set_framebuffer(fbs[index]);
+            ctx.reset_damage();
+            record_frame(cache, pos);
+            cache.render(ctx);
+            tst::check(equal(fbs[index], render_reference(pos)), SL);
+        };
+
+        render_frame(0, {5, 5});
+        tst::check_eq(cache.get_num_rendered_tiles(), size_t(8), SL);
+
+        // the second framebuffer has unknown content
+        render_frame(1, {5, 5});
+        tst::check_eq(cache.get_num_rendered_tiles(), size_t(8), SL);
+
+        render_frame(0, {100, 5});
+        tst::check_eq(cache.get_num_rendered_tiles(), size_t(2), SL);
+
+        // the second framebuffer holds the frame before the previous one
+        render_frame(1, {100, 5});
+        tst::check_eq(cache.get_num_rendered_tiles(), size_t(2), SL);
+
+        cache.invalidate();
+        render_frame(0, {100, 5});
+        tst::check_eq(cache.get_num_rendered_tiles(), size_t(8), SL);
+    });
+});
+}
@@ -0,0 +1,112 @@
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+// the test does not use the pipeline, so enabling tracing only here is fine
+#ifndef CPUGL_TRACE
+#	define CPUGL_TRACE
+#endif
+#include <cpugl/trace.hpp>
+
+namespace{
+const tst::set set("trace", [](tst::suite& suite){
+    suite.add("scopes_are_recorded_per_thread", [](){
+        cpugl::tracer tracer;
+
+        {
+            CPUGL_TRACE_SCOPE(tracer, "outer");
+            CPUGL_TRACE_SCOPE(tracer, "inner");
+        }
+
+        std::thread thread([&tracer](){
+            CPUGL_TRACE_SCOPE(tracer, "other thread");
+        });
+        thread.join();
+
+        auto spans = tracer.get_spans();
+        tst::check_eq(spans.size(), size_t(3), SL);
+
+        unsigned num_main_thread_spans = 0;
+        for(const auto& [thread_number, s] : spans){
+            tst::check_le(s.begin, s.end, SL);
+            if(std::string_view(s.name) == "other thread"){
+                tst::check_eq(thread_number, 1u, SL);
+            }else{
+                tst::check_eq(thread_number, 0u, SL);
+                ++num_main_thread_spans;
+            }
+        }
+        tst::check_eq(num_main_thread_spans, 2u, SL);
+
+        // inner scope ends first, but spans are ordered by begin time
+        tst::check(std::string_view(spans[0].second.name) == "outer", SL);
+    });
+
+    suite.add("ring_keeps_latest_spans", [](){
+        cpugl::tracer tracer(4);
+
+        for(uint64_t i = 0; i != 10; ++i){
+            tracer.record("span", i, i + 1);
+        }
+
+        auto spans = tracer.get_spans();
+        tst::check_eq(spans.size(), size_t(4), SL);
+        tst::check_eq(spans.front().second.begin, uint64_t(6), SL);
+        tst::check_eq(spans.back().second.begin, uint64_t(9), SL);
+
+        tracer.clear();
+        tst::check(tracer.get_spans().empty(), SL);
+    });
+
+    // a thread recording to more tracers than it caches keeps using its ring when it comes back to a tracer
+    suite.add("thread_keeps_its_ring_across_many_tracers", [](){
+        constexpr unsigned num_tracers = 6;
+        constexpr uint64_t num_rounds = 3;
+
+        std::vector<std::unique_ptr<cpugl::tracer>> tracers;
+        for(unsigned i = 0; i != num_tracers; ++i){
+            tracers.push_back(std::make_unique<cpugl::tracer>());
+        }
+
+        for(uint64_t round = 0; round != num_rounds; ++round){
+            for(auto& t : tracers){
+                t->record("span", round, round + 1);
+            }
+        }
+
+        for(const auto& t : tracers){
+            auto spans = t->get_spans();
+            tst::check_eq(spans.size(), size_t(num_rounds), SL);
+            for(const auto& [thread, s] : spans){
+                tst::check_eq(thread, 0u, SL);
+            }
+
+            std::stringstream ss;
+            t->write_chrome_trace(ss);
+            auto json = ss.str();
+
+            // one thread, so one thread name record
+            auto pos = json.find(R"("name":"thread_name")");
+            tst::check_ne(pos, std::string::npos, SL);
+            tst::check_eq(json.find(R"("name":"thread_name")", pos + 1), std::string::npos, SL);
+        }
+    });
+
+    suite.add("chrome_trace_has_complete_events", [](){
+        cpugl::tracer tracer;
+        tracer.record("vertices", 1500, 4250);
+
+        std::stringstream ss;
+        tracer.write_chrome_trace(ss);
+        auto json = ss.str();
+
+        tst::check_ne(json.find(R"("traceEvents":[)"), std::string::npos, SL);
+        tst::check_ne(json.find(R"({"name":"vertices","cat":"cpugl","ph":"X","pid":1,"tid":0,"ts":1.500,"dur":2.750})"), std::string::npos, SL);
+        tst::check_ne(json.find(R"("name":"thread_name")"), std::string::npos, SL);
+    });
+});
+}
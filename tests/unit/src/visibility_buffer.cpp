@@ -0,0 +1,121 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <cpugl/pipeline.hpp>
+
+#include "common.hpp"
+
+namespace{
+using test_common::identity;
+
+const auto& vertex_program = test_common::color_vertex_program;
+
+constexpr uint32_t size = 32;
+}
+
+namespace{
+const tst::set set("visibility_buffer", [](tst::suite& suite){
+    suite.add("fragment_program_runs_once_per_covered_pixel", [](){
+        test_common::fixture f({size, size}, true);
+        auto& ctx = f.ctx;
+
+        cpugl::visibility_buffer vb;
+        vb.resize(f.fb.dims());
+
+        unsigned num_invocations = 0;
+        auto fragment_program = [&num_invocations](const cpugl::color_type& color){
+            ++num_invocations;
+            return color;
+        };
+
+        // back to front, the worst case for forward rendering
+        for(cpugl::real z : {0.9, 0.7, 0.5, 0.3}){
+            cpugl::pipeline::render_visibility(ctx, vb, identity, vertex_program, fragment_program, test_common::make_color_square(0, 0, size, size, z));
+        }
+
+        tst::check_eq(num_invocations, 0u, SL);
+
+        vb.resolve(ctx);
+
+        tst::check_eq(num_invocations, size * size, SL);
+    });
+
+    suite.add("resolved_image_matches_forward_rendering", [](){
+        auto render = [](bool deferred){
+            // the framebuffer is returned, so it is not the fixture's one
+            cpugl::context::fb_image_type fb(r4::vector2<uint32_t>{size, size});
+            test_common::fixture f({size, size}, true);
+            auto& ctx = f.ctx;
+            ctx.set_framebuffer(fb);
+            ctx.clear({0, 0, 0, 0});
+
+            cpugl::visibility_buffer vb;
+            vb.resize(fb.dims());
+
+            auto fragment_program = [](const cpugl::color_type& color){
+                return color;
+            };
+
+            // deferred draws are allocated from the frame arena
+            ctx.begin_frame();
+
+            std::vector<cpugl::mesh<cpugl::color_type>> meshes;
+            meshes.push_back(test_common::make_color_square(3.3, 2.1, 25.7, 30.2, 0.5));
+            meshes.push_back(test_common::make_color_square(10.5, 0, 32, 20.9, 0.3));
+            meshes.push_back(test_common::make_color_square(0, 12.2, 20.1, 32, 0.7));
+
+            for(const auto& m : meshes){
+                if(deferred){
+                    cpugl::pipeline::render_visibility(ctx, vb, identity, vertex_program, fragment_program, m);
+                }else{
+                    cpugl::pipeline::render<true>(ctx, identity, vertex_program, fragment_program, m);
+                }
+            }
+            vb.resolve(ctx);
+            ctx.end_frame();
+            return fb;
+        };
+
+        auto expected = render(false);
+        auto actual = render(true);
+
+        for(uint32_t y = 0; y != size; ++y){
+            for(uint32_t x = 0; x != size; ++x){
+                tst::check(expected[y][x] == actual[y][x], [&](auto& o){o << "x = " << x << ", y = " << y;}, SL);
+            }
+        }
+    });
+    suite.add("lines_points_and_stencil_test_are_rejected", [](){
+        test_common::fixture f({size, size}, true);
+
+        cpugl::visibility_buffer vb;
+        vb.resize(f.fb.dims());
+
+        auto fragment_program = [](const cpugl::color_type& color){
+            return color;
+        };
+
+        auto render_throws = [&](const cpugl::mesh<cpugl::color_type>& m){
+            try{
+                cpugl::pipeline::render_visibility(f.ctx, vb, identity, vertex_program, fragment_program, m);
+            }catch(std::invalid_argument&){
+                return true;
+            }
+            return false;
+        };
+
+        auto with_line = test_common::make_color_square(0, 0, size, size, 0.5);
+        with_line.lines = {{0, 2}};
+        tst::check(render_throws(with_line), SL);
+
+        auto with_point = test_common::make_color_square(0, 0, size, size, 0.5);
+        with_point.points = {1};
+        tst::check(render_throws(with_point), SL);
+
+        cpugl::context::stencil_image_type sb(r4::vector2<uint32_t>{size, size});
+        f.ctx.set_stencil_buffer(sb);
+        f.ctx.set_stencil_state({.enabled = true});
+        tst::check(render_throws(test_common::make_color_square(0, 0, size, size, 0.5)), SL);
+    });
+});
+}
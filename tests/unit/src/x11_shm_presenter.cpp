@@ -0,0 +1,79 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <utki/util.hpp>
+
+#include <cpugl/presenters/x11_shm_presenter.hpp>
+
+#if M_OS == M_OS_LINUX && !defined(CPUGL_NO_X11)
+
+namespace{
+constexpr auto pixel = r4::vector4<uint8_t>{0x10, 0x20, 0x30, 0xff};
+constexpr auto swapped_pixel = r4::vector4<uint8_t>{0x30, 0x20, 0x10, 0xff};
+}
+
+namespace{
+const tst::set set("x11_shm_presenter", [](tst::suite& suite){
+    // The presented area of the buffer is converted to the X server's byte order while it is being presented,
+    // and the conversion is undone by wait().
+    suite.add("buffer_is_restored_after_presentation_completes", [](){
+        Display* display = XOpenDisplay(nullptr);
+        if(!display){
+            // no X server to test with
+            return;
+        }
+        utki::scope_exit display_scope_exit([display](){
+            XCloseDisplay(display);
+        });
+
+        if(!XShmQueryExtension(display)){
+            return;
+        }
+
+        auto screen = DefaultScreen(display);
+        Window window = XCreateSimpleWindow(display, RootWindow(display, screen), 0, 0, 16, 16, 0, 0, 0);
+        utki::scope_exit window_scope_exit([display, window](){
+            XDestroyWindow(display, window);
+        });
+
+        cpugl::x11_shm_presenter presenter(display, window);
+
+        presenter.resize({16, 16}, 2);
+
+        auto buffer = presenter.get_buffer(0);
+        tst::check(buffer.dims() == r4::vector2<uint32_t>{16, 16}, SL);
+
+        for(auto row : buffer){
+            for(auto& p : row){
+                p = pixel;
+            }
+        }
+
+        // framebuffer is RGBA in memory, X server expects blue first if its red mask is the third byte
+        const auto* visual = DefaultVisual(display, screen);
+        auto red_mask = ImageByteOrder(display) == LSBFirst ? visual->red_mask : visual->blue_mask;
+        bool swap_expected = red_mask == 0xff0000;
+
+        presenter.present(0, {{2, 2}, {4, 4}});
+
+        // only the presented area is converted
+        tst::check(buffer[3][3] == (swap_expected ? swapped_pixel : pixel), SL);
+        tst::check(buffer[8][8] == pixel, SL);
+
+        presenter.wait(0);
+
+        for(auto row : buffer){
+            for(const auto& p : row){
+                tst::check(p == pixel, SL);
+            }
+        }
+
+        // waiting for a buffer which is not being presented does nothing
+        presenter.wait(0);
+        presenter.wait(1);
+        tst::check(buffer[3][3] == pixel, SL);
+    });
+});
+}
+
+#endif